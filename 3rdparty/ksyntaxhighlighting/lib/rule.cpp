@@ -651,20 +651,14 @@ RegExpr::RegExpr(const HighlightingContextData::Rule::RegExpr &data)
 
 void RegExpr::resolve()
 {
-    if (m_isResolved) {
-        return;
-    }
-
-    m_isResolved = true;
-
     resolveRegex(m_regexp, context().context());
 }
 
 MatchResult RegExpr::doMatch(QStringView text, int offset, const QStringList &) const
 {
-    if (Q_UNLIKELY(!m_isResolved)) {
+    std::call_once(m_resolved, [this] {
         const_cast<RegExpr *>(this)->resolve();
-    }
+    });
 
     return regexMatch(m_regexp, text, offset);
 }
@@ -679,12 +673,6 @@ DynamicRegExpr::DynamicRegExpr(const HighlightingContextData::Rule::RegExpr &dat
 
 void DynamicRegExpr::resolve()
 {
-    if (m_isResolved) {
-        return;
-    }
-
-    m_isResolved = true;
-
     QRegularExpression regexp(m_pattern, m_patternOptions);
     resolveRegex(regexp, context().context());
     m_patternOptions = regexp.patternOptions();
@@ -692,9 +680,9 @@ void DynamicRegExpr::resolve()
 
 MatchResult DynamicRegExpr::doMatch(QStringView text, int offset, const QStringList &captures) const
 {
-    if (Q_UNLIKELY(!m_isResolved)) {
+    std::call_once(m_resolved, [this] {
         const_cast<DynamicRegExpr *>(this)->resolve();
-    }
+    });
 
     /**
      * create new pattern with right instantiation
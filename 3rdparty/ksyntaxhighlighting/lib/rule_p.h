@@ -21,6 +21,7 @@
 #include <QString>
 
 #include <memory>
+#include <mutex>
 
 namespace KSyntaxHighlighting
 {
@@ -306,7 +307,8 @@ protected:
 private:
     void resolve();
     QRegularExpression m_regexp;
-    bool m_isResolved = false;
+    // rules of one definition may be matched from several threads at once
+    mutable std::once_flag m_resolved;
 };
 
 class DynamicRegExpr final : public Rule
@@ -321,7 +323,7 @@ private:
     void resolve();
     QString m_pattern;
     QRegularExpression::PatternOptions m_patternOptions;
-    bool m_isResolved = false;
+    mutable std::once_flag m_resolved;
 };
 
 class StringDetect final : public Rule
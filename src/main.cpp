@@ -22,20 +22,18 @@
 
 // md-pdf include.
 #include "main_window.hpp"
+#include "server.hpp"
 
 // Qt include.
 #include <QString>
 #include <QApplication>
 #include <QCommandLineParser>
-
-// Magick++ include.
-#include <Magick++.h>
+#include <QCommandLineOption>
+#include <QTextStream>
 
 
 int main( int argc, char ** argv )
 {
-	Magick::InitializeMagick( nullptr );
-
 	QApplication app( argc, argv );
 
 	QCommandLineParser parser;
@@ -43,9 +41,59 @@ int main( int argc, char ** argv )
 	parser.addHelpOption();
 	parser.addPositionalArgument( QStringLiteral( "markdown" ),
 		QStringLiteral( "Markdown file to open." ) );
+	QCommandLineOption server( { QStringLiteral( "s" ), QStringLiteral( "server" ) },
+		QStringLiteral( "Run render service on local socket <name> without GUI." ),
+		QStringLiteral( "name" ) );
+	parser.addOption( server );
+	QCommandLineOption report( { QStringLiteral( "r" ), QStringLiteral( "report" ) },
+		QStringLiteral( "Append JSON report with timings and counters of every render "
+			"of the render service to <file>. Works only with --server, renders "
+			"from GUI are not reported." ),
+		QStringLiteral( "file" ) );
+	parser.addOption( report );
+	QCommandLineOption memoryBudget( { QStringLiteral( "m" ), QStringLiteral( "memory-budget" ) },
+		QStringLiteral( "Fail renders of the render service when resident memory "
+			"exceeds <MB>, instead of being killed." ),
+		QStringLiteral( "MB" ) );
+	parser.addOption( memoryBudget );
+	QCommandLineOption compressionThreads( { QStringLiteral( "t" ),
+			QStringLiteral( "compression-threads" ) },
+		QStringLiteral( "Compress streams of PDF of the render service with <count> threads, "
+			"0 means the ideal count. Used only by jobs with \"compressionLevel\"." ),
+		QStringLiteral( "count" ) );
+	parser.addOption( compressionThreads );
 
 	parser.process( app );
 
+	if( parser.isSet( server ) )
+	{
+		RenderServer s;
+
+		if( parser.isSet( memoryBudget ) )
+			s.setMemoryBudget( parser.value( memoryBudget ).toLongLong() * 1024 * 1024 );
+
+		if( parser.isSet( compressionThreads ) )
+			s.setCompressionThreads( parser.value( compressionThreads ).toInt() );
+
+		if( ( parser.isSet( report ) && !s.setReportFile( parser.value( report ) ) ) ||
+			!s.listen( parser.value( server ) ) )
+		{
+			QTextStream( stderr ) << s.errorString() << Qt::endl;
+
+			return 1;
+		}
+
+		return app.exec();
+	}
+
+	// GUI has no place for reports, they are written only by the render service.
+	if( parser.isSet( report ) )
+	{
+		QTextStream( stderr ) << QStringLiteral( "Option --report requires --server." ) << Qt::endl;
+
+		return 1;
+	}
+
 	const auto args = parser.positionalArguments();
 
 	const auto fileName = ( args.isEmpty() ? QString() : args.at( 0 ) );
@@ -20,14 +20,11 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-// md4qt include.
-#define MD4QT_QT_SUPPORT
-#include <md4qt/parser.hpp>
-
 // md-pdf include.
 #include "main_window.hpp"
 #include "renderer.hpp"
 #include "progress.hpp"
+#include "watcher.hpp"
 #include "const.hpp"
 #include "version.hpp"
 #include "cfg.hpp"
@@ -42,6 +39,7 @@
 #include <QMessageBox>
 #include <QMenu>
 #include <QMenuBar>
+#include <QStatusBar>
 #include <QApplication>
 #include <QComboBox>
 #include <QStandardPaths>
@@ -68,6 +66,8 @@ MainWidget::MainWidget( QWidget * parent )
 	,	m_textFontOk( false )
 	,	m_codeFontOk( false )
 	,	m_syntax( new Syntax )
+	,	m_watcher( new Watcher )
+	,	m_rendering( false )
 {
 	m_ui->setupUi( this );
 
@@ -91,6 +91,10 @@ MainWidget::MainWidget( QWidget * parent )
 	connect( m_ui->m_textFontSize, signal, this, &MainWidget::textFontSizeChanged );
 
 	connect( m_ui->m_mm, &QToolButton::toggled, this, &MainWidget::mmButtonToggled );
+	m_watcher->moveToThread( m_thread );
+	connect( m_thread, &QThread::finished, m_watcher, &QObject::deleteLater );
+	connect( m_watcher, &Watcher::changed, this, &MainWidget::markdownChanged );
+	connect( m_ui->m_watch, &QCheckBox::toggled, this, &MainWidget::watchToggled );
 
 	m_ui->m_left->setMaximum( 50 );
 	m_ui->m_right->setMaximum( 50 );
@@ -410,59 +414,168 @@ MainWidget::process()
 		if( !fileName.endsWith( QLatin1String( ".pdf" ), Qt::CaseInsensitive ) )
 			fileName.append( QLatin1String( ".pdf" ) );
 
-		MD::Parser< MD::QStringTrait > parser;
+		if( m_ui->m_watch->isChecked() )
+			m_pdfFileName = fileName;
+		else
+			m_watcher->stop();
+
+		// Markdown will be parsed by renderer, watcher takes the parsed document from it.
+		render( fileName );
+	}
+}
+
+void
+MainWidget::watchToggled( bool on )
+{
+	if( !on )
+		m_watcher->stop();
+}
+
+void
+MainWidget::markdownChanged( std::shared_ptr< MD::Document< MD::QStringTrait > > doc )
+{
+	if( m_pdfFileName.isEmpty() )
+		return;
 
-		auto doc = parser.parse( m_ui->m_fileName->text(), m_ui->m_recursive->isChecked() );
+	// Render the latest changes when current rendering will be finished.
+	if( m_rendering )
+		m_pendingDoc = doc;
+	else
+		rerender( doc );
+}
 
-		if( !doc->isEmpty() )
+RenderOpts
+MainWidget::renderOpts() const
+{
+	RenderOpts opts;
+
+	opts.m_textFont = m_ui->m_textFont->currentFont().family();
+	opts.m_textFontSize = m_ui->m_textFontSize->value();
+	opts.m_codeFont = m_ui->m_codeFont->currentFont().family();
+	opts.m_codeFontSize = m_ui->m_codeFontSize->value();
+	opts.m_mathFont = m_ui->m_mathFont->currentFont().family();
+	opts.m_mathFontSize = m_ui->m_mathFontSize->value();
+	opts.m_linkColor = m_ui->m_linkColor->color();
+	opts.m_borderColor = m_ui->m_borderColor->color();
+	opts.m_left = ( m_ui->m_pt->isChecked() ? m_ui->m_left->value() :
+		m_ui->m_left->value() / c_mmInPt );
+	opts.m_right = ( m_ui->m_pt->isChecked() ? m_ui->m_right->value() :
+		m_ui->m_right->value() / c_mmInPt );
+	opts.m_top = ( m_ui->m_pt->isChecked() ? m_ui->m_top->value() :
+		m_ui->m_top->value() / c_mmInPt );
+	opts.m_bottom = ( m_ui->m_pt->isChecked() ? m_ui->m_bottom->value() :
+		m_ui->m_bottom->value() / c_mmInPt );
+	opts.m_dpi = m_ui->m_dpi->value();
+	opts.m_syntax = m_syntax;
+	m_syntax->setTheme( m_syntax->themeForName( m_ui->m_codeTheme->currentText() ) );
+
+	return opts;
+}
+
+void
+MainWidget::render( const QString & fileName )
+{
+	auto * pdf = new PdfRenderer();
+	pdf->moveToThread( m_thread );
+
+	ProgressDlg progress( pdf, this );
+
+	// Dialog may be closed on cancel before the renderer reports the parsed document.
+	auto empty = std::make_shared< bool > ( false );
+
+	const auto markdown = m_ui->m_fileName->text();
+	const auto recursive = m_ui->m_recursive->isChecked();
+
+	connect( pdf, &PdfRenderer::parsed, this,
+		[empty] ( std::shared_ptr< MD::Document< MD::QStringTrait > > parsed )
 		{
-			auto * pdf = new PdfRenderer();
-			pdf->moveToThread( m_thread );
-
-			RenderOpts opts;
-
-			opts.m_textFont = m_ui->m_textFont->currentFont().family();
-			opts.m_textFontSize = m_ui->m_textFontSize->value();
-			opts.m_codeFont = m_ui->m_codeFont->currentFont().family();
-			opts.m_codeFontSize = m_ui->m_codeFontSize->value();
-			opts.m_mathFont = m_ui->m_mathFont->currentFont().family();
-			opts.m_mathFontSize = m_ui->m_mathFontSize->value();
-			opts.m_linkColor = m_ui->m_linkColor->color();
-			opts.m_borderColor = m_ui->m_borderColor->color();
-			opts.m_left = ( m_ui->m_pt->isChecked() ? m_ui->m_left->value() :
-				m_ui->m_left->value() / c_mmInPt );
-			opts.m_right = ( m_ui->m_pt->isChecked() ? m_ui->m_right->value() :
-				m_ui->m_right->value() / c_mmInPt );
-			opts.m_top = ( m_ui->m_pt->isChecked() ? m_ui->m_top->value() :
-				m_ui->m_top->value() / c_mmInPt );
-			opts.m_bottom = ( m_ui->m_pt->isChecked() ? m_ui->m_bottom->value() :
-				m_ui->m_bottom->value() / c_mmInPt );
-			opts.m_dpi = m_ui->m_dpi->value();
-			opts.m_syntax = m_syntax;
-			m_syntax->setTheme( m_syntax->themeForName( m_ui->m_codeTheme->currentText() ) );
-
-
-			ProgressDlg progress( pdf, this );
-
-			pdf->render( fileName, doc, opts );
-
-			if( progress.exec() == QDialog::Accepted )
-				QMessageBox::information( this, tr( "Markdown processed..." ),
-					tr( "PDF generated. Have a look at the result. Thank you." ) );
-			else
+			*empty = parsed->isEmpty();
+		} );
+
+	// Watcher and renderer share the thread, so watcher takes the document
+	// before rendering in the renderer's thread.
+	if( m_ui->m_watch->isChecked() )
+		connect( pdf, &PdfRenderer::parsed, m_watcher,
+			[w = m_watcher, markdown, recursive]
+				( std::shared_ptr< MD::Document< MD::QStringTrait > > parsed )
 			{
-				if( !progress.errorMsg().isEmpty() )
-					QMessageBox::critical( this, tr( "Error during rendering PDF..." ),
-						tr( "%1\n\nOutput PDF is broken. Sorry." )
-							.arg( progress.errorMsg() ) );
-				else
-					QMessageBox::information( this, tr( "Canceled..." ),
-						tr( "PDF generation is canceled." ) );
-			}
-		}
-		else
+				if( !parsed->isEmpty() )
+					w->watch( markdown, recursive, parsed );
+			}, Qt::DirectConnection );
+
+	pdf->renderFile( fileName, markdown, recursive, renderOpts() );
+
+	m_rendering = true;
+	const auto accepted = ( progress.exec() == QDialog::Accepted );
+	m_rendering = false;
+
+	if( accepted )
+		QMessageBox::information( this, tr( "Markdown processed..." ),
+			tr( "PDF generated. Have a look at the result. Thank you." ) );
+	else
+	{
+		if( *empty )
 			QMessageBox::warning( this, tr( "Markdown is empty..." ),
 				tr( "Input Markdown file is empty. Nothing saved." ) );
+		else if( !progress.errorMsg().isEmpty() )
+			QMessageBox::critical( this, tr( "Error during rendering PDF..." ),
+				tr( "%1\n\nOutput PDF is broken. Sorry." )
+					.arg( progress.errorMsg() ) );
+		else
+			QMessageBox::information( this, tr( "Canceled..." ),
+				tr( "PDF generation is canceled." ) );
+	}
+
+	renderPending();
+}
+
+void
+MainWidget::rerender( std::shared_ptr< MD::Document< MD::QStringTrait > > doc )
+{
+	auto * pdf = new PdfRenderer();
+	pdf->moveToThread( m_thread );
+
+	m_rerenderError.clear();
+
+	connect( pdf, &PdfRenderer::error, this,
+		[this] ( const QString & msg ) { m_rerenderError = msg; } );
+	// Renderer deletes himself on finish, with or without error.
+	connect( pdf, &QObject::destroyed, this, &MainWidget::rerenderDone );
+
+	m_rendering = true;
+
+	emit status( tr( "Markdown changed, rendering PDF..." ) );
+
+	pdf->render( m_pdfFileName, doc, renderOpts() );
+}
+
+void
+MainWidget::rerenderDone()
+{
+	m_rendering = false;
+
+	if( !m_rerenderError.isEmpty() )
+	{
+		emit status( tr( "Rendering of PDF failed." ) );
+
+		QMessageBox::critical( this, tr( "Error during rendering PDF..." ),
+			tr( "%1\n\nOutput PDF is broken. Sorry." ).arg( m_rerenderError ) );
+	}
+	else
+		emit status( tr( "PDF updated." ) );
+
+	renderPending();
+}
+
+void
+MainWidget::renderPending()
+{
+	if( m_pendingDoc )
+	{
+		auto pending = m_pendingDoc;
+		m_pendingDoc.reset();
+
+		markdownChanged( pending );
 	}
 }
 
@@ -583,6 +696,9 @@ MainWindow::MainWindow()
 	ui = new MainWidget( this );
 
 	setCentralWidget( ui );
+
+	connect( ui, &MainWidget::status, this,
+		[this] ( const QString & msg ) { statusBar()->showMessage( msg ); } );
 }
 
 void
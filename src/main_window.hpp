@@ -38,6 +38,9 @@
 
 // md-pdf include.
 #include "syntax.hpp"
+#include "renderer.hpp"
+
+class Watcher;
 
 
 //
@@ -56,6 +59,10 @@ public:
 
 	void setMarkdownFile( const QString & fileName );
 
+signals:
+	//! Status of re-rendering in watch mode.
+	void status( const QString & msg );
+
 private slots:
 	void changeLinkColor();
 	void changeBorderColor();
@@ -66,8 +73,19 @@ private slots:
 	void mmButtonToggled( bool on );
 	void textFontChanged( const QFont & f );
 	void codeFontChanged( const QFont & f );
+	void watchToggled( bool on );
+	void markdownChanged( std::shared_ptr< MD::Document< MD::QStringTrait > > doc );
+	void rerenderDone();
 
 private:
+	//! \return Render options from UI.
+	RenderOpts renderOpts() const;
+	//! Render Markdown file to PDF with progress dialog.
+	void render( const QString & fileName );
+	//! Render changed document to PDF in background, progress is shown in status.
+	void rerender( std::shared_ptr< MD::Document< MD::QStringTrait > > doc );
+	//! Render pending changes, if any.
+	void renderPending();
 	void changeStateOfStartButton();
 	QString configFileName( bool inPlace ) const;
 	void readCfg();
@@ -79,6 +97,12 @@ private:
 	bool m_textFontOk;
 	bool m_codeFontOk;
 	std::shared_ptr< Syntax > m_syntax;
+	Watcher * m_watcher;
+	QString m_pdfFileName;
+	bool m_rendering;
+	//! Error of the background render.
+	QString m_rerenderError;
+	std::shared_ptr< MD::Document< MD::QStringTrait > > m_pendingDoc;
 
 	Q_DISABLE_COPY( MainWidget )
 }; // class MainWindow
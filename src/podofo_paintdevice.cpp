@@ -27,6 +27,248 @@
 #include <QPainterPath>
 #include <QTextItem>
 #include <QTransform>
+#include <QMap>
+#include <QPair>
+
+// C++ include.
+#include <algorithm>
+#include <iterator>
+#include <string_view>
+
+
+//
+// Standard 14 fonts.
+//
+
+PoDoFo::PdfStandard14FontType
+standard14Font( bool monospace, bool bold, bool italic )
+{
+	if( monospace )
+	{
+		if( bold && italic )
+			return PoDoFo::PdfStandard14FontType::CourierBoldOblique;
+		else if( bold )
+			return PoDoFo::PdfStandard14FontType::CourierBold;
+		else if( italic )
+			return PoDoFo::PdfStandard14FontType::CourierOblique;
+		else
+			return PoDoFo::PdfStandard14FontType::Courier;
+	}
+	else
+	{
+		if( bold && italic )
+			return PoDoFo::PdfStandard14FontType::TimesBoldItalic;
+		else if( bold )
+			return PoDoFo::PdfStandard14FontType::TimesBold;
+		else if( italic )
+			return PoDoFo::PdfStandard14FontType::TimesItalic;
+		else
+			return PoDoFo::PdfStandard14FontType::TimesRoman;
+	}
+}
+
+PoDoFo::PdfFontCreateParams
+standard14FontParams()
+{
+	// Font manager caches fonts by encoding's ID, so encoding should be the same object.
+	// WinAnsi covers Latin-1, that is enough for drafts.
+	static const PoDoFo::PdfEncoding encoding(
+		PoDoFo::PdfEncodingMapFactory::WinAnsiEncodingInstance() );
+
+	PoDoFo::PdfFontCreateParams params;
+	params.Encoding = encoding;
+	params.Flags = PoDoFo::PdfFontCreateFlags::DontEmbed;
+
+	return params;
+}
+
+namespace /* anonymous */ {
+
+//! Characters of WinAnsi at 0x80-0x9F, sorted by code point.
+static const char32_t c_winAnsiUpper[] = {
+	0x0152, 0x0153, 0x0160, 0x0161, 0x0178, 0x017D, 0x017E, 0x0192,
+	0x02C6, 0x02DC, 0x2013, 0x2014, 0x2018, 0x2019, 0x201A, 0x201C,
+	0x201D, 0x201E, 0x2020, 0x2021, 0x2022, 0x2026, 0x2030, 0x2039,
+	0x203A, 0x20AC, 0x2122 };
+
+//! \return Can the code point be encoded with WinAnsi?
+inline bool
+isWinAnsi( char32_t c )
+{
+	// Latin-1 without C1 control characters, they are taken by WinAnsi for other characters.
+	if( c < 0x80 || ( c >= 0xA0 && c <= 0xFF ) )
+		return true;
+
+	return std::binary_search( std::cbegin( c_winAnsiUpper ), std::cend( c_winAnsiUpper ), c );
+}
+
+//! \return Code point of UTF-8 text at \a i and move \a i to the next character.
+inline char32_t
+nextCodePoint( std::string_view text, std::size_t & i )
+{
+	const auto b = static_cast< unsigned char > ( text[ i ] );
+	const std::size_t length = ( b < 0x80 ? 1 : ( b >> 5 ) == 0x06 ? 2 :
+		( b >> 4 ) == 0x0E ? 3 : ( b >> 3 ) == 0x1E ? 4 : 0 );
+
+	// Broken sequence, skip one byte.
+	if( !length || i + length > text.size() )
+	{
+		++i;
+
+		return 0xFFFD;
+	}
+
+	char32_t c = ( length == 1 ? b : b & ( 0x7F >> length ) );
+
+	for( std::size_t k = 1; k < length; ++k )
+		c = ( c << 6 ) | ( static_cast< unsigned char > ( text[ i + k ] ) & 0x3F );
+
+	i += length;
+
+	return c;
+}
+
+} /* namespace anonymous */
+
+const char *
+winAnsiSubset( const char * utf8, std::string & buf )
+{
+	const std::string_view text( utf8 );
+	std::size_t i = 0;
+	std::size_t start = 0;
+
+	// Usually everything is encodable, then the text is returned as is.
+	while( i < text.size() )
+	{
+		start = i;
+
+		if( !isWinAnsi( nextCodePoint( text, i ) ) )
+			break;
+
+		start = i;
+	}
+
+	if( start == text.size() )
+		return utf8;
+
+	buf.assign( text.substr( 0, start ) );
+	i = start;
+
+	while( i < text.size() )
+	{
+		start = i;
+
+		if( isWinAnsi( nextCodePoint( text, i ) ) )
+			buf.append( text.substr( start, i - start ) );
+		else
+			buf.push_back( '?' );
+	}
+
+	return buf.c_str();
+}
+
+//
+// Fonts.
+//
+
+QMutex &
+fontsMutex()
+{
+	static QMutex mutex;
+
+	return mutex;
+}
+
+#ifdef PODOFO_HAVE_FONTCONFIG
+namespace /* anonymous */ {
+
+//! \return Path and face index of the font found by fontconfig, empty path if not found.
+/*!
+	Paths are cached for all documents till the exit of the process,
+	so fonts installed while md-pdf is running are not seen.
+
+	Should be called under fontsMutex(), it guards the cache and the fontconfig
+	wrapper of PoDoFo, which is not thread-safe and is used by PoDoFo itself
+	in SearchFont() too.
+*/
+QPair< std::string, unsigned int >
+fontPath( const QString & name, const PoDoFo::PdfFontStyle & style )
+{
+	static QMap< QString, QPair< std::string, unsigned int > > paths;
+
+	const auto key = QStringLiteral( "%1:%2" ).arg( name,
+		QString::number( static_cast< int > ( style ) ) );
+
+	auto it = paths.find( key );
+
+	if( it == paths.end() )
+	{
+		PoDoFo::PdfFontConfigSearchParams fcParams;
+		fcParams.Style = style;
+
+		unsigned int faceIndex = 0;
+
+		const auto path = PoDoFo::PdfFontManager::GetFontConfigWrapper().SearchFontPath(
+			name.toLocal8Bit().data(), fcParams, faceIndex );
+
+		it = paths.insert( key, { path, faceIndex } );
+	}
+
+	return it.value();
+}
+
+} /* namespace anonymous */
+#endif // PODOFO_HAVE_FONTCONFIG
+
+PoDoFo::PdfFont *
+searchFont( PoDoFo::PdfDocument * doc, const QString & name,
+	const PoDoFo::PdfFontSearchParams & searchParams,
+	const PoDoFo::PdfFontCreateParams & createParams )
+{
+	QMutexLocker lock( &fontsMutex() );
+
+#ifdef PODOFO_HAVE_FONTCONFIG
+	const auto path = fontPath( name, searchParams.Style.value() );
+
+	if( !path.first.empty() )
+		return &doc->GetFonts().GetOrCreateFont( path.first, path.second, createParams );
+#endif // PODOFO_HAVE_FONTCONFIG
+
+	return doc->GetFonts().SearchFont( name.toLocal8Bit().data(), searchParams, createParams );
+}
+
+PoDoFo::PdfFont *
+fontFromFile( PoDoFo::PdfDocument * doc, const QString & path,
+	const PoDoFo::PdfFontCreateParams & createParams )
+{
+	QMutexLocker lock( &fontsMutex() );
+
+	return &doc->GetFonts().GetOrCreateFont( path.toLocal8Bit().data(), createParams );
+}
+
+PoDoFo::PdfFont *
+standard14Font( PoDoFo::PdfDocument * doc, PoDoFo::PdfStandard14FontType type )
+{
+	QMutexLocker lock( &fontsMutex() );
+
+	return &doc->GetFonts().GetStandard14Font( type, standard14FontParams() );
+}
+
+void
+embedFonts( PoDoFo::PdfDocument * doc )
+{
+	QMutexLocker lock( &fontsMutex() );
+
+	doc->GetFonts().EmbedFonts();
+}
+
+void
+DocumentDeleter::operator () ( PoDoFo::PdfMemDocument * doc ) const
+{
+	QMutexLocker lock( &fontsMutex() );
+
+	delete doc;
+}
 
 
 //
@@ -65,6 +307,18 @@ PoDoFoPaintDevice::setPdfPainter( PoDoFo::PdfPainter & p, PoDoFo::PdfDocument &
 	d->engine.setPdfPainter( p, doc );
 }
 
+void
+PoDoFoPaintDevice::setFontCreateParams( const PoDoFo::PdfFontCreateParams & params )
+{
+	d->engine.setFontCreateParams( params );
+}
+
+void
+PoDoFoPaintDevice::setUseStandardFonts( bool on )
+{
+	d->engine.setUseStandardFonts( on );
+}
+
 QPaintEngine *
 PoDoFoPaintDevice::paintEngine() const
 {
@@ -135,6 +389,10 @@ struct PoDoFoPaintEnginePrivate {
 	PoDoFo::PdfPainter * painter = nullptr;
 	//! Pdf document.
 	PoDoFo::PdfDocument * doc = nullptr;
+	//! Parameters of fonts creation.
+	PoDoFo::PdfFontCreateParams fontParams;
+	//! Use standard 14 fonts.
+	bool standardFonts = false;
 	//! Transformation.
 	QTransform transform;
 }; // struct PoDoFoPaintEnginePrivate
@@ -166,6 +424,18 @@ PoDoFoPaintEngine::pdfPainter() const
 	return d->painter;
 }
 
+void
+PoDoFoPaintEngine::setFontCreateParams( const PoDoFo::PdfFontCreateParams & params )
+{
+	d->fontParams = params;
+}
+
+void
+PoDoFoPaintEngine::setUseStandardFonts( bool on )
+{
+	d->standardFonts = on;
+}
+
 bool
 PoDoFoPaintEngine::begin( QPaintDevice * )
 {
@@ -381,7 +651,9 @@ PoDoFoPaintEngine::drawTextItem( const QPointF & p, const QTextItem & textItem )
 		d->painter->TextState.SetFont( *f.first, f.second );
 		d->painter->TextState.SetFontScale( 1.0 );
 		const auto utf8 = textItem.text().toUtf8();
-		d->painter->TextObject.AddText( utf8.data() );
+		std::string buf;
+		d->painter->TextObject.AddText( f.first->IsStandard14Font() ?
+			winAnsiSubset( utf8.constData(), buf ) : utf8.constData() );
 		d->painter->TextObject.End();
 	}
 }
@@ -452,11 +724,15 @@ PoDoFoPaintEngine::qFontToPoDoFo( const QFont & f )
 	if( f.bold() ) params.Style.value() |= PoDoFo::PdfFontStyle::Bold;
 	if( f.italic() ) params.Style.value() |= PoDoFo::PdfFontStyle::Italic;
 
-	auto * font = d->doc->GetFonts().SearchFont( f.family().toLocal8Bit().data(), params );
-
 	const double size = f.pointSizeF() > 0.0 ? f.pointSizeF() :
 		f.pixelSize() / paintDevice()->physicalDpiY() * 72.0;
 
+	if( d->standardFonts )
+		return { standard14Font( d->doc,
+			standard14Font( f.fixedPitch(), f.bold(), f.italic() ) ), size };
+
+	auto * font = searchFont( d->doc, f.family(), params, d->fontParams );
+
 	return { font, size };
 }
 
@@ -27,10 +27,70 @@
 #include <QPaintDevice>
 #include <QPaintEngine>
 #include <QScopedPointer>
+#include <QMutex>
 
 // podofo include.
 #include <podofo/podofo.h>
 
+// C++ include.
+#include <string>
+
+
+//
+// Standard 14 fonts.
+//
+
+//! \return Standard 14 font for the given style.
+PoDoFo::PdfStandard14FontType standard14Font( bool monospace, bool bold, bool italic );
+
+//! \return Parameters for creation of not embedded standard 14 font.
+PoDoFo::PdfFontCreateParams standard14FontParams();
+
+//! \return UTF-8 text where characters that WinAnsi can't encode are replaced with '?'.
+/*!
+	Returns \a utf8 itself when everything is encodable, otherwise the result
+	is written to \a buf, so usually nothing is allocated.
+*/
+const char * winAnsiSubset( const char * utf8, std::string & buf );
+
+
+//
+// Fonts.
+//
+
+//! \return Mutex that guards creation, embedding and destruction of fonts.
+/*!
+	PoDoFo shares fontconfig wrapper and FreeType library between all documents,
+	fontconfig is not thread-safe at all and FreeType is not thread-safe
+	on creation and destruction of faces. Fonts may create faces on creation,
+	on embedding of subsets and free them with the document. Everything else,
+	measuring and drawing of glyphs, works with faces and font data of the
+	document only, so it's safe without the lock.
+*/
+QMutex & fontsMutex();
+
+//! Search for font, paths of fonts found by fontconfig are cached for all documents
+//! till the exit of the process.
+PoDoFo::PdfFont * searchFont( PoDoFo::PdfDocument * doc, const QString & name,
+	const PoDoFo::PdfFontSearchParams & searchParams,
+	const PoDoFo::PdfFontCreateParams & createParams );
+
+//! \return Font from the file.
+PoDoFo::PdfFont * fontFromFile( PoDoFo::PdfDocument * doc, const QString & path,
+	const PoDoFo::PdfFontCreateParams & createParams );
+
+//! \return Standard 14 font.
+PoDoFo::PdfFont * standard14Font( PoDoFo::PdfDocument * doc,
+	PoDoFo::PdfStandard14FontType type );
+
+//! Embed fonts of the document, subsets are built here.
+void embedFonts( PoDoFo::PdfDocument * doc );
+
+//! Deleter of document that destroys fonts under fontsMutex().
+struct DocumentDeleter {
+	void operator () ( PoDoFo::PdfMemDocument * doc ) const;
+}; // struct DocumentDeleter
+
 
 //
 // PoDoFoPaintDevice
@@ -47,6 +107,10 @@ public:
 	~PoDoFoPaintDevice() override;
 
 	void setPdfPainter( PoDoFo::PdfPainter & p, PoDoFo::PdfDocument & doc );
+	//! Set parameters for fonts creation.
+	void setFontCreateParams( const PoDoFo::PdfFontCreateParams & params );
+	//! Use standard 14 fonts instead of real ones.
+	void setUseStandardFonts( bool on );
 
 	QPaintEngine * paintEngine() const override;
 
@@ -76,6 +140,10 @@ public:
 
 	void setPdfPainter( PoDoFo::PdfPainter & p, PoDoFo::PdfDocument & doc );
 	PoDoFo::PdfPainter * pdfPainter() const;
+	//! Set parameters for fonts creation.
+	void setFontCreateParams( const PoDoFo::PdfFontCreateParams & params );
+	//! Use standard 14 fonts instead of real ones.
+	void setUseStandardFonts( bool on );
 
 	bool begin( QPaintDevice * pdev ) override;
 	void drawEllipse( const QRectF & rect ) override;
@@ -20,6 +20,10 @@
 	along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+// md4qt include.
+#define MD4QT_QT_SUPPORT
+#include <md4qt/parser.hpp>
+
 // md-pdf include.
 #include "renderer.hpp"
 #include "const.hpp"
@@ -32,14 +36,20 @@
 
 // Qt include.
 #include <QFileInfo>
+#include <QFile>
+#include <QDateTime>
 #include <QNetworkAccessManager>
 #include <QThread>
 #include <QBuffer>
+#include <QImageReader>
 #include <QTemporaryFile>
 #include <QPainter>
 #include <QApplication>
 #include <QScreen>
 #include <QRegularExpression>
+#include <QThreadPool>
+#include <QJsonArray>
+#include <QJsonDocument>
 
 // Magick++ include.
 #include <Magick++.h>
@@ -48,9 +58,95 @@
 #include <jkqtmathtext/jkqtmathtext.h>
 
 // C++ include.
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 #include <utility>
 #include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+
+// System include.
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#elif defined( Q_OS_MACOS )
+#include <sys/resource.h>
+#include <mach/mach.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+
+//
+// ImagesCache
+//
+
+ImagesCache::ImagesCache( qint64 maxBytes )
+	:	m_bytes( 0 )
+	,	m_maxBytes( maxBytes )
+{
+}
+
+bool
+ImagesCache::find( const QString & key, QByteArray & data )
+{
+	QMutexLocker lock( &m_mutex );
+
+	const auto it = m_images.find( key );
+
+	if( it == m_images.end() )
+		return false;
+
+	m_order.splice( m_order.begin(), m_order, it->pos );
+	data = it->data;
+
+	return true;
+}
+
+void
+ImagesCache::insert( const QString & key, const QByteArray & data )
+{
+	QMutexLocker lock( &m_mutex );
+
+	const auto it = m_images.find( key );
+
+	if( it != m_images.end() )
+	{
+		m_bytes -= it->data.size();
+		m_order.erase( it->pos );
+		m_images.erase( it );
+	}
+
+	// Image bigger than the whole cache would only wash it out.
+	if( data.size() > m_maxBytes )
+		return;
+
+	m_order.push_front( key );
+	m_images.insert( key, { data, m_order.begin() } );
+	m_bytes += data.size();
+
+	while( m_bytes > m_maxBytes )
+	{
+		const auto last = m_images.find( m_order.back() );
+
+		m_bytes -= last->data.size();
+		m_images.erase( last );
+		m_order.pop_back();
+	}
+}
+
+qint64
+ImagesCache::bytes() const
+{
+	QMutexLocker lock( &m_mutex );
+
+	return m_bytes;
+}
 
 
 //
@@ -75,6 +171,73 @@ private:
 }; // class PdfRendererError
 
 
+namespace /* anonymous */ {
+
+//! Estimated size of object of PDF without stream.
+static const qint64 c_pdfObjectSize = 128;
+//! Estimated size of item of Markdown without text.
+static const qint64 c_mdItemSize = 96;
+//! Estimated size of operators of drawing in content of page.
+static const qint64 c_operatorSize = 32;
+//! Maximum size of decoded streams held in memory at once while compressing.
+static const qint64 c_compressionBatchBytes = 32 * 1024 * 1024;
+//! Interval of checks for termination while waiting for the parser.
+static const std::chrono::milliseconds c_parsingCheckInterval( 50 );
+
+//! Does the sink put anything into the PDF? Checked at compile time in visited lambdas.
+template< typename Sink >
+inline constexpr bool c_drawsContent = !std::is_same_v< std::decay_t< Sink >, NullSink >;
+
+//! \return Size of the image in pixels, read from the header without decoding if possible.
+QSize
+imagePixelSize( const QByteArray & data )
+{
+	QBuffer buf;
+	buf.setData( data );
+	buf.open( QIODevice::ReadOnly );
+
+	QImageReader reader( &buf );
+	auto size = reader.size();
+
+	if( !size.isValid() )
+		size = reader.read().size();
+
+	if( size.isEmpty() )
+		throw PdfRendererError( PdfRenderer::tr( "Unable to read size of image." ) );
+
+	return size;
+}
+
+
+//
+// PagePin
+//
+
+//! Keeps the current page unfinished while the item is drawing.
+class PagePin final {
+public:
+	PagePin( PdfAuxData & pdfData, bool on )
+		:	m_pdfData( pdfData )
+		,	m_on( on )
+	{
+		if( m_on )
+			m_pdfData.pinnedPages.push_back( m_pdfData.currentPageIndex() );
+	}
+
+	~PagePin()
+	{
+		if( m_on )
+			m_pdfData.pinnedPages.removeLast();
+	}
+
+private:
+	PdfAuxData & m_pdfData;
+	bool m_on;
+}; // class PagePin
+
+} /* namespace anonymous */
+
+
 //
 // PdfAuxData
 //
@@ -151,173 +314,776 @@ PdfAuxData::freeSpaceOn( int page )
 	}
 }
 
+int
+PdfAuxData::lowestReachablePage() const
+{
+	if( drawFootnotes )
+	{
+		if( !pinnedPages.isEmpty() && pinnedPages.constFirst() < footnotePageIdx )
+			return pinnedPages.constFirst();
+		else
+			return footnotePageIdx;
+	}
+
+	int idx = currentPageIdx;
+
+	// Footnotes will be drawn on the pages with reserved space at the end.
+	if( !reserved.isEmpty() && static_cast< int > ( reserved.firstKey() ) < idx )
+		idx = static_cast< int > ( reserved.firstKey() );
+
+	// Items are nested, so the outermost one has the lowest page.
+	if( !pinnedPages.isEmpty() && pinnedPages.constFirst() < idx )
+		idx = pinnedPages.constFirst();
+
+	return idx;
+}
+
+Painter &
+PdfAuxData::painter()
+{
+	auto & p = (*context->painters)[ currentPainterIdx ];
+
+	// Painters of finished pages are released, nothing can be drawn there anymore.
+	Q_ASSERT( p );
+
+	if( !p )
+		throw PdfRendererError( PdfRenderer::tr( "Drawing on the finished page %1." )
+			.arg( currentPainterIdx + 1 ) );
+
+	return *p;
+}
+
 void
 PdfAuxData::drawText( double x, double y, const char * text,
 	Font * font, double size, double scale, bool strikeout )
 {
 	firstOnPage = false;
 
-#ifndef MD_PDF_TESTING
-	(*painters)[ currentPainterIdx ]->TextObject.Begin();
-	(*painters)[ currentPainterIdx ]->TextObject.MoveTo( x, y );
-	(*painters)[ currentPainterIdx ]->TextState.SetFont( *font, size );
-	(*painters)[ currentPainterIdx ]->TextState.SetFontScale( scale );
-	const auto st = (*painters)[ currentPainterIdx ]->TextState;
-	(*painters)[ currentPainterIdx ]->TextObject.AddText( text );
-	(*painters)[ currentPainterIdx ]->TextObject.End();
+	// Standard 14 fonts can't draw characters out of WinAnsi.
+	std::string winAnsi;
 
-	if( strikeout )
+	if( font->IsStandard14Font() )
+		text = winAnsiSubset( text, winAnsi );
+
+	const auto bytes = ( context->report ? static_cast< qint64 > ( std::strlen( text ) ) : 0 );
+
+	if( context->report )
+		context->report->countBytes( bytes );
+
+	std::visit( [&] ( auto & s )
+		{
+			if constexpr( c_drawsContent< decltype( s ) > )
+				countContent( bytes + c_operatorSize );
+
+			s.drawText( painter(), x, y, text, font, size, scale, strikeout );
+		}, *context->sink );
+}
+
+std::unique_ptr< Image >
+PdfAuxData::embedImage( const QByteArray & data )
+{
+	return std::visit( [&] ( auto & s ) -> std::unique_ptr< Image >
+		{
+			Q_UNUSED( s )
+
+			if constexpr( c_drawsContent< decltype( s ) > )
+			{
+				auto img = context->doc->CreateImage();
+				img->LoadFromBuffer( { data.data(), static_cast< size_t > ( data.size() ) } );
+
+				return img;
+			}
+			else
+			{
+				// Nothing is drawn in dry run, only the size of the image is estimated.
+				if( context->report )
+					context->report->countBytes( data.size() );
+
+				return {};
+			}
+		}, *context->sink );
+}
+
+void
+PdfAuxData::drawImage( double x, double y, Image * img, double xScale, double yScale )
+{
+	firstOnPage = false;
+
+	std::visit( [&] ( auto & s )
+		{
+			if constexpr( c_drawsContent< decltype( s ) > )
+			{
+				if( context->report )
+				{
+					const auto bytes = static_cast< qint64 > (
+						img->GetObject().MustGetStream().GetLength() );
+
+					context->report->countBytes( bytes );
+					countContent( c_operatorSize );
+					imagesBytes += bytes;
+				}
+			}
+
+			s.drawImage( painter(), x, y, img, xScale, yScale );
+		}, *context->sink );
+}
+
+void
+PdfAuxData::countContent( qint64 bytes )
+{
+	// Called from visited lambdas only for sinks that draw, so dry run is never counted.
+	if( !context->report )
+		return;
+
+	if( contentBytes.size() <= currentPainterIdx )
+		contentBytes.resize( currentPainterIdx + 1 );
+
+	contentBytes[ currentPainterIdx ] += bytes;
+	context->report->addMemory( RenderReport::Memory::Painters, bytes );
+}
+
+void
+PdfAuxData::drawLine( double x1, double y1, double x2, double y2 )
+{
+	std::visit( [&] ( auto & s )
+		{
+			if constexpr( c_drawsContent< decltype( s ) > )
+				countContent( c_operatorSize );
+
+			s.drawLine( painter(), x1, y1, x2, y2 );
+		}, *context->sink );
+}
+
+namespace /* anonymous */ {
+
+//! Re-compress Flate streams with the given level in parallel.
+void
+compressStreams( Document * doc, int level, int threads )
+{
+	QVector< PoDoFo::PdfObjectStream* > streams;
+
+	for( auto * obj : doc->GetObjects() )
 	{
-		(*painters)[ currentPainterIdx ]->Save();
+		auto * stream = obj->GetStream();
 
-		(*painters)[ currentPainterIdx ]->GraphicsState.SetLineWidth( font->GetStrikeThroughThickness( st ) );
+		if( stream && stream->GetFilters().size() == 1 &&
+			stream->GetFilters().front() == PoDoFo::PdfFilterType::FlateDecode &&
+			!obj->GetDictionary().HasKey( "DecodeParms" ) )
+				streams.push_back( stream );
+	}
 
-		(*painters)[ currentPainterIdx ]->DrawLine( x,
-			y + font->GetStrikeThroughPosition( st ),
-			x + font->GetStringLength( text, st ),
-			y + font->GetStrikeThroughPosition( st ) );
+	QThreadPool pool;
+	pool.setMaxThreadCount( threads > 0 ? threads : QThread::idealThreadCount() );
+
+	QVector< QByteArray > data;
+	qsizetype i = 0;
+
+	// Streams are decoded in batches, so only one batch of decoded data is in memory.
+	while( i < streams.size() )
+	{
+		const auto first = i;
+		qint64 bytes = 0;
+		data.clear();
+
+		while( i < streams.size() && ( i == first || bytes < c_compressionBatchBytes ) )
+		{
+			const auto buf = streams[ i++ ]->GetCopy();
+
+			bytes += static_cast< qint64 > ( buf.size() );
+			data.push_back( QByteArray( buf.data(), buf.size() ) );
+		}
 
-		(*painters)[ currentPainterIdx ]->Restore();
+		// Every stream is compressed into its own slot, so output doesn't depend on threads count.
+		for( qsizetype j = 0; j < data.size(); ++j )
+			pool.start( [&data, j, level] ()
+				{
+					// Skip 4 bytes of length that Qt puts before zlib stream.
+					data[ j ] = qCompress( data[ j ], level ).mid( 4 );
+				} );
+
+		pool.waitForDone();
+
+		for( qsizetype j = 0; j < data.size(); ++j )
+			streams[ first + j ]->SetData( PoDoFo::bufferview( data[ j ].constData(),
+				static_cast< size_t > ( data[ j ].size() ) ),
+				{ PoDoFo::PdfFilterType::FlateDecode }, true );
 	}
-#else
-	if( printDrawings )
+}
+
+//! \return Parameters of fonts creation.
+PoDoFo::PdfFontCreateParams
+fontCreateParams( const RenderOpts & opts )
+{
+	PoDoFo::PdfFontCreateParams params;
+
+	// Glyphs are collected on drawing and subsets are built on save.
+	if( opts.m_fullFontEmbedding )
+		params.Flags = PoDoFo::PdfFontCreateFlags::DontSubset;
+
+	return params;
+}
+
+//! Save document with the given options.
+void
+saveDocument( Document * doc, const QString & fileName, const RenderOpts & opts )
+{
+	// Embed fonts before compression to compress them too, save will skip it then.
+	embedFonts( doc );
+
+	if( opts.m_compressionLevel != -1 )
+		compressStreams( doc, opts.m_compressionLevel, opts.m_compressionThreads );
+
+	if( opts.m_useXRefStream )
 	{
-		const auto s = PdfRenderer::createQString( text );
+		// PdfMemDocument::Save() doesn't allow to write XRef stream,
+		// so do the same as it does but with own writer.
+		doc->GetMetadata().SetModifyDate( PoDoFo::PdfDate::LocalNow(), true );
+		doc->CollectGarbage();
 
-		(*drawingsStream) << QStringLiteral(
-			"Text %1 \"%2\" %3 %4 0.0 0.0 0.0 0.0 0.0 0.0\n" )
-				.arg( QString::number( s.length() ), s,
-					QString::number( x, 'f', 16 ),
-					QString::number( y, 'f', 16 ) );
+		PoDoFo::PdfWriter writer( doc->GetObjects(), doc->GetTrailer().GetObject() );
+		writer.SetPdfVersion( doc->GetPdfVersion() );
+		writer.SetUseXRefStream( true );
+
+		PoDoFo::FileStreamDevice device( fileName.toLocal8Bit().data(), PoDoFo::FileMode::Create );
+		writer.Write( device );
 	}
 	else
+		doc->Save( fileName.toLocal8Bit().data() );
+}
+
+
+//! \return Name of the item's type in the page map.
+const char *
+itemTypeName( MD::ItemType t )
+{
+	switch( t )
 	{
-		(*painters)[ currentPainterIdx ]->TextObject.Begin();
-		(*painters)[ currentPainterIdx ]->TextObject.MoveTo( x, y );
-		(*painters)[ currentPainterIdx ]->TextState.SetFont( *font, size );
-		(*painters)[ currentPainterIdx ]->TextState.SetFontScale( scale );
-		const auto st = (*painters)[ currentPainterIdx ]->TextState;
-		(*painters)[ currentPainterIdx ]->TextObject.AddText( text );
-		(*painters)[ currentPainterIdx ]->TextObject.End();
-
-		if( strikeout )
-		{
-			(*painters)[ currentPainterIdx ]->Save();
+		case MD::ItemType::Heading :
+			return "heading";
+
+		case MD::ItemType::Paragraph :
+			return "paragraph";
+
+		case MD::ItemType::Code :
+			return "code";
+
+		case MD::ItemType::Blockquote :
+			return "blockquote";
+
+		case MD::ItemType::List :
+			return "list";
+
+		case MD::ItemType::Table :
+			return "table";
+
+		case MD::ItemType::Footnote :
+			return "footnote";
+
+		default :
+			return "unknown";
+	}
+}
+
+//! \return Block of the page map.
+QJsonObject
+layoutBlock( const PdfAuxData & pdfData, MD::Item< MD::QStringTrait > * item,
+	const QVector< WhereDrawn > & where )
+{
+	QJsonArray places;
 
-			(*painters)[ currentPainterIdx ]->GraphicsState.SetLineWidth( font->GetStrikeThroughThickness( st ) );
+	for( const auto & w : where )
+		places.append( QJsonObject{ { QStringLiteral( "page" ), w.pageIdx + 1 },
+			{ QStringLiteral( "y" ), w.y },
+			{ QStringLiteral( "height" ), w.height } } );
 
-			(*painters)[ currentPainterIdx ]->DrawLine( x,
-				y + font->GetStrikeThroughPosition( st ),
-				x + font->GetStringLength( text, st ),
-				y + font->GetStrikeThroughPosition( st ) );
+	QJsonObject block = {
+		{ QStringLiteral( "type" ), QLatin1String( itemTypeName( item->type() ) ) },
+		{ QStringLiteral( "file" ), pdfData.currentFile },
+		{ QStringLiteral( "startLine" ), item->startLine() + 1 },
+		{ QStringLiteral( "endLine" ), item->endLine() + 1 },
+		{ QStringLiteral( "where" ), places } };
+
+	if( item->type() == MD::ItemType::Heading )
+		block.insert( QStringLiteral( "label" ),
+			static_cast< MD::Heading< MD::QStringTrait >* > ( item )->label() );
+
+	return block;
+}
+
+//! \return Phase of the report for layout of the top-level item, Count if not timed.
+RenderReport::Phase
+blockPhase( MD::ItemType t )
+{
+	switch( t )
+	{
+		case MD::ItemType::Heading :
+			return RenderReport::Phase::Heading;
+
+		case MD::ItemType::Paragraph :
+			return RenderReport::Phase::Paragraph;
+
+		case MD::ItemType::Code :
+			return RenderReport::Phase::Code;
+
+		case MD::ItemType::Blockquote :
+			return RenderReport::Phase::Blockquote;
+
+		case MD::ItemType::List :
+			return RenderReport::Phase::List;
+
+		case MD::ItemType::Table :
+			return RenderReport::Phase::Table;
+
+		default :
+			return RenderReport::Phase::Count;
+	}
+}
+
+//! \return Count of images in the document.
+qint64
+imagesCount( Document * doc )
+{
+	qint64 count = 0;
+
+	for( const auto * obj : doc->GetObjects() )
+	{
+		if( obj->IsDictionary() )
+		{
+			const auto * subtype = obj->GetDictionary().FindKey( "Subtype" );
 
-			(*painters)[ currentPainterIdx ]->Restore();
+			if( subtype && subtype->IsName() && subtype->GetName() == "Image" )
+				++count;
 		}
+	}
+
+	return count;
+}
+
+//! \return Estimated size of the block of Markdown in bytes.
+qint64
+blockMemory( MD::Block< MD::QStringTrait > * b )
+{
+	qint64 bytes = c_mdItemSize;
+
+	for( const auto & item : b->items() )
+	{
+		bytes += c_mdItemSize;
 
-		if( QTest::currentTestFailed() )
-			self->terminate();
+		switch( item->type() )
+		{
+			case MD::ItemType::Text :
+				bytes += static_cast< MD::Text< MD::QStringTrait >* > (
+					item.get() )->text().size() * 2;
+				break;
 
-		int pos = testPos++;
-		QCOMPARE( DrawPrimitive::Type::Text, testData.at( pos ).type );
-		QCOMPARE( PdfRenderer::createQString( text ), testData.at( pos ).text );
-		QCOMPARE( x, testData.at( pos ).x );
-		QCOMPARE( y, testData.at( pos ).y );
+			case MD::ItemType::Code :
+				bytes += static_cast< MD::Code< MD::QStringTrait >* > (
+					item.get() )->text().size() * 2;
+				break;
+
+			case MD::ItemType::Math :
+				bytes += static_cast< MD::Math< MD::QStringTrait >* > (
+					item.get() )->expr().size() * 2;
+				break;
+
+			case MD::ItemType::Image :
+				bytes += static_cast< MD::Image< MD::QStringTrait >* > (
+					item.get() )->url().size() * 2;
+				break;
+
+			case MD::ItemType::Link :
+			{
+				auto * l = static_cast< MD::Link< MD::QStringTrait >* > ( item.get() );
+
+				bytes += l->url().size() * 2;
+
+				if( l->p() )
+					bytes += blockMemory( l->p().get() );
+			}
+				break;
+
+			case MD::ItemType::Heading :
+			{
+				auto * h = static_cast< MD::Heading< MD::QStringTrait >* > ( item.get() );
+
+				if( h->text() )
+					bytes += blockMemory( h->text().get() );
+			}
+				break;
+
+			case MD::ItemType::Table :
+			{
+				for( const auto & r : static_cast< MD::Table< MD::QStringTrait >* > (
+					item.get() )->rows() )
+				{
+					for( const auto & c : r->cells() )
+						bytes += blockMemory( c.get() );
+				}
+			}
+				break;
+
+			default :
+			{
+				auto * cb = dynamic_cast< MD::Block< MD::QStringTrait >* > ( item.get() );
+
+				if( cb )
+					bytes += blockMemory( cb );
+			}
+				break;
+		}
 	}
-#endif // MD_PDF_TESTING
+
+	return bytes;
 }
 
+//! \return Estimated size of the parsed Markdown in bytes.
+qint64
+documentMemory( std::shared_ptr< MD::Document< MD::QStringTrait > > doc )
+{
+	qint64 bytes = blockMemory( doc.get() );
+
+	for( const auto & f : doc->footnotesMap() )
+		bytes += blockMemory( f.second.get() );
+
+	return bytes;
+}
+
+} /* namespace anonymous */
+
+
+//
+// PainterSink
+//
+
 void
-PdfAuxData::drawImage( double x, double y, Image * img, double xScale, double yScale )
+PainterSink::drawText( Painter & p, double x, double y, const char * text, Font * font,
+	double size, double scale, bool strikeout )
 {
-	firstOnPage = false;
+	p.TextObject.Begin();
+	p.TextObject.MoveTo( x, y );
+	p.TextState.SetFont( *font, size );
+	p.TextState.SetFontScale( scale );
+	const auto st = p.TextState;
+	p.TextObject.AddText( text );
+	p.TextObject.End();
 
-#ifndef MD_PDF_TESTING
-	(*painters)[ currentPainterIdx ]->DrawImage( *img, x, y, xScale, yScale );
-#else
-	if( printDrawings )
-		(*drawingsStream) << QStringLiteral(
-			"Image 0 \"\" %2 %3 0.0 0.0 0.0 0.0 %4 %5\n" )
-				.arg( QString::number( x, 'f', 16 ), QString::number( y, 'f', 16 ),
-					QString::number( xScale, 'f', 16 ), QString::number( yScale, 'f', 16 ) );
-	else
+	if( strikeout )
 	{
-		(*painters)[ currentPainterIdx ]->DrawImage( *img, x, y, xScale, yScale );
+		p.Save();
 
-		if( QTest::currentTestFailed() )
-			self->terminate();
+		p.GraphicsState.SetLineWidth( font->GetStrikeThroughThickness( st ) );
 
-		int pos = testPos++;
-		QCOMPARE( x, testData.at( pos ).x );
-		QCOMPARE( y, testData.at( pos ).y );
-		QCOMPARE( xScale, testData.at( pos ).xScale );
-		QCOMPARE( yScale, testData.at( pos ).yScale );
+		p.DrawLine( x,
+			y + font->GetStrikeThroughPosition( st ),
+			x + font->GetStringLength( text, st ),
+			y + font->GetStrikeThroughPosition( st ) );
+
+		p.Restore();
 	}
-#endif // MD_PDF_TESTING
 }
 
 void
-PdfAuxData::drawLine( double x1, double y1, double x2, double y2 )
+PainterSink::drawImage( Painter & p, double x, double y, Image * img, double xScale, double yScale )
 {
-#ifndef MD_PDF_TESTING
-	(*painters)[ currentPainterIdx ]->DrawLine( x1, y1, x2, y2 );
-#else
-	if( printDrawings )
-		(*drawingsStream) << QStringLiteral(
-			"Line 0 \"\" %1 %2 %3 %4 0.0 0.0 0.0 0.0\n" )
-				.arg( QString::number( x1, 'f', 16 ), QString::number( y1, 'f', 16 ),
-					QString::number( x2, 'f', 16 ), QString::number( y2, 'f', 16 ) );
-	else
-	{
-		(*painters)[ currentPainterIdx ]->DrawLine( x1, y1, x2, y2 );
+	p.DrawImage( *img, x, y, xScale, yScale );
+}
+
+void
+PainterSink::drawLine( Painter & p, double x1, double y1, double x2, double y2 )
+{
+	p.DrawLine( x1, y1, x2, y2 );
+}
+
+void
+PainterSink::drawRectangle( Painter & p, double x, double y, double width, double height,
+	PoDoFo::PdfPathDrawMode m )
+{
+	p.DrawRectangle( x, y, width, height, m );
+}
+
+void
+PainterSink::drawCircle( Painter & p, double x, double y, double r, PoDoFo::PdfPathDrawMode m )
+{
+	p.DrawCircle( x, y, r, m );
+}
+
+void
+PainterSink::setColor( Painter & p, const QColor & c )
+{
+	p.GraphicsState.SetFillColor( Color( c.redF(), c.greenF(), c.blueF() ) );
+	p.GraphicsState.SetStrokeColor( Color( c.redF(), c.greenF(), c.blueF() ) );
+}
+
+void
+PainterSink::save( Document * doc, const QString & fileName, const RenderOpts & opts )
+{
+	saveDocument( doc, fileName, opts );
+}
+
+
+//
+// RecordingSink
+//
+
+RecordingSink::RecordingSink( const QString & fileName )
+	:	m_writer( fileName )
+{
+}
+
+bool
+RecordingSink::open()
+{
+	return m_writer.open();
+}
+
+quint32
+RecordingSink::pageIndex( const Painter & p )
+{
+	return static_cast< const Page* > ( p.GetCanvas() )->GetIndex();
+}
+
+void
+RecordingSink::drawText( Painter & p, double x, double y, const char * text, Font * font,
+	double size, double scale, bool strikeout )
+{
+	PainterSink::drawText( p, x, y, text, font, size, scale, strikeout );
+
+	m_writer.drawText( pageIndex( p ), x, y, text, font, size, scale, strikeout );
+}
+
+void
+RecordingSink::drawImage( Painter & p, double x, double y, Image * img, double xScale, double yScale )
+{
+	PainterSink::drawImage( p, x, y, img, xScale, yScale );
+
+	m_writer.drawImage( pageIndex( p ), x, y, img, xScale, yScale );
+}
+
+void
+RecordingSink::drawLine( Painter & p, double x1, double y1, double x2, double y2 )
+{
+	PainterSink::drawLine( p, x1, y1, x2, y2 );
+
+	m_writer.drawLine( pageIndex( p ), x1, y1, x2, y2 );
+}
+
+void
+RecordingSink::drawRectangle( Painter & p, double x, double y, double width, double height,
+	PoDoFo::PdfPathDrawMode m )
+{
+	PainterSink::drawRectangle( p, x, y, width, height, m );
+
+	m_writer.drawRectangle( pageIndex( p ), x, y, width, height, m );
+}
+
+void
+RecordingSink::drawCircle( Painter & p, double x, double y, double r, PoDoFo::PdfPathDrawMode m )
+{
+	PainterSink::drawCircle( p, x, y, r, m );
+
+	m_writer.drawCircle( pageIndex( p ), x, y, r, m );
+}
+
+void
+RecordingSink::setColor( Painter & p, const QColor & c )
+{
+	PainterSink::setColor( p, c );
+
+	m_writer.setColor( pageIndex( p ), c.redF(), c.greenF(), c.blueF() );
+}
+
+void
+RecordingSink::save( Document * doc, const QString & fileName, const RenderOpts & opts )
+{
+	const auto & pages = doc->GetPages();
+	const auto rect = ( pages.GetCount() ? pages.GetPageAt( 0 ).GetRect() : Rect() );
+
+	if( !m_writer.finish( pages.GetCount(), rect.Width, rect.Height ) )
+		throw PdfRendererError( PdfRenderer::tr( "Unable to write trace of drawing." ) );
+
+	PainterSink::save( doc, fileName, opts );
+}
+
+#ifdef MD_PDF_TESTING
+
+//
+// PrintingSink
+//
+
+PrintingSink::PrintingSink( const QString & fileName )
+	:	m_file( fileName )
+{
+}
+
+bool
+PrintingSink::open()
+{
+	if( !m_file.open( QIODevice::WriteOnly ) )
+		return false;
+
+	m_stream.setDevice( &m_file );
+
+	return true;
+}
+
+void
+PrintingSink::drawText( Painter &, double x, double y, const char * text, Font *,
+	double, double, bool )
+{
+	const auto s = PdfRenderer::createQString( text );
+
+	m_stream << QStringLiteral(
+		"Text %1 \"%2\" %3 %4 0.0 0.0 0.0 0.0 0.0 0.0\n" )
+			.arg( QString::number( s.length() ), s,
+				QString::number( x, 'f', 16 ),
+				QString::number( y, 'f', 16 ) );
+}
+
+void
+PrintingSink::drawImage( Painter &, double x, double y, Image *, double xScale, double yScale )
+{
+	m_stream << QStringLiteral(
+		"Image 0 \"\" %2 %3 0.0 0.0 0.0 0.0 %4 %5\n" )
+			.arg( QString::number( x, 'f', 16 ), QString::number( y, 'f', 16 ),
+				QString::number( xScale, 'f', 16 ), QString::number( yScale, 'f', 16 ) );
+}
+
+void
+PrintingSink::drawLine( Painter &, double x1, double y1, double x2, double y2 )
+{
+	m_stream << QStringLiteral(
+		"Line 0 \"\" %1 %2 %3 %4 0.0 0.0 0.0 0.0\n" )
+			.arg( QString::number( x1, 'f', 16 ), QString::number( y1, 'f', 16 ),
+				QString::number( x2, 'f', 16 ), QString::number( y2, 'f', 16 ) );
+}
+
+void
+PrintingSink::drawRectangle( Painter &, double x, double y, double width, double height,
+	PoDoFo::PdfPathDrawMode )
+{
+	m_stream << QStringLiteral(
+		"Rectangle 0 \"\" %1 %2 0.0 0.0 %3 %4 0.0 0.0\n" )
+			.arg( QString::number( x, 'f', 16 ), QString::number( y, 'f', 16 ),
+				QString::number( width, 'f', 16 ), QString::number( height, 'f', 16 ) );
+}
+
+void
+PrintingSink::save( Document *, const QString &, const RenderOpts & )
+{
+	m_stream.flush();
+	m_file.close();
+}
+
+
+//
+// VerifyingSink
+//
+
+VerifyingSink::VerifyingSink( const QVector< DrawPrimitive > & data, PdfRenderer * self )
+	:	m_data( data )
+	,	m_self( self )
+{
+}
+
+bool
+VerifyingSink::isFinished() const
+{
+	return m_pos == m_data.size();
+}
+
+void
+VerifyingSink::drawText( Painter & p, double x, double y, const char * text, Font * font,
+	double size, double scale, bool strikeout )
+{
+	PainterSink::drawText( p, x, y, text, font, size, scale, strikeout );
+
+	if( QTest::currentTestFailed() )
+		m_self->terminate();
+
+	int pos = m_pos++;
+	QCOMPARE( DrawPrimitive::Type::Text, m_data.at( pos ).type );
+	QCOMPARE( PdfRenderer::createQString( text ), m_data.at( pos ).text );
+	QCOMPARE( x, m_data.at( pos ).x );
+	QCOMPARE( y, m_data.at( pos ).y );
+}
+
+void
+VerifyingSink::drawImage( Painter & p, double x, double y, Image * img, double xScale, double yScale )
+{
+	PainterSink::drawImage( p, x, y, img, xScale, yScale );
+
+	if( QTest::currentTestFailed() )
+		m_self->terminate();
+
+	int pos = m_pos++;
+	QCOMPARE( x, m_data.at( pos ).x );
+	QCOMPARE( y, m_data.at( pos ).y );
+	QCOMPARE( xScale, m_data.at( pos ).xScale );
+	QCOMPARE( yScale, m_data.at( pos ).yScale );
+}
+
+void
+VerifyingSink::drawLine( Painter & p, double x1, double y1, double x2, double y2 )
+{
+	PainterSink::drawLine( p, x1, y1, x2, y2 );
+
+	if( QTest::currentTestFailed() )
+		m_self->terminate();
+
+	int pos = m_pos++;
+	QCOMPARE( x1, m_data.at( pos ).x );
+	QCOMPARE( y1, m_data.at( pos ).y );
+	QCOMPARE( x2, m_data.at( pos ).x2 );
+	QCOMPARE( y2, m_data.at( pos ).y2 );
+}
+
+void
+VerifyingSink::drawRectangle( Painter & p, double x, double y, double width, double height,
+	PoDoFo::PdfPathDrawMode m )
+{
+	PainterSink::drawRectangle( p, x, y, width, height, m );
 
-		if( QTest::currentTestFailed() )
-			self->terminate();
+	if( QTest::currentTestFailed() )
+		m_self->terminate();
 
-		int pos = testPos++;
-		QCOMPARE( x1, testData.at( pos ).x );
-		QCOMPARE( y1, testData.at( pos ).y );
-		QCOMPARE( x2, testData.at( pos ).x2 );
-		QCOMPARE( y2, testData.at( pos ).y2 );
-	}
-#endif // MD_PDF_TESTING
+	int pos = m_pos++;
+	QCOMPARE( x, m_data.at( pos ).x );
+	QCOMPARE( y, m_data.at( pos ).y );
+	QCOMPARE( width, m_data.at( pos ).width );
+	QCOMPARE( height, m_data.at( pos ).height );
 }
 
+#endif // MD_PDF_TESTING
+
 void
-PdfAuxData::save( const QString & fileName )
+PdfAuxData::save( const QString & fileName, const RenderOpts & opts )
 {
-#ifndef MD_PDF_TESTING
-	doc->Save( fileName.toLocal8Bit().data() );
-#else
-	if( !printDrawings )
-		doc->Save( fileName.toLocal8Bit().data() );
-#endif // MD_PDF_TESTING
+	std::visit( [&] ( auto & s ) { s.save( context->doc, fileName, opts ); }, *context->sink );
 }
 
 void
 PdfAuxData::drawRectangle( double x, double y, double width, double height, PoDoFo::PdfPathDrawMode m )
 {
-#ifndef MD_PDF_TESTING
-	(*painters)[ currentPainterIdx ]->DrawRectangle( x, y, width, height, m );
-#else
-	if( printDrawings )
-		(*drawingsStream) << QStringLiteral(
-			"Rectangle 0 \"\" %1 %2 0.0 0.0 %3 %4 0.0 0.0\n" )
-				.arg( QString::number( x, 'f', 16 ), QString::number( y, 'f', 16 ),
-					QString::number( width, 'f', 16 ), QString::number( height, 'f', 16 ) );
-	else
-	{
-		(*painters)[ currentPainterIdx ]->DrawRectangle( x, y, width, height, m );
+	std::visit( [&] ( auto & s )
+		{
+			if constexpr( c_drawsContent< decltype( s ) > )
+				countContent( c_operatorSize );
 
-		if( QTest::currentTestFailed() )
-			self->terminate();
+			s.drawRectangle( painter(), x, y, width, height, m );
+		}, *context->sink );
+}
 
-		int pos = testPos++;
-		QCOMPARE( x, testData.at( pos ).x );
-		QCOMPARE( y, testData.at( pos ).y );
-		QCOMPARE( width, testData.at( pos ).width );
-		QCOMPARE( height, testData.at( pos ).height );
-	}
-#endif // MD_PDF_TESTING
+void
+PdfAuxData::drawCircle( double x, double y, double r, PoDoFo::PdfPathDrawMode m )
+{
+	// Circle is drawn with four Bezier curves.
+	std::visit( [&] ( auto & s )
+		{
+			if constexpr( c_drawsContent< decltype( s ) > )
+				countContent( c_operatorSize * 4 );
+
+			s.drawCircle( painter(), x, y, r, m );
+		}, *context->sink );
 }
 
 void
@@ -325,8 +1091,8 @@ PdfAuxData::setColor( const QColor & c )
 {
 	colorsStack.push( c );
 
-	(*painters)[ currentPainterIdx ]->GraphicsState.SetFillColor( Color( c.redF(), c.greenF(), c.blueF() ) );
-	(*painters)[ currentPainterIdx ]->GraphicsState.SetStrokeColor( Color( c.redF(), c.greenF(), c.blueF() ) );
+	std::visit( [&] ( auto & s ) { s.setColor( painter(), c ); },
+		*context->sink );
 }
 
 void
@@ -341,27 +1107,28 @@ PdfAuxData::restoreColor()
 void
 PdfAuxData::repeatColor()
 {
-	const auto & c = colorsStack.top();
-
-	(*painters)[ currentPainterIdx ]->GraphicsState.SetFillColor( Color( c.redF(), c.greenF(), c.blueF() ) );
-	(*painters)[ currentPainterIdx ]->GraphicsState.SetStrokeColor( Color( c.redF(), c.greenF(), c.blueF() ) );
-}
-
-double
-PdfAuxData::imageWidth( const QByteArray & image )
-{
-	auto pdfImg = doc->CreateImage();
-	pdfImg->LoadFromBuffer( { image.data(), static_cast< size_t > ( image.size() ) } );
-
-	return std::round( (double) pdfImg->GetWidth() / (double) dpi * 72.0 );
+	std::visit( [&] ( auto & s )
+		{
+			s.setColor( painter(), colorsStack.top() );
+		}, *context->sink );
 }
 
 double
 PdfAuxData::stringWidth( Font * font, double size, double scale, const String & s ) const
 {
+	if( context->report )
+		context->report->count( RenderReport::Counter::StringWidth );
+
 	PoDoFo::PdfTextState st;
 	st.FontSize = size * scale;
 
+	if( font->IsStandard14Font() )
+	{
+		std::string winAnsi;
+
+		return font->GetStringLength( winAnsiSubset( s, winAnsi ), st );
+	}
+
 	return font->GetStringLength( s, st );
 }
 
@@ -406,6 +1173,19 @@ PdfRenderer::CustomWidth::firstItemHeight() const
 		return 0.0;
 }
 
+qint64
+PdfRenderer::CustomWidth::memoryUsage() const
+{
+	qint64 bytes = m_width.capacity() * sizeof( Width ) +
+		( m_scale.capacity() + m_height.capacity() + m_descent.capacity() ) * sizeof( double ) +
+		m_images.capacity() * sizeof( bool );
+
+	for( const auto & w : m_width )
+		bytes += w.word.capacity() * 2;
+
+	return bytes;
+}
+
 void
 PdfRenderer::CustomWidth::calcScale( double lineWidth )
 {
@@ -459,37 +1239,164 @@ PdfRenderer::CustomWidth::calcScale( double lineWidth )
 
 
 //
-// PdfRenderer::CellItem
+// PdfRenderer::GlyphWidths
 //
 
+namespace /* anonymous */ {
+
+//! Call \p f for every code point of the string.
+template< typename Func >
+void
+forEachCodePoint( QStringView s, Func f )
+{
+	for( qsizetype i = 0, size = s.size(); i < size; ++i )
+	{
+		const auto ch = s.at( i );
+
+		if( ch.isHighSurrogate() && i + 1 < size && s.at( i + 1 ).isLowSurrogate() )
+		{
+			f( QChar::surrogateToUcs4( ch, s.at( i + 1 ) ) );
+			++i;
+		}
+		else
+			f( static_cast< char32_t > ( ch.unicode() ) );
+	}
+}
+
+} /* namespace anonymous */
+
+void
+PdfRenderer::GlyphWidths::add( QStringView s, const PdfAuxData & pdfData )
+{
+	forEachCodePoint( s, [&] ( char32_t c )
+		{
+			if( c >= ascii.size() && !other.contains( c ) )
+				other.insert( c, pdfData.stringWidth( pdfFont, size, scale,
+					createUtf8String( QString::fromUcs4( &c, 1 ) ) ) );
+		} );
+}
+
 double
-PdfRenderer::CellItem::width( PdfAuxData & pdfData, PdfRenderer * render, double scale ) const
+PdfRenderer::GlyphWidths::width( QStringView s ) const
 {
-	auto * f = render->createFont( font.family, font.bold, font.italic,
-		font.size, pdfData.doc, scale, pdfData );
-
-	if( !word.isEmpty() )
-		return pdfData.stringWidth( f, font.size, scale, createUtf8String( word ) );
-	else if( !image.isNull() )
-		return pdfData.imageWidth( image );
-	else if( !url.isEmpty() )
-		return pdfData.stringWidth( f, font.size, scale, createUtf8String( url ) );
-	else if( !footnote.isEmpty() )
-		return pdfData.stringWidth( f, font.size * c_footnoteScale, scale, createUtf8String( footnote ) );
-	else
-		return 0.0;
+	// Width of the string is the sum of widths of its glyphs.
+	double w = 0.0;
+
+	forEachCodePoint( s, [&] ( char32_t c )
+		{
+			w += ( c < ascii.size() ? ascii[ c ] : other.value( c ) );
+		} );
+
+	return w;
+}
+
+const PdfRenderer::GlyphWidths &
+PdfRenderer::GlyphWidths::find( const QVector< GlyphWidths > & glyphs,
+	quint16 font, double size )
+{
+	for( const auto & g : glyphs )
+	{
+		if( g.size == size && g.font == font )
+			return g;
+	}
+
+	Q_UNREACHABLE();
+
+	return glyphs.front();
 }
 
 
 //
-// PdfRenderer::CellData
+// PdfRenderer::AuxTable
 //
 
+PdfRenderer::AuxTable::Span
+PdfRenderer::AuxTable::addString( const QString & s )
+{
+	const Span span = { static_cast< qint32 > ( text.size() ), static_cast< qint32 > ( s.size() ) };
+
+	text.append( s );
+
+	return span;
+}
+
+quint16
+PdfRenderer::AuxTable::addFont( const FontAttribs & font )
+{
+	const auto idx = fonts.indexOf( font );
+
+	if( idx != -1 )
+		return static_cast< quint16 > ( idx );
+
+	fonts.append( font );
+
+	return static_cast< quint16 > ( fonts.size() - 1 );
+}
+
+quint16
+PdfRenderer::AuxTable::addColor( const QColor & color )
+{
+	if( !color.isValid() )
+		return 0;
+
+	const auto idx = colors.indexOf( color );
+
+	if( idx != -1 )
+		return static_cast< quint16 > ( idx );
+
+	colors.append( color );
+
+	return static_cast< quint16 > ( colors.size() - 1 );
+}
+
+double
+PdfRenderer::AuxTable::itemWidth( const Item & item, PdfAuxData & pdfData, PdfRenderer * render,
+	double scale ) const
+{
+	if( item.isImage() )
+		return imagesSizes.at( item.image ).width();
+
+	const auto & font = fonts.at( item.font );
+
+	auto * f = render->createFont( font.family, font.bold, font.italic,
+		font.size, pdfData.context->doc, scale, pdfData );
+
+	if( !item.word.isEmpty() )
+		return pdfData.stringWidth( f, font.size, scale, createUtf8String( string( item.word ) ) );
+	else if( !item.url.isEmpty() )
+		return pdfData.stringWidth( f, font.size, scale, createUtf8String( string( item.url ) ) );
+	else if( !item.footnote.isEmpty() )
+		return pdfData.stringWidth( f, font.size * c_footnoteScale, scale,
+			createUtf8String( string( item.footnote ) ) );
+	else
+		return 0.0;
+}
+
+double
+PdfRenderer::AuxTable::itemWidth( const Item & item, const QVector< GlyphWidths > & glyphs ) const
+{
+	if( item.isImage() )
+		return imagesSizes.at( item.image ).width();
+
+	const auto size = fonts.at( item.font ).size;
+
+	if( !item.word.isEmpty() )
+		return GlyphWidths::find( glyphs, item.font, size ).width( view( item.word ) );
+	else if( !item.url.isEmpty() )
+		return GlyphWidths::find( glyphs, item.font, size ).width( view( item.url ) );
+	else if( !item.footnote.isEmpty() )
+		return GlyphWidths::find( glyphs, item.font, size * c_footnoteScale ).width(
+			view( item.footnote ) );
+	else
+		return 0.0;
+}
+
 void
-PdfRenderer::CellData::heightToWidth( double lineHeight, double spaceWidth, double scale,
-	PdfAuxData & pdfData, PdfRenderer * render )
+PdfRenderer::AuxTable::heightToWidth( int cell, double lineHeight, double spaceWidth, double scale )
 {
-	height = 0.0;
+	const auto width = widths.at( cell % columnsCount );
+
+	double height = 0.0;
 
 	bool newLine = true;
 
@@ -497,9 +1404,10 @@ PdfRenderer::CellData::heightToWidth( double lineHeight, double spaceWidth, doub
 
 	bool addMargin = false;
 
-	for( auto it = items.cbegin(), last = items.cend(); it != last; ++it )
+	for( auto it = items.cbegin() + cells.at( cell ), first = it,
+		last = items.cbegin() + cells.at( cell + 1 ); it != last; ++it )
 	{
-		if( it->image.isNull() )
+		if( !it->isImage() )
 		{
 			addMargin = false;
 
@@ -510,7 +1418,7 @@ PdfRenderer::CellData::heightToWidth( double lineHeight, double spaceWidth, doub
 				w = 0.0;
 			}
 
-			w += it->width( pdfData, render, scale );
+			w += it->width;
 
 			if( w >= width )
 			{
@@ -520,17 +1428,15 @@ PdfRenderer::CellData::heightToWidth( double lineHeight, double spaceWidth, doub
 
 			double sw = spaceWidth;
 
-			if( it != items.cbegin() && it->font != ( it - 1 )->font )
-				sw = pdfData.stringWidth( render->createFont( it->font.family,
-						it->font.bold, it->font.italic, it->font.size, pdfData.doc, scale, pdfData ),
-					it->font.size, scale, String( " " ) );
+			if( it != first && it->font != ( it - 1 )->font )
+				sw = spaceWidths.at( it->font );
 
 			if( it + 1 != last && !( it + 1 )->footnote.isEmpty() )
 				sw = 0.0;
 
 			if( it + 1 != last )
 			{
-				if( w + sw + ( it + 1 )->width( pdfData, render, scale ) > width )
+				if( w + sw + ( it + 1 )->width > width )
 					newLine = true;
 				else
 				{
@@ -541,19 +1447,12 @@ PdfRenderer::CellData::heightToWidth( double lineHeight, double spaceWidth, doub
 		}
 		else
 		{
-			auto pdfImg = pdfData.doc->CreateImage();
-			pdfImg->LoadFromBuffer( { it->image.data(),
-				static_cast< size_t > ( it->image.size() ) } );
-
-			const double iWidth = std::round( (double) pdfImg->GetWidth() /
-				(double) pdfData.dpi * 72.0 );
-			const double iHeight = std::round( (double) pdfImg->GetHeight() /
-				(double) pdfData.dpi * 72.0 );
+			const auto & size = imagesSizes.at( it->image );
 
-			if( iWidth > width )
-				height += iHeight / ( iWidth / width ) * scale;
+			if( size.width() > width )
+				height += size.height() / ( size.width() / width ) * scale;
 			else
-				height += iHeight * scale;
+				height += size.height() * scale;
 
 			newLine = true;
 
@@ -566,6 +1465,49 @@ PdfRenderer::CellData::heightToWidth( double lineHeight, double spaceWidth, doub
 		if( addMargin )
 			height += c_tableMargin;
 	}
+
+	heights[ cell ] = height;
+}
+
+double
+PdfRenderer::AuxTable::rowHeight( int row ) const
+{
+	double h = 0.0;
+
+	const auto first = heights.cbegin() + row * columnsCount;
+
+	for( auto it = first, last = first + columnsCount; it != last; ++it )
+	{
+		if( *it > h )
+			h = *it;
+	}
+
+	return h;
+}
+
+qint64
+PdfRenderer::AuxTable::memoryUsage() const
+{
+	qint64 bytes = sizeof( AuxTable ) +
+		alignments.capacity() * sizeof( MD::Table< MD::QStringTrait >::Alignment ) +
+		( widths.capacity() + heights.capacity() + spaceWidths.capacity() ) * sizeof( double ) +
+		cells.capacity() * sizeof( qint32 ) + items.capacity() * sizeof( Item ) +
+		text.capacity() * 2 + fonts.capacity() * sizeof( FontAttribs ) +
+		colors.capacity() * sizeof( QColor ) + images.capacity() * sizeof( QByteArray ) +
+		imagesSizes.capacity() * sizeof( QSizeF ) +
+		footnotes.capacity() * sizeof( QPair< QString,
+			std::shared_ptr< MD::Footnote< MD::QStringTrait > > > );
+
+	for( const auto & f : fonts )
+		bytes += f.family.capacity() * 2;
+
+	for( const auto & i : images )
+		bytes += i.capacity();
+
+	for( const auto & f : footnotes )
+		bytes += f.first.capacity() * 2;
+
+	return bytes;
 }
 
 
@@ -574,12 +1516,17 @@ PdfRenderer::CellData::heightToWidth( double lineHeight, double spaceWidth, doub
 //
 
 PdfRenderer::PdfRenderer()
-	:	m_terminate( false )
+	:	m_recursive( false )
+	,	m_terminate( false )
 	,	m_footnoteNum( 1 )
 #ifdef MD_PDF_TESTING
 	,	m_isError( false )
 #endif
 {
+	// ImageMagick should be initialized once in the process before any use.
+	static std::once_flag magick;
+	std::call_once( magick, [] () { Magick::InitializeMagick( nullptr ); } );
+
 	connect( this, &PdfRenderer::start, this, &PdfRenderer::renderImpl,
 		Qt::QueuedConnection );
 }
@@ -597,6 +1544,30 @@ PdfRenderer::render( const QString & fileName,
 		emit start();
 }
 
+void
+PdfRenderer::renderFile( const QString & fileName, const QString & markdownFileName, bool recursive,
+	const RenderOpts & opts )
+{
+	m_fileName = fileName;
+	m_markdownFileName = markdownFileName;
+	m_recursive = recursive;
+	m_opts = opts;
+
+	emit start();
+}
+
+void
+PdfRenderer::renderFileNow( const QString & fileName, const QString & markdownFileName,
+	bool recursive, const RenderOpts & opts )
+{
+	m_fileName = fileName;
+	m_markdownFileName = markdownFileName;
+	m_recursive = recursive;
+	m_opts = opts;
+
+	renderImpl();
+}
+
 void
 PdfRenderer::terminate()
 {
@@ -620,76 +1591,190 @@ PdfRenderer::isError() const
 void
 PdfRenderer::renderImpl()
 {
+	PdfRenderContext context;
+	context.report = &m_report;
+
 	PdfAuxData pdfData;
+	pdfData.context = &context;
 
-	try
+	// Render may be terminated while it's waiting in a queue.
 	{
-		const int itemsCount = m_doc->items().size();
+		QMutexLocker lock( &m_mutex );
+
+		if( m_terminate )
+		{
+			emit done( true );
+
+			deleteLater();
 
+			return;
+		}
+	}
+
+	QElapsedTimer total;
+	total.start();
+
+	if( !m_opts.m_timelineFileName.isEmpty() )
+		m_timeline.enable();
+
+	try
+	{
 		emit progress( 0 );
-		emit status( tr( "Rendering PDF..." ) );
 
-		Document document;
+		std::future< std::shared_ptr< MD::Document< MD::QStringTrait > > > parsing;
+
+		if( !m_doc )
+		{
+			emit status( tr( "Parsing Markdown..." ) );
+
+			using Parsed = std::promise< std::shared_ptr< MD::Document< MD::QStringTrait > > >;
+
+			auto promise = std::make_shared< Parsed > ();
+			parsing = promise->get_future();
+
+			// Fonts and first page are prepared while parsing. Parser can't be interrupted,
+			// so it doesn't touch the renderer, that may stop waiting for it.
+			QThreadPool::globalInstance()->start(
+				[promise, fileName = m_markdownFileName, recursive = m_recursive] ()
+				{
+					try {
+						MD::Parser< MD::QStringTrait > parser;
+
+						promise->set_value( parser.parse( fileName, recursive ) );
+					}
+					catch( ... )
+					{
+						promise->set_exception( std::current_exception() );
+					}
+				} );
+		}
+		else
+			emit status( tr( "Rendering PDF..." ) );
+
+		// Fonts of document should be destroyed under the lock.
+		std::unique_ptr< Document, DocumentDeleter > document( new Document );
 		std::vector< std::shared_ptr< Painter > > painters;
 
-		pdfData.doc = &document;
-		pdfData.painters = &painters;
+		pdfData.context->doc = document.get();
+		pdfData.context->painters = &painters;
 
 		pdfData.coords.margins.left = m_opts.m_left;
 		pdfData.coords.margins.right = m_opts.m_right;
 		pdfData.coords.margins.top = m_opts.m_top;
 		pdfData.coords.margins.bottom = m_opts.m_bottom;
-		pdfData.dpi = m_opts.m_dpi;
-		pdfData.syntax = m_opts.m_syntax;
+		pdfData.context->dpi = m_opts.m_dpi;
+		pdfData.context->syntax = m_opts.m_syntax;
 
 		pdfData.colorsStack.push( Qt::black );
 
-		pdfData.md = m_doc;
+#ifdef MD_PDF_TESTING
+		pdfData.context->fonts[ QStringLiteral( "Droid Serif" ) ] = c_font;
+		pdfData.context->fonts[ QStringLiteral( "Droid Serif Bold" ) ] = c_boldFont;
+		pdfData.context->fonts[ QStringLiteral( "Droid Serif Italic" ) ] = c_italicFont;
+		pdfData.context->fonts[ QStringLiteral( "Droid Serif Bold Italic" ) ] = c_boldItalicFont;
+		pdfData.context->fonts[ QStringLiteral( "Courier New" ) ] = c_monoFont;
+		pdfData.context->fonts[ QStringLiteral( "Courier New Italic" ) ] = c_monoItalicFont;
+		pdfData.context->fonts[ QStringLiteral( "Courier New Bold" ) ] = c_monoBoldFont;
+		pdfData.context->fonts[ QStringLiteral( "Courier New Bold Italic" ) ] = c_monoBoldItalicFont;
+#endif // MD_PDF_TESTING
 
+		DrawSink sink;
+
+		if( m_opts.m_dryRun )
+			sink.emplace< NullSink > ();
+		else if( !m_opts.m_traceFileName.isEmpty() )
+		{
+			if( !sink.emplace< RecordingSink > ( m_opts.m_traceFileName ).open() )
+				throw PdfRendererError( tr( "Unable to open file for trace of drawing: %1." )
+					.arg( m_opts.m_traceFileName ) );
+		}
 #ifdef MD_PDF_TESTING
-		pdfData.fonts[ QStringLiteral( "Droid Serif" ) ] = c_font;
-		pdfData.fonts[ QStringLiteral( "Droid Serif Bold" ) ] = c_boldFont;
-		pdfData.fonts[ QStringLiteral( "Droid Serif Italic" ) ] = c_italicFont;
-		pdfData.fonts[ QStringLiteral( "Droid Serif Bold Italic" ) ] = c_boldItalicFont;
-		pdfData.fonts[ QStringLiteral( "Courier New" ) ] = c_monoFont;
-		pdfData.fonts[ QStringLiteral( "Courier New Italic" ) ] = c_monoItalicFont;
-		pdfData.fonts[ QStringLiteral( "Courier New Bold" ) ] = c_monoBoldFont;
-		pdfData.fonts[ QStringLiteral( "Courier New Bold Italic" ) ] = c_monoBoldItalicFont;
-
-		pdfData.self = this;
-
-		if( m_opts.printDrawings )
+		else if( m_opts.printDrawings )
 		{
-			pdfData.printDrawings = true;
-
-			pdfData.drawingsFile.reset( new QFile( m_opts.testDataFileName ) );
-			if( !pdfData.drawingsFile->open( QIODevice::WriteOnly ) )
+			if( !sink.emplace< PrintingSink > ( m_opts.testDataFileName ).open() )
 				QFAIL( "Unable to open file for dump drawings." );
-
-			pdfData.drawingsStream.reset( new QTextStream( pdfData.drawingsFile.get() ) );
 		}
 		else
-			pdfData.testData = m_opts.testData;
+			sink.emplace< VerifyingSink > ( m_opts.testData, this );
 #endif // MD_PDF_TESTING
 
+		pdfData.context->sink = &sink;
+
 		int itemIdx = 0;
+		QJsonArray blocks;
+		QJsonArray footnotes;
 
 		pdfData.extraInFootnote = pdfData.lineSpacing(
 			createFont( m_opts.m_textFont, false, false, m_opts.m_textFontSize,
-				pdfData.doc, 1.0, pdfData ), m_opts.m_textFontSize, 1.0 ) / 3.0;
+				pdfData.context->doc, 1.0, pdfData ), m_opts.m_textFontSize, 1.0 ) / 3.0;
 
 		createPage( pdfData );
 
-		for( auto it = m_doc->items().cbegin(), last = m_doc->items().cend(); it != last; ++it )
+		if( parsing.valid() )
 		{
-			switch( (*it)->type() )
+			// Report belongs to this thread, so the time spent waiting for the parser is measured,
+			// the rest of parsing is hidden behind preparation of fonts.
+			bool ready = true;
+
 			{
-				case MD::ItemType::Anchor :
-					pdfData.anchors.push_back(
-						static_cast< MD::Anchor< MD::QStringTrait >* > ( it->get() )->label() );
+				PhaseTimer timer( m_report, RenderReport::Phase::Parse );
 
-				default:
-					break;
+				while( parsing.wait_for( c_parsingCheckInterval ) != std::future_status::ready )
+				{
+					QMutexLocker lock( &m_mutex );
+
+					if( m_terminate )
+					{
+						ready = false;
+
+						break;
+					}
+				}
+			}
+
+			if( !ready )
+			{
+				emit done( true );
+
+				deleteLater();
+
+				return;
+			}
+
+			m_doc = parsing.get();
+
+			emit parsed( m_doc );
+
+			if( m_doc->isEmpty() )
+				throw PdfRendererError( tr( "Input Markdown file is empty. Nothing saved." ) );
+
+			emit status( tr( "Rendering PDF..." ) );
+		}
+
+		pdfData.context->md = m_doc;
+
+		m_report.setMemory( RenderReport::Memory::Document, documentMemory( m_doc ) );
+
+		const int itemsCount = m_doc->items().size();
+
+#ifndef MD_PDF_TESTING
+		prefetchImages();
+#endif
+
+		{
+			PhaseTimer timer( m_report, RenderReport::Phase::Anchors );
+
+			for( auto it = m_doc->items().cbegin(), last = m_doc->items().cend(); it != last; ++it )
+			{
+				switch( (*it)->type() )
+				{
+					case MD::ItemType::Anchor :
+						pdfData.context->anchors.insert(
+							static_cast< MD::Anchor< MD::QStringTrait >* > ( it->get() )->label() );
+
+					default:
+						break;
+				}
 			}
 		}
 
@@ -704,10 +1789,31 @@ PdfRenderer::renderImpl()
 					break;
 			}
 
+			QVector< WhereDrawn > where;
+
+			std::optional< PhaseTimer > timer;
+			const auto phase = blockPhase( (*it)->type() );
+
+			std::optional< TimelineSpan > span;
+
+			if( phase != RenderReport::Phase::Count )
+			{
+				m_report.beginBlock( itemTypeName( (*it)->type() ), pdfData.currentFile,
+					(*it)->startLine() + 1, (*it)->endLine() + 1 );
+				timer.emplace( m_report, phase );
+				span.emplace( m_timeline, itemTypeName( (*it)->type() ), "block" );
+
+				if( *span )
+				{
+					span->setArg( QStringLiteral( "file" ), pdfData.currentFile );
+					span->setArg( QStringLiteral( "line" ), (*it)->startLine() + 1 );
+				}
+			}
+
 			switch( (*it)->type() )
 			{
 				case MD::ItemType::Heading :
-					drawHeading( pdfData, m_opts,
+					where = drawHeading( pdfData, m_opts,
 						static_cast< MD::Heading< MD::QStringTrait >* > ( it->get() ),
 						m_doc, 0.0,
 						// If there is another item after heading we need to know its min
@@ -715,25 +1821,25 @@ PdfRenderer::renderImpl()
 						( it + 1 != last ?
 							minNecessaryHeight( pdfData, m_opts, *( it + 1 ), m_doc, 0.0,
 								1.0 ) :
-							0.0 ), CalcHeightOpt::Unknown, 1.0 );
+							0.0 ), CalcHeightOpt::Unknown, 1.0 ).first;
 					break;
 
 				case MD::ItemType::Paragraph :
-					drawParagraph( pdfData, m_opts,
+					where = drawParagraph( pdfData, m_opts,
 						static_cast< MD::Paragraph< MD::QStringTrait >* > ( it->get() ),
-						m_doc, 0.0, true, CalcHeightOpt::Unknown, 1.0 );
+						m_doc, 0.0, true, CalcHeightOpt::Unknown, 1.0 ).first;
 					break;
 
 				case MD::ItemType::Code :
-					drawCode( pdfData, m_opts,
+					where = drawCode( pdfData, m_opts,
 						static_cast< MD::Code< MD::QStringTrait >* > ( it->get() ),
-						m_doc, 0.0, CalcHeightOpt::Unknown, 1.0 );
+						m_doc, 0.0, CalcHeightOpt::Unknown, 1.0 ).first;
 					break;
 
 				case MD::ItemType::Blockquote :
-					drawBlockquote( pdfData, m_opts,
+					where = drawBlockquote( pdfData, m_opts,
 						static_cast< MD::Blockquote< MD::QStringTrait >* > ( it->get() ),
-						m_doc, 0.0, CalcHeightOpt::Unknown, 1.0 );
+						m_doc, 0.0, CalcHeightOpt::Unknown, 1.0 ).first;
 					break;
 
 				case MD::ItemType::List :
@@ -741,14 +1847,14 @@ PdfRenderer::renderImpl()
 					auto * list = static_cast< MD::List< MD::QStringTrait >* > ( it->get() );
 					const auto bulletWidth = maxListNumberWidth( list );
 
-					drawList( pdfData, m_opts, list, m_doc, bulletWidth );
+					where = drawList( pdfData, m_opts, list, m_doc, bulletWidth ).first;
 				}
 					break;
 
 				case MD::ItemType::Table :
-					drawTable( pdfData, m_opts,
+					where = drawTable( pdfData, m_opts,
 						static_cast< MD::Table< MD::QStringTrait >* > ( it->get() ),
-						m_doc, 0.0, CalcHeightOpt::Unknown, 1.0 );
+						m_doc, 0.0, CalcHeightOpt::Unknown, 1.0 ).first;
 					break;
 
 				case MD::ItemType::PageBreak :
@@ -773,42 +1879,118 @@ PdfRenderer::renderImpl()
 					break;
 			}
 
+			timer.reset();
+			span.reset();
+			m_report.endBlock();
+
+			if( m_opts.m_dryRun && !where.isEmpty() )
+				blocks.append( layoutBlock( pdfData, it->get(), where ) );
+
+			finishUnreachablePages( pdfData );
+
+			sampleMemory( pdfData, phase );
+
 			emit progress( static_cast< int > ( static_cast< double > (itemIdx) /
 				static_cast< double > (itemsCount) * 100.0 ) );
 		}
 
-		if( !m_footnotes.isEmpty() )
-		{
-			pdfData.drawFootnotes = true;
-			pdfData.coords.x = pdfData.coords.margins.left;
-			pdfData.coords.y = pdfData.topFootnoteY( pdfData.reserved.firstKey() ) -
-				pdfData.extraInFootnote;
+		if( !m_footnotes.isEmpty() )
+		{
+			PhaseTimer timer( m_report, RenderReport::Phase::Footnotes );
+
+			pdfData.drawFootnotes = true;
+			pdfData.coords.x = pdfData.coords.margins.left;
+			pdfData.coords.y = pdfData.topFootnoteY( pdfData.reserved.firstKey() ) -
+				pdfData.extraInFootnote;
+
+			pdfData.currentPainterIdx = pdfData.reserved.firstKey();
+			pdfData.footnotePageIdx = pdfData.reserved.firstKey();
+
+			drawHorizontalLine( pdfData, m_opts );
+
+			for( const auto & f : std::as_const( m_footnotes ) )
+			{
+				m_report.beginBlock( "footnote", f.file, f.footnote->startLine() + 1,
+					f.footnote->endLine() + 1 );
+
+				TimelineSpan span( m_timeline, "footnote", "block" );
+
+				if( span )
+				{
+					span.setArg( QStringLiteral( "file" ), f.file );
+					span.setArg( QStringLiteral( "line" ), f.footnote->startLine() + 1 );
+				}
+
+				const auto where = drawFootnote( pdfData, m_opts, m_doc, f.id, f.footnote.get(),
+					CalcHeightOpt::Unknown );
+
+				m_report.endBlock();
+
+				if( m_opts.m_dryRun )
+					footnotes.append( layoutBlock( pdfData, f.footnote.get(), where ) );
+
+				finishUnreachablePages( pdfData );
+
+				sampleMemory( pdfData, RenderReport::Phase::Footnotes );
+			}
+		}
+
+		{
+			PhaseTimer timer( m_report, RenderReport::Phase::ResolveLinks );
+
+			resolveLinks( pdfData );
+		}
+
+		finishPages( pdfData );
 
-			pdfData.currentPainterIdx = pdfData.reserved.firstKey();
-			pdfData.footnotePageIdx = pdfData.reserved.firstKey();
+		sampleMemory( pdfData, RenderReport::Phase::FinishPages );
 
-			drawHorizontalLine( pdfData, m_opts );
+		m_report.set( RenderReport::Counter::Pages, pdfData.context->doc->GetPages().GetCount() );
+		m_report.set( RenderReport::Counter::Images, imagesCount( pdfData.context->doc ) );
 
-			for( const auto & f : std::as_const( m_footnotes ) )
-				drawFootnote( pdfData, m_opts, m_doc, f.first, f.second.get(),
-					CalcHeightOpt::Unknown );
+		{
+			PhaseTimer timer( m_report, RenderReport::Phase::Save );
+
+			if( m_opts.m_dryRun )
+				savePageMap( { { QStringLiteral( "pages" ),
+						static_cast< int > ( pdfData.context->doc->GetPages().GetCount() ) },
+					{ QStringLiteral( "blocks" ), blocks },
+					{ QStringLiteral( "footnotes" ), footnotes } } );
+			else
+			{
+				emit status( tr( "Saving PDF..." ) );
+
+				pdfData.save( m_fileName, m_opts );
+			}
 		}
 
-		resolveLinks( pdfData );
+		// Fonts are embedded on save, so objects are counted after it.
+		m_report.set( RenderReport::Counter::Objects, pdfData.context->doc->GetObjects().GetSize() );
+		m_report.set( RenderReport::Counter::BytesWritten, QFileInfo( m_fileName ).size() );
+		m_report.setTotal( total.nsecsElapsed() );
+		m_report.sampleMemory( RenderReport::Phase::Save, currentMemoryUsage() );
+		m_report.setPeakRss( peakMemoryUsage() );
 
-		finishPages( pdfData );
+		auto r = m_report.toJson();
+		r.insert( QStringLiteral( "file" ), m_fileName );
+
+		emit report( r );
 
-		emit status( tr( "Saving PDF..." ) );
+		if( m_timeline.isEnabled() && !m_timeline.save( m_opts.m_timelineFileName ) )
+			throw PdfRendererError( tr( "Unable to write timeline: %1." )
+				.arg( m_opts.m_timelineFileName ) );
 
-		pdfData.save( m_fileName );
+		const auto peak = peakMemoryUsage();
+
+		if( peak > 0 )
+			emit status( tr( "Peak memory usage: %1 MB." ).arg( peak / ( 1024 * 1024 ) ) );
 
 		emit done( m_terminate );
 
 #ifdef MD_PDF_TESTING
-		if( m_opts.printDrawings )
-			pdfData.drawingsFile->close();
+		const auto * verifying = std::get_if< VerifyingSink > ( &sink );
 
-		if( pdfData.testPos != pdfData.testData.size() )
+		if( verifying && !verifying->isFinished() )
 			m_isError = true;
 #endif // MD_PDF_TESTING
 	}
@@ -888,30 +2070,64 @@ PdfRenderer::handleException( PdfAuxData & pdfData, const QString & msg )
 void
 PdfRenderer::finishPages( PdfAuxData & pdfData )
 {
-	for( const auto & p: *pdfData.painters )
-		p->FinishDrawing();
+	finishPagesBefore( pdfData, static_cast< int > ( pdfData.context->painters->size() ) );
 }
 
 void
-PdfRenderer::clean()
+PdfRenderer::finishUnreachablePages( PdfAuxData & pdfData )
 {
-	m_dests.clear();
-	m_unresolvedLinks.clear();
-	m_unresolvedFootnotesLinks.clear();
+	if( m_opts.m_finishPagesEarly )
+		finishPagesBefore( pdfData, pdfData.lowestReachablePage() );
 }
 
-double
-PdfRenderer::rowHeight( const QVector< QVector< CellData > > & table, int row )
+void
+PdfRenderer::finishPagesBefore( PdfAuxData & pdfData, int pageIdx )
 {
-	double h = 0.0;
+	PhaseTimer timer( m_report, RenderReport::Phase::FinishPages );
 
-	for( auto it = table.cbegin(), last = table.cend(); it != last; ++it )
+	for( ; pdfData.firstUnfinishedPageIdx < pageIdx; ++pdfData.firstUnfinishedPageIdx )
 	{
-		if( (*it)[ row ].height > h )
-			h = (*it)[ row ].height;
+		auto & p = (*pdfData.context->painters)[ pdfData.firstUnfinishedPageIdx ];
+
+		// Content stream is compressed on finish, so release the painter with its buffer.
+		if( p )
+		{
+			p->FinishDrawing();
+			p.reset();
+		}
+
+		if( pdfData.firstUnfinishedPageIdx < pdfData.contentBytes.size() )
+		{
+			m_report.addMemory( RenderReport::Memory::Painters,
+				-pdfData.contentBytes[ pdfData.firstUnfinishedPageIdx ] );
+			pdfData.contentBytes[ pdfData.firstUnfinishedPageIdx ] = 0;
+		}
 	}
+}
+
+void
+PdfRenderer::savePageMap( const QJsonObject & map )
+{
+	emit status( tr( "Saving page map..." ) );
+
+	QFile file( m_fileName );
+
+	if( !file.open( QIODevice::WriteOnly ) )
+		throw PdfRendererError( tr( "Unable to write page map to the file: %1." )
+			.arg( m_fileName ) );
 
-	return  h;
+	file.write( QJsonDocument( map ).toJson() );
+	file.close();
+
+	emit pageMap( map );
+}
+
+void
+PdfRenderer::clean()
+{
+	m_dests.clear();
+	m_unresolvedLinks.clear();
+	m_unresolvedFootnotesLinks.clear();
 }
 
 void
@@ -923,7 +2139,7 @@ PdfRenderer::resolveLinks( PdfAuxData & pdfData )
 		{
 			for( const auto & r : std::as_const( it.value() ) )
 			{
-				auto & page = pdfData.doc->GetPages().GetPageAt( r.second );
+				auto & page = pdfData.context->doc->GetPages().GetPageAt( r.second );
 				auto & annot = page.GetAnnotations().CreateAnnot< PoDoFo::PdfAnnotationLink >(
 					Rect( r.first.x(), r.first.y(), r.first.width(), r.first.height() ) );
 				annot.SetBorderStyle( 0.0, 0.0, 0.0 );
@@ -945,7 +2161,7 @@ PdfRenderer::resolveLinks( PdfAuxData & pdfData )
 	{
 		if( m_dests.contains( it.key() ) )
 		{
-			auto & page = pdfData.doc->GetPages().GetPageAt( it.value().second );
+			auto & page = pdfData.context->doc->GetPages().GetPageAt( it.value().second );
 			auto & annot = page.GetAnnotations().CreateAnnot< PoDoFo::PdfAnnotationLink >(
 				Rect( it.value().first.x(), it.value().first.y(),
 					it.value().first.width(), it.value().first.height() ) );
@@ -967,23 +2183,25 @@ Font *
 PdfRenderer::createFont( const QString & name, bool bold, bool italic, double size,
 	Document * doc, double scale, const PdfAuxData & pdfData )
 {
+	m_report.count( RenderReport::Counter::CreateFont );
+
 	PoDoFo::PdfFontSearchParams params;
 	params.Style = PoDoFo::PdfFontStyle::Regular;
 	if( bold ) params.Style.value() |= PoDoFo::PdfFontStyle::Bold;
 	if( italic ) params.Style.value() |= PoDoFo::PdfFontStyle::Italic;
 
+	if( m_opts.m_useStandardFonts )
+		return standard14Font( doc, standard14Font( name == m_opts.m_codeFont, bold, italic ) );
+
 #ifdef MD_PDF_TESTING
 	const QString internalName = name + ( bold ? QStringLiteral( " Bold" ) : QString() ) +
 		( italic ? QStringLiteral( " Italic" ) : QString() );
 
-	auto & font = doc->GetFonts().GetOrCreateFont(
-		pdfData.fonts[ internalName ].toLocal8Bit().data() );
-
-	return &font;
+	return fontFromFile( doc, pdfData.context->fonts[ internalName ], fontCreateParams( m_opts ) );
 #else
 	Q_UNUSED( pdfData )
 
-	auto * font = doc->GetFonts().SearchFont( name.toLocal8Bit().data(), params );
+	auto * font = searchFont( doc, name, params, fontCreateParams( m_opts ) );
 
 	if( !font )
 		throw PdfRendererError( tr( "Unable to create font: %1. Please choose another one.\n\n"
@@ -998,12 +2216,12 @@ PdfRenderer::createFont( const QString & name, bool bold, bool italic, double si
 bool
 PdfRenderer::isFontCreatable( const QString & name )
 {
-	Document doc;
+	std::unique_ptr< Document, DocumentDeleter > doc( new Document );
 
 	PoDoFo::PdfFontSearchParams params;
 	params.Style = PoDoFo::PdfFontStyle::Regular;
 
-	auto font = doc.GetFonts().SearchFont( name.toLocal8Bit().data(), params );
+	auto font = searchFont( doc.get(), name, params, {} );
 
 	return ( font != nullptr );
 }
@@ -1011,11 +2229,13 @@ PdfRenderer::isFontCreatable( const QString & name )
 void
 PdfRenderer::createPage( PdfAuxData & pdfData )
 {
+	TimelineSpan span( m_timeline, "createPage", "page" );
+
 	std::function< void ( PdfAuxData & ) > create;
 
 	create = [&create] ( PdfAuxData & pdfData )
 	{
-		pdfData.page = &pdfData.doc->GetPages().CreatePage(
+		pdfData.page = &pdfData.context->doc->GetPages().CreatePage(
 			Page::CreateStandardPageSize( PoDoFo::PdfPageSize::A4 ) );
 
 		if( !pdfData.page )
@@ -1028,8 +2248,8 @@ PdfRenderer::createPage( PdfAuxData & pdfData )
 		auto painter = std::make_shared< Painter > ();
 		painter->SetCanvas( *pdfData.page );
 
-		(*pdfData.painters).push_back( painter );
-		pdfData.currentPainterIdx = pdfData.painters->size() - 1;
+		(*pdfData.context->painters).push_back( painter );
+		pdfData.currentPainterIdx = pdfData.context->painters->size() - 1;
 
 		pdfData.coords = { { pdfData.coords.margins.left, pdfData.coords.margins.right,
 				pdfData.coords.margins.top, pdfData.coords.margins.bottom },
@@ -1084,6 +2304,11 @@ PdfRenderer::createPage( PdfAuxData & pdfData )
 
 	if( pdfData.colorsStack.size() > 1 )
 		pdfData.repeatColor();
+
+	if( span )
+		span.setArg( QStringLiteral( "page" ), pdfData.currentPainterIdx + 1 );
+
+	finishUnreachablePages( pdfData );
 }
 
 void
@@ -1108,6 +2333,98 @@ PdfRenderer::createQString( const char * str )
 	return QString::fromUtf8( str, -1 );
 }
 
+qint64
+PdfRenderer::peakMemoryUsage()
+{
+#ifdef Q_OS_WIN
+	PROCESS_MEMORY_COUNTERS pmc;
+
+	if( GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof( pmc ) ) )
+		return static_cast< qint64 > ( pmc.PeakWorkingSetSize );
+	else
+		return 0;
+#else
+	struct rusage usage;
+
+	if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+	{
+#ifdef Q_OS_MACOS
+		// On macOS ru_maxrss is in bytes.
+		return static_cast< qint64 > ( usage.ru_maxrss );
+#else
+		// On Linux ru_maxrss is in kilobytes.
+		return static_cast< qint64 > ( usage.ru_maxrss ) * 1024;
+#endif
+	}
+	else
+		return 0;
+#endif
+}
+
+qint64
+PdfRenderer::currentMemoryUsage()
+{
+#ifdef Q_OS_WIN
+	PROCESS_MEMORY_COUNTERS pmc;
+
+	if( GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof( pmc ) ) )
+		return static_cast< qint64 > ( pmc.WorkingSetSize );
+	else
+		return 0;
+#elif defined( Q_OS_MACOS )
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+	if( task_info( mach_task_self(), MACH_TASK_BASIC_INFO,
+		reinterpret_cast< task_info_t > ( &info ), &count ) == KERN_SUCCESS )
+			return static_cast< qint64 > ( info.resident_size );
+	else
+		return 0;
+#else
+	// Second field of statm is resident set size in pages.
+	QFile statm( QStringLiteral( "/proc/self/statm" ) );
+
+	if( statm.open( QIODevice::ReadOnly ) )
+	{
+		const auto fields = statm.readAll().split( ' ' );
+
+		if( fields.size() > 1 )
+			return fields.at( 1 ).toLongLong() * static_cast< qint64 > ( sysconf( _SC_PAGESIZE ) );
+	}
+
+	return 0;
+#endif
+}
+
+void
+PdfRenderer::sampleMemory( PdfAuxData & pdfData, RenderReport::Phase phase )
+{
+	{
+		QMutexLocker lock( &m_imageCacheMutex );
+
+		m_report.setMemory( RenderReport::Memory::ImageCache, m_imageCacheBytes );
+	}
+
+	m_report.setMemory( RenderReport::Memory::PdfObjects,
+		static_cast< qint64 > ( pdfData.context->doc->GetObjects().GetSize() ) * c_pdfObjectSize +
+			pdfData.imagesBytes );
+
+	const auto rss = currentMemoryUsage();
+
+	if( phase != RenderReport::Phase::Count )
+		m_report.sampleMemory( phase, rss );
+
+	// Resident memory is unknown on some systems, tracked memory is checked then.
+	const auto used = std::max( rss, m_report.trackedMemory() );
+
+	if( m_opts.m_memoryBudget > 0 && used > m_opts.m_memoryBudget )
+		throw PdfRendererError( tr( "Memory budget of %1 MB is exceeded, %2 MB are in use. "
+			"Tracked memory: %3." )
+				.arg( m_opts.m_memoryBudget / ( 1024 * 1024 ) )
+				.arg( used / ( 1024 * 1024 ) )
+				.arg( m_report.memoryBreakdown() ) );
+}
+
 QPair< QVector< WhereDrawn >, WhereDrawn >
 PdfRenderer::drawHeading( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	MD::Heading< MD::QStringTrait > * item, std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
@@ -1129,7 +2446,7 @@ PdfRenderer::drawHeading( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 				!where.first.isEmpty() )
 		{
 			m_dests.insert( item->label(),
-				std::make_shared< Destination> ( pdfData.doc->GetPages().GetPageAt(
+				std::make_shared< Destination> ( pdfData.context->doc->GetPages().GetPageAt(
 						static_cast< unsigned int >( where.first.front().pageIdx ) ),
 					pdfData.coords.margins.left + offset,
 					where.first.front().y + where.first.front().height, 0.0 ) );
@@ -1154,11 +2471,11 @@ PdfRenderer::drawText( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	pdfData.endPos = item->endColumn();
 
 	auto * spaceFont = createFont( renderOpts.m_textFont, false, false,
-		renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+		renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 	auto * font = createFont( renderOpts.m_textFont, item->opts() & MD::TextOption::BoldText,
 		item->opts() & MD::TextOption::ItalicText,
-		renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+		renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 	return drawString( pdfData, renderOpts, item->text(),
 		spaceFont, renderOpts.m_textFontSize, scale,
@@ -1235,11 +2552,12 @@ PdfRenderer::drawLink( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 
 	auto * font = createFont( renderOpts.m_textFont, item->opts() & MD::TextOption::BoldText,
 		item->opts() & MD::TextOption::ItalicText, renderOpts.m_textFontSize,
-		pdfData.doc, scale, pdfData );
+		pdfData.context->doc, scale, pdfData );
 
 	if( !item->p()->isEmpty() )
 	{
-		pdfData.setColor( renderOpts.m_linkColor );
+		if( draw )
+			pdfData.setColor( renderOpts.m_linkColor );
 
 		for( auto it = item->p()->items().begin(), last = item->p()->items().end();
 			it != last; ++it )
@@ -1251,12 +2569,12 @@ PdfRenderer::drawLink( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 					auto * text = std::static_pointer_cast< MD::Text< MD::QStringTrait > >( *it ).get();
 
 					auto * spaceFont = createFont( renderOpts.m_textFont, false, false,
-						renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+						renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 					auto * font = createFont( renderOpts.m_textFont,
 						text->opts() & MD::BoldText || item->opts() & MD::BoldText,
 						text->opts() & MD::ItalicText || item->opts() & MD::ItalicText,
-						renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+						renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 					rects.append( drawString( pdfData, renderOpts, text->text(),
 						spaceFont, renderOpts.m_textFontSize, scale,
@@ -1292,12 +2610,13 @@ PdfRenderer::drawLink( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 			}
 		}
 
-		pdfData.restoreColor();
+		if( draw )
+			pdfData.restoreColor();
 	}
 	else if( item->img()->isEmpty() )
 	{
 		auto * spaceFont = createFont( renderOpts.m_textFont, false, false,
-			renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+			renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 		rects = drawString( pdfData, renderOpts, url,
 			spaceFont, renderOpts.m_textFontSize, scale,
@@ -1320,18 +2639,18 @@ PdfRenderer::drawLink( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	if( draw )
 	{
 		// If Web URL.
-		if( !pdfData.anchors.contains( url ) &&
-			pdfData.md->labeledHeadings().find( url ) == pdfData.md->labeledHeadings().cend() )
+		if( !pdfData.context->anchors.contains( url ) &&
+			pdfData.context->md->labeledHeadings().find( url ) == pdfData.context->md->labeledHeadings().cend() )
 		{
 			for( const auto & r : std::as_const( rects ) )
 			{
-				auto & annot = pdfData.doc->GetPages().GetPageAt(
+				auto & annot = pdfData.context->doc->GetPages().GetPageAt(
 					static_cast< unsigned int >( r.second ) )
 						.GetAnnotations().CreateAnnot< PoDoFo::PdfAnnotationLink >(
 					Rect( r.first.x(), r.first.y(), r.first.width(), r.first.height() ) );
 				annot.SetBorderStyle( 0.0, 0.0, 0.0 );
 
-				auto action = std::make_shared< PoDoFo::PdfAction >( *pdfData.doc,
+				auto action = std::make_shared< PoDoFo::PdfAction >( *pdfData.context->doc,
 					PoDoFo::PdfActionType::URI );
 				action->SetURI( url.toLatin1().data() );
 
@@ -1360,7 +2679,40 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 	bool strikeout, long long int startLine, long long int startPos,
 	long long int endLine, long long int endPos )
 {
-	Q_UNUSED( doc )
+	// Measuring is a separate instantiation without any drawing.
+	if( cw && !cw->isDrawing() )
+		return drawStringImpl< false >( pdfData, renderOpts, str,
+			firstSpaceFont, firstSpaceFontSize, firstSpaceFontScale,
+			spaceFont, spaceFontSize, spaceFontScale,
+			font, fontSize, fontScale, lineHeight, doc, newLine,
+			footnoteFont, footnoteFontSize, footnoteFontScale, nextItem,
+			footnoteNum, offset, firstInParagraph, cw, background,
+			strikeout, startLine, startPos, endLine, endPos );
+	else
+		return drawStringImpl< true >( pdfData, renderOpts, str,
+			firstSpaceFont, firstSpaceFontSize, firstSpaceFontScale,
+			spaceFont, spaceFontSize, spaceFontScale,
+			font, fontSize, fontScale, lineHeight, doc, newLine,
+			footnoteFont, footnoteFontSize, footnoteFontScale, nextItem,
+			footnoteNum, offset, firstInParagraph, cw, background,
+			strikeout, startLine, startPos, endLine, endPos );
+}
+
+template< bool Draw >
+QVector< QPair< QRectF, unsigned int > >
+PdfRenderer::drawStringImpl( PdfAuxData & pdfData, const RenderOpts & renderOpts, const QString & str,
+	Font * firstSpaceFont, double firstSpaceFontSize, double firstSpaceFontScale,
+	Font * spaceFont, double spaceFontSize, double spaceFontScale,
+	Font * font, double fontSize, double fontScale,
+	double lineHeight,
+	std::shared_ptr< MD::Document< MD::QStringTrait > > doc, bool & newLine,
+	Font * footnoteFont, double footnoteFontSize, double footnoteFontScale,
+	MD::Item< MD::QStringTrait > * nextItem,
+	int footnoteNum, double offset,
+	bool firstInParagraph, CustomWidth * cw, const QColor & background,
+	bool strikeout, long long int startLine, long long int startPos,
+	long long int endLine, long long int endPos )
+{
 	Q_UNUSED( renderOpts )
 
 	pdfData.startLine = startLine;
@@ -1368,11 +2720,6 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 	pdfData.endLine = endLine;
 	pdfData.endPos = endPos;
 
-	bool draw = true;
-
-	if( cw && !cw->isDrawing() )
-		draw = false;
-
 	bool footnoteAtEnd = false;
 	double footnoteWidth = 0.0;
 
@@ -1390,7 +2737,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 	double ascent = pdfData.fontAscent( font, fontSize, fontScale );
 	double d = 0.0;
 
-	if( cw && cw->isDrawing() )
+	if( Draw && cw )
 	{
 		h = cw->height();
 		descent = cw->descent();
@@ -1401,7 +2748,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 	{
 		newLine = true;
 
-		if( draw )
+		if constexpr( Draw )
 		{
 			if( cw )
 				cw->moveToNextLine();
@@ -1412,7 +2759,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 			descent = cw->descent();
 			d = ( h - ascent ) / 2.0;
 		}
-		else if( cw )
+		else
 		{
 			cw->append( { 0.0, lineHeight, 0.0, false, true, true, false, "" } );
 			pdfData.coords.x = pdfData.coords.margins.left + offset;
@@ -1443,7 +2790,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 
 		auto scale = 100.0;
 
-		if( draw && cw )
+		if( Draw && cw )
 			scale = cw->scale();
 
 		const auto xv = pdfData.coords.x + w * scale / 100.0 + pdfData.stringWidth( font,
@@ -1454,19 +2801,19 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 		{
 			newLine = false;
 
-			if( draw )
+			if constexpr( Draw )
 			{
 				pdfData.drawText( pdfData.coords.x, pdfData.coords.y + d, " ",
 					firstSpaceFont, firstSpaceFontSize * firstSpaceFontScale,
 					scale / 100.0, false );
+
+				ret.append( qMakePair( QRectF( pdfData.coords.x,
+					pdfData.coords.y + d,
+					w * scale / 100.0, lineHeight ), pdfData.currentPageIndex() ) );
 			}
-			else if( cw )
+			else
 				cw->append( { w, lineHeight, 0.0, true, false, true, false, " " } );
 
-			ret.append( qMakePair( QRectF( pdfData.coords.x,
-				pdfData.coords.y + d,
-				w * scale / 100.0, lineHeight ), pdfData.currentPageIndex() ) );
-
 			pdfData.coords.x += w * scale / 100.0;
 		}
 		else
@@ -1516,7 +2863,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 
 				auto scale = 100.0;
 
-				if( draw && cw )
+				if( Draw && cw )
 					scale = cw->scale();
 
 				const auto availableWidth = wv - ( pdfData.coords.x > 0.0 ? pdfData.coords.x : 0.0 ) -
@@ -1533,7 +2880,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 				{
 					newLine = false;
 
-					if( draw )
+					if constexpr( Draw )
 					{
 						ret.append( qMakePair( QRectF( pdfData.coords.x,
 							pdfData.coords.y + d,
@@ -1553,7 +2900,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 						pdfData.drawText( pdfData.coords.x, pdfData.coords.y + d, " ",
 							spaceFont, spaceFontSize * spaceFontScale, scale / 100.0, strikeout );
 					}
-					else if( cw )
+					else
 						cw->append( { spaceWidth, lineHeight, 0.0, true, false, true, false, " " } );
 
 					pdfData.coords.x += spaceWidth * scale / 100.0;
@@ -1581,7 +2928,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 		{
 			newLine = false;
 
-			if( draw )
+			if constexpr( Draw )
 			{
 				if( background.isValid() )
 				{
@@ -1600,7 +2947,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 					pdfData.coords.y + d,
 					length, lineHeight ), pdfData.currentPageIndex() ) );
 			}
-			else if( cw )
+			else
 				cw->append( { length + ( it + 1 == last && footnoteAtEnd ? footnoteWidth : 0.0 ),
 					lineHeight, 0.0, false, false, true, false, *it } );
 
@@ -1628,7 +2975,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 					const auto p = createUtf8String( tmp );
 					const auto w = pdfData.stringWidth( font, fontSize, fontScale, p );
 
-					if( draw )
+					if constexpr( Draw )
 					{
 						pdfData.drawText( pdfData.coords.x, pdfData.coords.y + d, p,
 							font, fontSize * fontScale, 1.0, strikeout );
@@ -1637,7 +2984,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 								pdfData.coords.y + d, w, lineHeight ),
 							pdfData.currentPageIndex() ) );
 					}
-					else if( cw )
+					else
 						cw->append( { w, lineHeight, 0.0, false, false, true, false, tmp } );
 
 					newLine = false;
@@ -1650,7 +2997,7 @@ PdfRenderer::drawString( PdfAuxData & pdfData, const RenderOpts & renderOpts, co
 						newLineFn();
 				}
 
-				if( !draw && cw && it + 1 == last && footnoteAtEnd )
+				if( !Draw && it + 1 == last && footnoteAtEnd )
 					cw->append( { footnoteWidth, lineHeight, 0.0, false, false, true, false,
 						QString::number( footnoteNum ) } );
 
@@ -1705,11 +3052,11 @@ PdfRenderer::drawInlinedCode( PdfAuxData & pdfData, const RenderOpts & renderOpt
 	pdfData.endPos = item->endColumn();
 
 	auto * textFont = createFont( renderOpts.m_textFont, false, false, renderOpts.m_textFontSize,
-		pdfData.doc, scale, pdfData );
+		pdfData.context->doc, scale, pdfData );
 
 	auto * font = createFont( renderOpts.m_codeFont, item->opts() & MD::TextOption::BoldText,
 		item->opts() & MD::TextOption::ItalicText, renderOpts.m_codeFontSize,
-		pdfData.doc, scale, pdfData );
+		pdfData.context->doc, scale, pdfData );
 
 	return drawString( pdfData, renderOpts, item->text(),
 		textFont, renderOpts.m_textFontSize, scale,
@@ -1719,7 +3066,7 @@ PdfRenderer::drawInlinedCode( PdfAuxData & pdfData, const RenderOpts & renderOpt
 		doc, newLine,
 		nullptr, 0.0, 0.0, nullptr, m_footnoteNum,
 		offset, firstInParagraph, cw,
-		renderOpts.m_syntax->theme().editorColor( KSyntaxHighlighting::Theme::CodeFolding ),
+		pdfData.context->syntax->theme().editorColor( KSyntaxHighlighting::Theme::CodeFolding ),
 		item->opts() & MD::TextOption::StrikethroughText,
 		item->startLine(), item->startColumn(),
 		item->endLine(), item->endColumn() );
@@ -1794,6 +3141,9 @@ PdfRenderer::drawParagraph( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	pdfData.endLine = item->endLine();
 	pdfData.endPos = item->endColumn();
 
+	if( heightCalcOpt != CalcHeightOpt::Unknown )
+		m_report.countMeasure();
+
 	QVector< QPair< QRectF, unsigned int > > rects;
 
 	{
@@ -1807,7 +3157,7 @@ PdfRenderer::drawParagraph( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 		emit status( tr( "Drawing paragraph." ) );
 
 	auto * font = createFont( renderOpts.m_textFont, false, false,
-		renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+		renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 	auto * footnoteFont = font;
 
@@ -1945,6 +3295,8 @@ PdfRenderer::drawParagraph( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	cw.calcScale( pdfData.coords.pageWidth - pdfData.coords.margins.left -
 		pdfData.coords.margins.right - offset );
 
+	m_report.setMemory( RenderReport::Memory::CustomWidth, cw.memoryUsage() );
+
 	cw.setDrawing();
 
 	switch( heightCalcOpt )
@@ -2188,6 +3540,12 @@ PdfRenderer::drawMathExpr( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	pdfData.endLine = item->endLine();
 	pdfData.endPos = item->endColumn();
 
+	PhaseTimer timer( m_report, RenderReport::Phase::Math );
+	TimelineSpan span( m_timeline, "math", "math" );
+
+	if( span )
+		span.setArg( QStringLiteral( "expr" ), item->expr() );
+
 	JKQTMathText mt;
 	mt.useAnyUnicode( renderOpts.m_mathFont, renderOpts.m_mathFont );
 	mt.setFontPointSize( renderOpts.m_mathFontSize );
@@ -2205,7 +3563,7 @@ PdfRenderer::drawMathExpr( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	}
 
 	auto * font = createFont( renderOpts.m_textFont, false, false,
-		renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+		renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 	const auto lineHeight = pdfData.lineSpacing( font, renderOpts.m_textFontSize, scale );
 
@@ -2268,7 +3626,9 @@ PdfRenderer::drawMathExpr( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 				x = ( availableWidth - size.width() * imgScale ) / 2.0;
 
 			PoDoFoPaintDevice pd;
-			pd.setPdfPainter( *(*pdfData.painters)[ pdfData.currentPainterIdx ].get(), *pdfData.doc );
+			pd.setPdfPainter( pdfData.painter(), *pdfData.context->doc );
+			pd.setFontCreateParams( fontCreateParams( renderOpts ) );
+			pd.setUseStandardFonts( renderOpts.m_useStandardFonts );
 			QPainter p( &pd );
 
 			mt.draw( p, 0, QRectF( QPointF( ( pdfData.coords.x + x ) / 72.0 * pd.physicalDpiX(),
@@ -2351,7 +3711,9 @@ PdfRenderer::drawMathExpr( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 			}
 
 			PoDoFoPaintDevice pd;
-			pd.setPdfPainter( *(*pdfData.painters)[ pdfData.currentPainterIdx ].get(), *pdfData.doc );
+			pd.setPdfPainter( pdfData.painter(), *pdfData.context->doc );
+			pd.setFontCreateParams( fontCreateParams( renderOpts ) );
+			pd.setUseStandardFonts( renderOpts.m_useStandardFonts );
 			QPainter p( &pd );
 
 			mt.draw( p, 0, QRectF( QPointF( ( pdfData.coords.x ) / 72.0 * pd.physicalDpiX(),
@@ -2508,13 +3870,19 @@ PdfRenderer::drawFootnote( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	pdfData.endLine = note->endLine();
 	pdfData.endPos = note->endColumn();
 
+	if( heightCalcOpt != CalcHeightOpt::Unknown )
+		m_report.countMeasure();
+
 	if( heightCalcOpt == CalcHeightOpt::Unknown && pdfData.footnotesAnchorsMap.contains( note ) )
 		pdfData.currentFile = pdfData.footnotesAnchorsMap[ note ].first;
 
+	// Footnote number is drawn after the first item.
+	PagePin pin( pdfData, heightCalcOpt == CalcHeightOpt::Unknown );
+
 	static const double c_offset = 2.0;
 
 	auto * font = createFont( renderOpts.m_textFont, false, false,
-		renderOpts.m_textFontSize, pdfData.doc, c_footnoteScale, pdfData );
+		renderOpts.m_textFontSize, pdfData.context->doc, c_footnoteScale, pdfData );
 
 	auto footnoteOffset = c_offset * 2.0 / c_mmInPt +
 		pdfData.stringWidth( font, renderOpts.m_textFontSize, c_footnoteScale,
@@ -2605,7 +3973,7 @@ PdfRenderer::drawFootnote( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 			const auto p = ret.constFirst().pageIdx;
 
 			m_dests.insert( footnoteRefId,
-				std::make_shared< Destination > ( pdfData.doc->GetPages().GetPageAt( p ),
+				std::make_shared< Destination > ( pdfData.context->doc->GetPages().GetPageAt( p ),
 					x, y + pdfData.lineSpacing( font, renderOpts.m_textFontSize, c_footnoteScale ),
 					0.0 ) );
 
@@ -2630,6 +3998,11 @@ PdfRenderer::footnoteHeight( PdfAuxData & pdfData, const RenderOpts & renderOpts
 	std::shared_ptr< MD::Document< MD::QStringTrait > > doc, MD::Footnote< MD::QStringTrait > * note,
 	double * lineHeight )
 {
+	TimelineSpan span( m_timeline, "footnoteHeight", "measure" );
+
+	if( span )
+		span.setArg( QStringLiteral( "line" ), note->startLine() + 1 );
+
 	return drawFootnote( pdfData, renderOpts, doc, "", note, CalcHeightOpt::Full, lineHeight );
 }
 
@@ -2657,18 +4030,18 @@ PdfRenderer::drawImage( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 
 		if( !img.isNull() )
 		{
-			auto pdfImg = pdfData.doc->CreateImage();
-			pdfImg->LoadFromBuffer( { img.data() , static_cast< size_t > ( img.size() ) } );
+			const auto pdfImg = pdfData.embedImage( img );
+			const auto pixels = imagePixelSize( img );
 
-			const double iWidth = std::round( (double) pdfImg->GetWidth() /
-				(double) pdfData.dpi * 72.0 );
-			const double iHeight = std::round( (double) pdfImg->GetHeight() /
-				(double) pdfData.dpi * 72.0 );
+			const double iWidth = std::round( (double) pixels.width() /
+				(double) pdfData.context->dpi * 72.0 );
+			const double iHeight = std::round( (double) pixels.height() /
+				(double) pdfData.context->dpi * 72.0 );
 
 			newLine = true;
 
 			auto * font = createFont( renderOpts.m_textFont, false, false,
-				renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+				renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 			const auto lineHeight = pdfData.lineSpacing( font, renderOpts.m_textFontSize, scale );
 
@@ -2719,7 +4092,7 @@ PdfRenderer::drawImage( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 			if( iWidth * imgScale < availableWidth )
 				x = ( availableWidth - iWidth * imgScale ) / 2.0;
 
-			const double dpiScale = (double) pdfImg->GetWidth() / iWidth;
+			const double dpiScale = (double) pixels.width() / iWidth;
 
 			pdfData.drawImage( pdfData.coords.x + x,
 				pdfData.coords.y - iHeight * imgScale,
@@ -2753,18 +4126,18 @@ PdfRenderer::drawImage( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 
 		if( !img.isNull() )
 		{
-			auto pdfImg = pdfData.doc->CreateImage();
-			pdfImg->LoadFromBuffer( { img.data(), static_cast< size_t > ( img.size() ) } );
+			// Measured only, the image is embedded when it's drawn.
+			const auto pixels = imagePixelSize( img );
 
-			const double iWidth = std::round( (double) pdfImg->GetWidth() /
-				(double) pdfData.dpi * 72.0 );
-			const double iHeight = std::round( (double) pdfImg->GetHeight() /
-				(double) pdfData.dpi * 72.0 );
+			const double iWidth = std::round( (double) pixels.width() /
+				(double) pdfData.context->dpi * 72.0 );
+			const double iHeight = std::round( (double) pixels.height() /
+				(double) pdfData.context->dpi * 72.0 );
 
 			newLine = true;
 
 			auto * font = createFont( renderOpts.m_textFont, false, false,
-				renderOpts.m_textFontSize, pdfData.doc, scale, pdfData );
+				renderOpts.m_textFontSize, pdfData.context->doc, scale, pdfData );
 
 			const auto lineHeight = pdfData.lineSpacing( font, renderOpts.m_textFontSize, scale );
 
@@ -2898,90 +4271,301 @@ LoadImageFromNetwork::loadFinished()
 	else
 		m_img.loadFromData( data );
 
-	m_reply->deleteLater();
+	m_reply->deleteLater();
+
+	m_thread->quit();
+}
+
+void
+LoadImageFromNetwork::loadError( QNetworkReply::NetworkError )
+{
+	m_reply->deleteLater();
+	m_thread->quit();
+}
+
+namespace /* anonymous */ {
+
+//! Read image from local file or from the Web.
+QImage
+readImage( const QString & url )
+{
+	QImage img;
+
+	if( QFileInfo::exists( url ) )
+	{
+		if( url.toLower().endsWith( QStringLiteral( "svg" ) ) )
+		{
+			try {
+				Magick::Image mimg;
+				mimg.read( url.toStdString() );
+				mimg.magick( "png" );
+				img = convert( mimg );
+			}
+			catch( const Magick::Exception & )
+			{
+			}
+		}
+		else
+			img = QImage( url );
+	}
+	else if( !QUrl( url ).isRelative() )
+	{
+		QThread thread;
+
+		LoadImageFromNetwork load( QUrl( url ), &thread );
+
+		load.moveToThread( &thread );
+		thread.start();
+		load.load();
+		thread.wait();
+
+		img = load.image();
+	}
+	else
+		throw PdfRendererError(
+			PdfRenderer::tr( "Hmm, I don't know how to load this image: %1.\n\n"
+				"This image is not a local existing file, and not in the Web. Check your Markdown." )
+					.arg( url ) );
+
+	return img;
+}
+
+//! \return Data of the image to store in PDF.
+QByteArray
+imageData( const QImage & img, const QString & url )
+{
+	QByteArray data;
+	QBuffer buf( &data );
+
+	QString fmt = QStringLiteral( "png" );
+
+	if( url.endsWith( QStringLiteral( "jpg" ) ) ||
+		url.endsWith( QStringLiteral( "jpeg" ) ))
+			fmt = QStringLiteral( "jpg" );
+
+	img.save( &buf, fmt.toLatin1().constData() );
+
+	return data;
+}
+
+//! \return Key of the image in the shared cache, local files are keyed with modification time.
+QString
+imageCacheKey( const QString & url )
+{
+	const QFileInfo info( url );
+
+	if( info.exists() )
+		return QStringLiteral( "%1:%2" ).arg( info.absoluteFilePath(),
+			QString::number( info.lastModified().toMSecsSinceEpoch() ) );
+	else
+		return url;
+}
+
+//! Find image in the shared cache.
+bool
+findSharedImage( const std::shared_ptr< ImagesCache > & cache, const QString & url,
+	QByteArray & data )
+{
+	if( !cache )
+		return false;
+
+	return cache->find( imageCacheKey( url ), data );
+}
+
+//! Store image in the shared cache.
+void
+storeSharedImage( const std::shared_ptr< ImagesCache > & cache, const QString & url,
+	const QByteArray & data )
+{
+	if( !cache )
+		return;
+
+	cache->insert( imageCacheKey( url ), data );
+}
+
+} /* namespace anonymous */
+
+QByteArray
+PdfRenderer::loadImage( MD::Image< MD::QStringTrait > * item )
+{
+	PhaseTimer timer( m_report, RenderReport::Phase::Images );
+	TimelineSpan span( m_timeline, "loadImage", "image" );
+
+	if( span )
+		span.setArg( QStringLiteral( "url" ), item->url() );
+
+	// Other images may still be loading in background, only this one is waited for.
+	const auto loading = m_imagesLoading.constFind( item->url() );
+
+	if( loading != m_imagesLoading.cend() )
+		loading.value().wait();
+
+	auto cache = [this] ( const QString & url, const QByteArray & data )
+	{
+		QMutexLocker lock( &m_imageCacheMutex );
+
+		m_imageCache.insert( url, data );
+		m_imageCacheBytes += data.size();
+	};
+
+	{
+		QMutexLocker lock( &m_imageCacheMutex );
+
+		const auto it = m_imageCache.constFind( item->url() );
+
+		if( it != m_imageCache.cend() )
+			return it.value();
+	}
+
+	QByteArray data;
+
+	if( findSharedImage( m_opts.m_imagesCache, item->url(), data ) )
+	{
+		cache( item->url(), data );
+
+		return data;
+	}
+
+	const auto img = readImage( item->url() );
+
+#ifdef MD_PDF_TESTING
+	if( img.isNull() && !QFileInfo::exists( item->url() ) )
+	{
+		terminate();
+
+		QWARN( "Got empty image from network." );
+	}
+#endif
+
+	if( img.isNull() )
+		throw PdfRendererError( tr( "Unable to load image: %1.\n\n"
+			"If this image is in Web, please be sure you are connected to the Internet. I'm "
+			"sorry for the inconvenience." ).arg( item->url() ) );
+
+	data = imageData( img, item->url() );
+
+	cache( item->url(), data );
+	storeSharedImage( m_opts.m_imagesCache, item->url(), data );
 
-	m_thread->quit();
+	return data;
 }
 
 void
-LoadImageFromNetwork::loadError( QNetworkReply::NetworkError )
+PdfRenderer::prefetchImages()
 {
-	m_reply->deleteLater();
-	m_thread->quit();
-}
+	// Images are loaded in order of the document, duplicates are skipped.
+	QStringList urls;
+	QSet< QString > seen;
 
-QByteArray
-PdfRenderer::loadImage( MD::Image< MD::QStringTrait > * item )
-{
-	if( m_imageCache.contains( item->url() ) )
-		return m_imageCache[ item->url() ];
+	const auto addUrl = [&urls, &seen] ( const QString & url )
+	{
+		if( !url.isEmpty() && !seen.contains( url ) )
+		{
+			seen.insert( url );
+			urls.append( url );
+		}
+	};
 
-	QImage img;
+	std::function< void( MD::Block< MD::QStringTrait > * b ) > findImages;
 
-	if( QFileInfo::exists( item->url() ) )
+	findImages = [&] ( MD::Block< MD::QStringTrait > * b )
 	{
-		if( item->url().toLower().endsWith( QStringLiteral( "svg" ) ) )
+		for( auto it = b->items().cbegin(), last = b->items().cend(); it != last; ++it )
 		{
-			try {
-				Magick::Image mimg;
-				mimg.read( item->url().toStdString() );
-				mimg.magick( "png" );
-				img = convert( mimg );
-			}
-			catch( const Magick::Exception & )
+			auto cb = dynamic_cast< MD::Block< MD::QStringTrait >* > ( it->get() );
+
+			if( cb )
+				findImages( cb );
+			else
 			{
+				switch( (*it)->type() )
+				{
+					case MD::ItemType::Heading :
+						findImages( static_cast< MD::Heading< MD::QStringTrait >* > (
+							it->get() )->text().get() );
+						break;
+
+					case MD::ItemType::Table :
+					{
+						auto t = static_cast< MD::Table< MD::QStringTrait >* > ( it->get() );
+
+						for( const auto & r: t->rows() )
+						{
+							for( const auto & c : r->cells() )
+								findImages( c.get() );
+						}
+					}
+						break;
+
+					case MD::ItemType::Image :
+						addUrl( static_cast< MD::Image< MD::QStringTrait >* > (
+							it->get() )->url() );
+						break;
+
+					case MD::ItemType::Link :
+					{
+						auto * l = static_cast< MD::Link< MD::QStringTrait >* > ( it->get() );
+
+						if( !l->img()->isEmpty() )
+							addUrl( l->img()->url() );
+					}
+						break;
+
+					default :
+						break;
+				}
 			}
 		}
-		else
-			img = QImage( item->url() );
-	}
-	else if( !QUrl( item->url() ).isRelative() )
-	{
-		QThread thread;
+	};
 
-		LoadImageFromNetwork load( QUrl( item->url() ), &thread );
+	findImages( m_doc.get() );
 
-		load.moveToThread( &thread );
-		thread.start();
-		load.load();
-		thread.wait();
+	for( const auto & f : m_doc->footnotesMap() )
+		findImages( f.second.get() );
 
-		img = load.image();
+	m_imagesLoading.clear();
 
-#ifdef MD_PDF_TESTING
-	if( img.isNull() )
+	for( const auto & url : std::as_const( urls ) )
 	{
-		terminate();
-
-		QWARN( "Got empty image from network." );
-	}
-#endif
-	}
-	else
-		throw PdfRendererError(
-			tr( "Hmm, I don't know how to load this image: %1.\n\n"
-				"This image is not a local existing file, and not in the Web. Check your Markdown." )
-					.arg( item->url() ) );
+		auto loaded = std::make_shared< std::promise< void > > ();
+		m_imagesLoading.insert( url, loaded->get_future().share() );
 
-	if( img.isNull() )
-		throw PdfRendererError( tr( "Unable to load image: %1.\n\n"
-			"If this image is in Web, please be sure you are connected to the Internet. I'm "
-			"sorry for the inconvenience." ).arg( item->url() ) );
+		m_imagesPool.start( [this, url, loaded] ()
+			{
+				try {
+					QByteArray data;
 
-	QByteArray data;
-	QBuffer buf( &data );
+					if( !findSharedImage( m_opts.m_imagesCache, url, data ) )
+					{
+						const auto img = readImage( url );
 
-	QString fmt = QStringLiteral( "png" );
+						// Errors will be reported on drawing.
+						if( !img.isNull() )
+						{
+							data = imageData( img, url );
 
-	if( item->url().endsWith( QStringLiteral( "jpg" ) ) ||
-		item->url().endsWith( QStringLiteral( "jpeg" ) ))
-			fmt = QStringLiteral( "jpg" );
+							storeSharedImage( m_opts.m_imagesCache, url, data );
+						}
+					}
 
-	img.save( &buf, fmt.toLatin1().constData() );
+					if( !data.isEmpty() )
+					{
+						QMutexLocker lock( &m_imageCacheMutex );
 
-	m_imageCache.insert( item->url(), data );
+						if( !m_imageCache.contains( url ) )
+						{
+							m_imageCache.insert( url, data );
+							m_imageCacheBytes += data.size();
+						}
+					}
+				}
+				catch( ... )
+				{
+				}
 
-	return data;
+				loaded->set_value();
+			} );
+	}
 }
 
 QPair< QVector< WhereDrawn >, WhereDrawn >
@@ -2997,6 +4581,9 @@ PdfRenderer::drawCode( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	pdfData.endLine = item->endLine();
 	pdfData.endPos = item->endColumn();
 
+	if( heightCalcOpt != CalcHeightOpt::Unknown )
+		m_report.countMeasure();
+
 	if( item->text().isEmpty() )
 		return {};
 
@@ -3004,7 +4591,7 @@ PdfRenderer::drawCode( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 		emit status( tr( "Drawing code." ) );
 
 	auto * textFont = createFont( renderOpts.m_textFont, false, false, renderOpts.m_textFontSize,
-		pdfData.doc, scale, pdfData );
+		pdfData.context->doc, scale, pdfData );
 
 	const auto textLHeight = pdfData.lineSpacing( textFont, renderOpts.m_textFontSize, scale );
 
@@ -3027,7 +4614,7 @@ PdfRenderer::drawCode( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 		it->replace( QStringLiteral( "\t" ), QStringLiteral( "    " ) );
 
 	auto * font = createFont( renderOpts.m_codeFont, false, false, renderOpts.m_codeFontSize,
-		pdfData.doc, scale, pdfData );
+		pdfData.context->doc, scale, pdfData );
 
 	const auto lineHeight = pdfData.lineSpacing( font, renderOpts.m_codeFontSize, scale );
 
@@ -3072,8 +4659,21 @@ PdfRenderer::drawCode( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 			return {};
 	}
 
-	pdfData.syntax->setDefinition( pdfData.syntax->definitionForName( item->syntax().toLower() ) );
-	const auto colored = pdfData.syntax->prepare( lines );
+	Syntax::Colors colored;
+
+	{
+		PhaseTimer timer( m_report, RenderReport::Phase::Highlighting );
+		TimelineSpan span( m_timeline, "highlight", "code" );
+
+		if( span )
+		{
+			span.setArg( QStringLiteral( "syntax" ), item->syntax() );
+			span.setArg( QStringLiteral( "lines" ), static_cast< int > ( lines.size() ) );
+		}
+
+		colored = pdfData.context->syntax->prepare( lines, item->syntax().toLower() );
+	}
+
 	int currentWord = 0;
 	const auto spaceWidth = pdfData.stringWidth( font, renderOpts.m_codeFontSize, scale, " " );
 
@@ -3097,7 +4697,7 @@ PdfRenderer::drawCode( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 
 		if( i < j )
 		{
-			pdfData.setColor( renderOpts.m_syntax->theme().editorColor(
+			pdfData.setColor( pdfData.context->syntax->theme().editorColor(
 				KSyntaxHighlighting::Theme::CodeFolding ) );
 			pdfData.drawRectangle( pdfData.coords.x, y +
 					pdfData.fontDescent( font, renderOpts.m_codeFontSize, scale ),
@@ -3117,20 +4717,20 @@ PdfRenderer::drawCode( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 				if( currentWord == colored.size() || colored[ currentWord ].line != i )
 					break;
 
-				pdfData.setColor( colored[ currentWord ].format.textColor( pdfData.syntax->theme() ) );
+				pdfData.setColor( colored[ currentWord ].format.textColor( pdfData.context->syntax->theme() ) );
 
 				const auto length = colored[ currentWord ].endPos -
 					colored[ currentWord ].startPos + 1;
 
 				Font * f = font;
 
-				const auto italic = colored[ currentWord ].format.isItalic( pdfData.syntax->theme() );
-				const auto bold = colored[ currentWord ].format.isBold( pdfData.syntax->theme() );
+				const auto italic = colored[ currentWord ].format.isItalic( pdfData.context->syntax->theme() );
+				const auto bold = colored[ currentWord ].format.isBold( pdfData.context->syntax->theme() );
 
 				if( italic || bold )
 				{
 					f = createFont( renderOpts.m_codeFont, bold, italic, renderOpts.m_codeFontSize,
-							pdfData.doc, scale, pdfData );
+							pdfData.context->doc, scale, pdfData );
 				}
 
 				pdfData.drawText( pdfData.coords.x, pdfData.coords.y,
@@ -3168,11 +4768,17 @@ PdfRenderer::drawBlockquote( PdfAuxData & pdfData, const RenderOpts & renderOpts
 	pdfData.endLine = item->endLine();
 	pdfData.endPos = item->endColumn();
 
+	if( heightCalcOpt != CalcHeightOpt::Unknown )
+		m_report.countMeasure();
+
 	QVector< WhereDrawn > ret;
 
 	if( heightCalcOpt == CalcHeightOpt::Unknown )
 		emit status( tr( "Drawing blockquote." ) );
 
+	// Vertical bar is drawn after all items.
+	PagePin pin( pdfData, heightCalcOpt == CalcHeightOpt::Unknown );
+
 	bool first  = true;
 	WhereDrawn firstLine = {};
 
@@ -3361,6 +4967,9 @@ PdfRenderer::drawList( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	pdfData.endLine = item->endLine();
 	pdfData.endPos = item->endColumn();
 
+	if( heightCalcOpt != CalcHeightOpt::Unknown )
+		m_report.countMeasure();
+
 	QVector< WhereDrawn > ret;
 
 	{
@@ -3402,7 +5011,7 @@ PdfRenderer::drawList( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 
 	if( !ret.isEmpty() )
 		ret.front().height += pdfData.lineSpacing( createFont( m_opts.m_textFont, false, false,
-				m_opts.m_textFontSize, pdfData.doc, scale, pdfData ),
+				m_opts.m_textFontSize, pdfData.context->doc, scale, pdfData ),
 			renderOpts.m_textFontSize, scale );
 
 	return { ret, firstLine };
@@ -3420,7 +5029,7 @@ PdfRenderer::drawListItem( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	pdfData.endPos = item->endColumn();
 
 	auto * font = createFont( renderOpts.m_textFont, false, false, renderOpts.m_textFontSize,
-		pdfData.doc, scale, pdfData );
+		pdfData.context->doc, scale, pdfData );
 
 	const auto lineHeight = pdfData.lineSpacing( font, renderOpts.m_textFontSize, scale );
 	const auto orderedListNumberWidth =
@@ -3432,6 +5041,9 @@ PdfRenderer::drawListItem( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	if( heightCalcOpt == CalcHeightOpt::Unknown )
 		offset += orderedListNumberWidth + spaceWidth;
 
+	// Bullet is drawn after all items.
+	PagePin pin( pdfData, heightCalcOpt == CalcHeightOpt::Unknown );
+
 	QVector< WhereDrawn > ret;
 
 	bool addExtraSpace = false;
@@ -3632,7 +5244,7 @@ PdfRenderer::drawListItem( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 
 				pdfData.setColor( Qt::black );
 				const auto r = unorderedMarkWidth / 2.0;
-				(*pdfData.painters)[ pdfData.currentPainterIdx ]->DrawCircle(
+				pdfData.drawCircle(
 					pdfData.coords.margins.left + offset + r - ( orderedListNumberWidth + spaceWidth ),
 					firstLine.y + qAbs( firstLine.height - unorderedMarkWidth ) / 2.0, r,
 					PoDoFo::PdfPathDrawMode::Fill );
@@ -3703,12 +5315,16 @@ operator == ( const PdfRenderer::FontAttribs & f1, const PdfRenderer::FontAttrib
 void
 PdfRenderer::createAuxCell( const RenderOpts & renderOpts,
 	PdfAuxData & pdfData,
-	CellData & data,
+	AuxTable & table,
 	MD::Item< MD::QStringTrait > * item,
 	std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
 	const QString & url,
 	const QColor & color )
 {
+	// Every item of the cell shares the same URL and color.
+	const auto urlSpan = ( url.isEmpty() ? AuxTable::Span() : table.addString( url ) );
+	const auto colorIdx = table.addColor( color );
+
 	auto handleText = [&]()
 	{
 		auto * t = static_cast< MD::Text< MD::QStringTrait >* > ( item );
@@ -3718,21 +5334,17 @@ PdfRenderer::createAuxCell( const RenderOpts & renderOpts,
 
 		for( const auto & w : words )
 		{
-			CellItem item;
-			item.word = w;
-			item.font = { renderOpts.m_textFont,
+			AuxTable::Item item;
+			item.word = table.addString( w );
+			item.font = table.addFont( { renderOpts.m_textFont,
 				(bool) ( t->opts() & MD::TextOption::BoldText ),
 				(bool) ( t->opts() & MD::TextOption::ItalicText ),
 				(bool) ( t->opts() & MD::TextOption::StrikethroughText ),
-				renderOpts.m_textFontSize };
-
-			if( !url.isEmpty() )
-				item.url = url;
+				renderOpts.m_textFontSize } );
+			item.url = urlSpan;
+			item.color = colorIdx;
 
-			if( color.isValid() )
-				item.color = color;
-
-			data.items.append( item );
+			table.items.append( item );
 		}
 	};
 
@@ -3751,20 +5363,16 @@ PdfRenderer::createAuxCell( const RenderOpts & renderOpts,
 
 			for( const auto & w : words )
 			{
-				CellItem item;
-				item.word = w;
-				item.font = { renderOpts.m_codeFont, false, false, false,
-					renderOpts.m_codeFontSize };
-				item.background = renderOpts.m_syntax->theme().editorColor(
-					KSyntaxHighlighting::Theme::CodeFolding );
-
-				if( !url.isEmpty() )
-					item.url = url;
-
-				if( color.isValid() )
-					item.color = color;
-
-				data.items.append( item );
+				AuxTable::Item item;
+				item.word = table.addString( w );
+				item.font = table.addFont( { renderOpts.m_codeFont, false, false, false,
+					renderOpts.m_codeFontSize } );
+				item.background = table.addColor( pdfData.context->syntax->theme().editorColor(
+					KSyntaxHighlighting::Theme::CodeFolding ) );
+				item.url = urlSpan;
+				item.color = colorIdx;
+
+				table.items.append( item );
 			}
 		}
 			break;
@@ -3785,55 +5393,55 @@ PdfRenderer::createAuxCell( const RenderOpts & renderOpts,
 				for( auto pit = l->p()->items().cbegin(), plast = l->p()->items().cend();
 					pit != plast; ++pit )
 				{
-					createAuxCell( renderOpts, pdfData, data, pit->get(), doc,
+					createAuxCell( renderOpts, pdfData, table, pit->get(), doc,
 						url, renderOpts.m_linkColor );
 				}
 			}
-			else if( !l->img()->isEmpty() )
+			else
 			{
-				CellItem item;
-				item.image = loadImage( l->img().get() );
-				item.url = url;
-				item.font = { renderOpts.m_textFont,
+				const auto font = table.addFont( { renderOpts.m_textFont,
 					(bool) ( l->opts() & MD::TextOption::BoldText ),
 					(bool) ( l->opts() & MD::TextOption::ItalicText ),
 					(bool) ( l->opts() & MD::TextOption::StrikethroughText ),
-					renderOpts.m_textFontSize };
+					renderOpts.m_textFontSize } );
+				const auto linkUrl = table.addString( url );
 
-				data.items.append( item );
-			}
-			else if( !l->text().isEmpty() )
-			{
-				const auto words = l->text().split( QLatin1Char( ' ' ),
-					Qt::SkipEmptyParts );
+				if( !l->img()->isEmpty() )
+				{
+					AuxTable::Item item;
+					item.image = table.images.size();
+					item.url = linkUrl;
+					item.font = font;
 
-				for( const auto & w : words )
+					table.images.append( loadImage( l->img().get() ) );
+					table.items.append( item );
+				}
+				else if( !l->text().isEmpty() )
 				{
-					CellItem item;
-					item.word = w;
-					item.font = { renderOpts.m_textFont,
-						(bool) ( l->opts() & MD::TextOption::BoldText ),
-						(bool) ( l->opts() & MD::TextOption::ItalicText ),
-						(bool) ( l->opts() & MD::TextOption::StrikethroughText ),
-						renderOpts.m_textFontSize };
-					item.url = url;
-					item.color = renderOpts.m_linkColor;
-
-					data.items.append( item );
+					const auto words = l->text().split( QLatin1Char( ' ' ),
+						Qt::SkipEmptyParts );
+					const auto linkColor = table.addColor( renderOpts.m_linkColor );
+
+					for( const auto & w : words )
+					{
+						AuxTable::Item item;
+						item.word = table.addString( w );
+						item.font = font;
+						item.url = linkUrl;
+						item.color = linkColor;
+
+						table.items.append( item );
+					}
 				}
-			}
-			else
-			{
-				CellItem item;
-				item.font = { renderOpts.m_textFont,
-					(bool) ( l->opts() & MD::TextOption::BoldText ),
-					(bool) ( l->opts() & MD::TextOption::ItalicText ),
-					(bool) ( l->opts() & MD::TextOption::StrikethroughText ),
-					renderOpts.m_textFontSize };
-				item.url = url;
-				item.color = renderOpts.m_linkColor;
+				else
+				{
+					AuxTable::Item item;
+					item.font = font;
+					item.url = linkUrl;
+					item.color = table.addColor( renderOpts.m_linkColor );
 
-				data.items.append( item );
+					table.items.append( item );
+				}
 			}
 		}
 			break;
@@ -3842,18 +5450,17 @@ PdfRenderer::createAuxCell( const RenderOpts & renderOpts,
 		{
 			auto * i = static_cast< MD::Image< MD::QStringTrait >* > ( item );
 
-			CellItem item;
+			AuxTable::Item item;
 
 			emit status( tr( "Loading image." ) );
 
-			item.image = loadImage( i );
-			item.font = { renderOpts.m_textFont,
-				false, false, false, renderOpts.m_textFontSize };
+			item.image = table.images.size();
+			item.font = table.addFont( { renderOpts.m_textFont,
+				false, false, false, renderOpts.m_textFontSize } );
+			item.url = urlSpan;
 
-			if( !url.isEmpty() )
-				item.url = url;
-
-			data.items.append( item );
+			table.images.append( loadImage( i ) );
+			table.items.append( item );
 		}
 			break;
 
@@ -3865,10 +5472,10 @@ PdfRenderer::createAuxCell( const RenderOpts & renderOpts,
 
 			if( fit != doc->footnotesMap().cend() )
 			{
-				CellItem item;
-				item.font = { renderOpts.m_textFont,
+				AuxTable::Item item;
+				item.font = table.addFont( { renderOpts.m_textFont,
 					false, false, false,
-					renderOpts.m_textFontSize };
+					renderOpts.m_textFontSize } );
 
 				auto anchorIt = pdfData.footnotesAnchorsMap.constFind( fit->second.get() );
 				int num = m_footnoteNum;
@@ -3881,17 +5488,13 @@ PdfRenderer::createAuxCell( const RenderOpts & renderOpts,
 				else
 					num = anchorIt->second;
 
-				item.footnote = QString::number( num );
-				item.footnoteRef = ref->id();
-				item.footnoteObj = fit->second;
-
-				if( !url.isEmpty() )
-					item.url = url;
+				item.footnote = table.addString( QString::number( num ) );
+				item.footnoteRef = table.footnotes.size();
+				item.url = urlSpan;
+				item.color = colorIdx;
 
-				if( color.isValid() )
-					item.color = color;
-
-				data.items.append( item );
+				table.footnotes.append( { ref->id(), fit->second } );
+				table.items.append( item );
 			}
 			else
 				handleText();
@@ -3903,19 +5506,25 @@ PdfRenderer::createAuxCell( const RenderOpts & renderOpts,
 	}
 }
 
-QVector< QVector< PdfRenderer::CellData > >
+PdfRenderer::AuxTable
 PdfRenderer::createAuxTable( PdfAuxData & pdfData, const RenderOpts & renderOpts,
-	MD::Table< MD::QStringTrait > * item, std::shared_ptr< MD::Document< MD::QStringTrait > > doc, double scale )
+	MD::Table< MD::QStringTrait > * item, std::shared_ptr< MD::Document< MD::QStringTrait > > doc, double scale,
+	int firstRow, int rowsCount )
 {
-	Q_UNUSED( pdfData )
 	Q_UNUSED( scale )
 
 	const auto columnsCount = item->columnsCount();
+	const auto totalRows = static_cast< int > ( item->rows().size() );
+	const auto lastRow = ( rowsCount < 0 ? totalRows : qMin( totalRows, firstRow + rowsCount ) );
 
-	QVector< QVector< CellData > > auxTable;
-	auxTable.resize( columnsCount );
+	AuxTable auxTable;
+	auxTable.columnsCount = columnsCount;
 
-	for( auto rit = item->rows().cbegin(), rlast = item->rows().cend(); rit != rlast; ++rit )
+	for( int i = 0; i < columnsCount; ++i )
+		auxTable.alignments.append( item->columnAlignment( i ) );
+
+	for( auto rit = item->rows().cbegin() + firstRow, rlast = item->rows().cbegin() + lastRow;
+		rit != rlast; ++rit )
 	{
 		int i = 0;
 
@@ -3924,45 +5533,135 @@ PdfRenderer::createAuxTable( PdfAuxData & pdfData, const RenderOpts & renderOpts
 			if( i == columnsCount )
 				break;
 
-			CellData data;
-			data.alignment = item->columnAlignment( i );
+			auxTable.cells.append( auxTable.items.size() );
 
 			for( auto it = (*cit)->items().cbegin(), last = (*cit)->items().cend(); it != last; ++it )
-				createAuxCell( renderOpts, pdfData, data, it->get(), doc );
-
-			auxTable[ i ].append( data );
+				createAuxCell( renderOpts, pdfData, auxTable, it->get(), doc );
 
 			++i;
 		}
 
 		for( ; i < columnsCount; ++i )
-			auxTable[ i ].append( CellData() );
+			auxTable.cells.append( auxTable.items.size() );
+
+		++auxTable.rowsCount;
 	}
 
+	auxTable.cells.append( auxTable.items.size() );
+	auxTable.heights.resize( auxTable.rowsCount * columnsCount );
+
 	return auxTable;
 }
 
 void
-PdfRenderer::calculateCellsSize( PdfAuxData & pdfData, QVector< QVector< CellData > > & auxTable,
-	double spaceWidth, double offset, double lineHeight, double scale )
+PdfRenderer::measureAuxTable( PdfAuxData & pdfData, AuxTable & table, double scale )
 {
-	QVector< double > columnWidthes;
-	columnWidthes.resize( auxTable.size() );
+	// Fonts and images are shared by cells, so they are measured once.
+	table.spaceWidths.clear();
 
-	const auto availableWidth = pdfData.coords.pageWidth - pdfData.coords.margins.left -
-		pdfData.coords.margins.right - offset;
+	for( const auto & f : std::as_const( table.fonts ) )
+		table.spaceWidths.append( pdfData.stringWidth( createFont( f.family, f.bold, f.italic,
+			f.size, pdfData.context->doc, scale, pdfData ), f.size, scale, String( " " ) ) );
+
+	table.imagesSizes.clear();
+
+	for( const auto & image : std::as_const( table.images ) )
+	{
+		const auto pixels = imagePixelSize( image );
+
+		table.imagesSizes.append( QSizeF(
+			std::round( (double) pixels.width() / (double) pdfData.context->dpi * 72.0 ),
+			std::round( (double) pixels.height() / (double) pdfData.context->dpi * 72.0 ) ) );
+	}
+
+	if( table.rowsCount * table.columnsCount < c_parallelCellsCount )
+	{
+		for( auto & item : table.items )
+			item.width = table.itemWidth( item, pdfData, this, scale );
+
+		return;
+	}
+
+	// Widths of characters are taken from fonts here, so items are measured
+	// in parallel without access to PoDoFo.
+	QVector< GlyphWidths > glyphs;
+
+	const auto addGlyphs = [&] ( quint16 font, double size, QStringView text )
+	{
+		auto it = std::find_if( glyphs.begin(), glyphs.end(),
+			[&] ( const GlyphWidths & g ) { return g.size == size && g.font == font; } );
+
+		if( it == glyphs.end() )
+		{
+			const auto & f = table.fonts.at( font );
+
+			GlyphWidths g;
+			g.font = font;
+			g.size = size;
+			g.scale = scale;
+			g.pdfFont = createFont( f.family, f.bold, f.italic, f.size,
+				pdfData.context->doc, scale, pdfData );
 
-	const auto width = availableWidth / auxTable.size();
+			for( size_t c = 0; c < g.ascii.size(); ++c )
+				g.ascii[ c ] = pdfData.stringWidth( g.pdfFont, size, scale,
+					String( QByteArray( 1, static_cast< char > ( c ) ) ) );
 
-	for( auto it = auxTable.begin(), last = auxTable.end(); it != last; ++it )
+			glyphs.push_back( g );
+			it = glyphs.end() - 1;
+		}
+
+		it->add( text, pdfData );
+	};
+
+	for( const auto & item : std::as_const( table.items ) )
 	{
-		for( auto cit = it->begin(), clast = it->end(); cit != clast; ++cit )
-			cit->setWidth( width - c_tableMargin * 2.0 );
+		if( !item.isImage() )
+		{
+			const auto size = table.fonts.at( item.font ).size;
+
+			addGlyphs( item.font, size, table.view( item.word ) );
+			addGlyphs( item.font, size, table.view( item.url ) );
+
+			if( item.word.isEmpty() && item.url.isEmpty() && !item.footnote.isEmpty() )
+				addGlyphs( item.font, size * c_footnoteScale, table.view( item.footnote ) );
+		}
 	}
 
-	for( auto it = auxTable.begin(), last = auxTable.end(); it != last; ++it )
-		for( auto cit = it->begin(), clast = it->end(); cit != clast; ++cit )
-			cit->heightToWidth( lineHeight, spaceWidth, scale, pdfData, this );
+	// Every item is measured into its own slot, so result doesn't depend on threads count.
+	static const qsizetype c_chunk = 1024;
+
+	QThreadPool pool;
+	pool.setMaxThreadCount( QThread::idealThreadCount() );
+
+	auto * items = table.items.data();
+	const auto count = table.items.size();
+
+	for( qsizetype i = 0; i < count; i += c_chunk )
+		pool.start( [items, count, &table, &glyphs, i] ()
+			{
+				for( qsizetype j = i, last = qMin( i + c_chunk, count ); j < last; ++j )
+					items[ j ].width = table.itemWidth( items[ j ], glyphs );
+			} );
+
+	pool.waitForDone();
+}
+
+void
+PdfRenderer::calculateCellsSize( PdfAuxData & pdfData, AuxTable & auxTable,
+	double spaceWidth, double offset, double lineHeight, double scale )
+{
+	const auto availableWidth = pdfData.coords.pageWidth - pdfData.coords.margins.left -
+		pdfData.coords.margins.right - offset;
+
+	const auto width = availableWidth / auxTable.columnsCount;
+
+	auxTable.widths.fill( width - c_tableMargin * 2.0, auxTable.columnsCount );
+
+	measureAuxTable( pdfData, auxTable, scale );
+
+	// Heights are calculated from widths of items, there is no access to fonts here.
+	for( int i = 0, last = auxTable.rowsCount * auxTable.columnsCount; i < last; ++i )
+		auxTable.heightToWidth( i, lineHeight, spaceWidth, scale );
 }
 
 QPair< QVector< WhereDrawn >, WhereDrawn >
@@ -3978,6 +5677,9 @@ PdfRenderer::drawTable( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	pdfData.endLine = item->endLine();
 	pdfData.endPos = item->endColumn();
 
+	if( heightCalcOpt != CalcHeightOpt::Unknown )
+		m_report.countMeasure();
+
 	{
 		QMutexLocker lock( &m_mutex );
 
@@ -3989,18 +5691,34 @@ PdfRenderer::drawTable( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 		emit status( tr( "Drawing table." ) );
 
 	auto * font = createFont( renderOpts.m_textFont, false, false, renderOpts.m_textFontSize,
-		pdfData.doc, scale, pdfData );
+		pdfData.context->doc, scale, pdfData );
 
 	const auto lineHeight = pdfData.lineSpacing( font, renderOpts.m_textFontSize, scale );
 	const auto spaceWidth = pdfData.stringWidth( font, renderOpts.m_textFontSize, scale, " " );
 
-	auto auxTable = createAuxTable( pdfData, renderOpts, item, doc, scale );
+	const auto rowsCount = static_cast< int > ( item->rows().size() );
+
+	// Rows are laid out and drawn by windows, so only one window of the table is in memory.
+	// Widths of columns don't depend on cells, so they are the same in every window.
+	AuxTable auxTable;
+
+	const auto loadWindow = [&] ( int firstRow )
+	{
+		// Previous window is freed before creation of the next one.
+		auxTable = AuxTable();
+		auxTable = createAuxTable( pdfData, renderOpts, item, doc, scale,
+			firstRow, c_tableRowsWindow );
+
+		calculateCellsSize( pdfData, auxTable, spaceWidth, offset, lineHeight, scale );
+
+		m_report.setMemory( RenderReport::Memory::AuxTables, auxTable.memoryUsage() );
+	};
 
-	calculateCellsSize( pdfData, auxTable, spaceWidth, offset, lineHeight, scale );
+	loadWindow( 0 );
 
-	const auto r0h = rowHeight( auxTable, 0 );
-	const bool justHeader = auxTable.at( 0 ).size() == 1;
-	const auto r1h = ( !justHeader ? rowHeight( auxTable, 1 ) : 0 );
+	const auto r0h = auxTable.rowHeight( 0 );
+	const bool justHeader = rowsCount == 1;
+	const auto r1h = ( !justHeader ? auxTable.rowHeight( 1 ) : 0 );
 
 	switch( heightCalcOpt )
 	{
@@ -4010,6 +5728,10 @@ PdfRenderer::drawTable( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 				lineHeight - ( pdfData.fontDescent( font, renderOpts.m_textFontSize, scale ) *
 					( justHeader ? 1.0 : 2.0 ) ) } );
 
+			// Footnotes in the rest of rows are numbered as on drawing, cells are not measured.
+			for( int first = c_tableRowsWindow; first < rowsCount; first += c_tableRowsWindow )
+				createAuxTable( pdfData, renderOpts, item, doc, scale, first, c_tableRowsWindow );
+
 			return { ret, {} };
 		}
 
@@ -4019,9 +5741,15 @@ PdfRenderer::drawTable( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 				lineHeight - ( pdfData.fontDescent( font, renderOpts.m_textFontSize, scale ) *
 					( justHeader ? 1.0 : 2.0 ) ) } );
 
-			for( int i = 2; i < auxTable.at( 0 ).size(); ++i )
-				ret.append( { -1, 0.0, rowHeight( auxTable, i ) + c_tableMargin * 2.0 -
-					pdfData.fontDescent( font, renderOpts.m_textFontSize, scale ) } );
+			for( int first = 0; first < rowsCount; first += c_tableRowsWindow )
+			{
+				if( first > 0 )
+					loadWindow( first );
+
+				for( int i = ( first > 0 ? 0 : 2 ); i < auxTable.rowsCount; ++i )
+					ret.append( { -1, 0.0, auxTable.rowHeight( i ) + c_tableMargin * 2.0 -
+						pdfData.fontDescent( font, renderOpts.m_textFontSize, scale ) } );
+			}
 
 			return { ret, {} };
 		}
@@ -4048,17 +5776,23 @@ PdfRenderer::drawTable( PdfAuxData & pdfData, const RenderOpts & renderOpts,
 	bool first = true;
 	WhereDrawn firstLine;
 
-	for( int row = 0; row < auxTable[ 0 ].size(); ++row )
+	for( int firstRow = 0; firstRow < rowsCount; firstRow += c_tableRowsWindow )
 	{
-		const auto where = drawTableRow( auxTable, row, pdfData, offset, lineHeight, renderOpts,
-			doc, footnotes, scale );
-
-		ret.append( where.first );
+		if( firstRow > 0 )
+			loadWindow( firstRow );
 
-		if( first )
+		for( int row = 0; row < auxTable.rowsCount; ++row )
 		{
-			firstLine = where.second;
-			first = false;
+			const auto where = drawTableRow( auxTable, row, pdfData, offset, lineHeight, renderOpts,
+				doc, footnotes, scale );
+
+			ret.append( where.first );
+
+			if( first )
+			{
+				firstLine = where.second;
+				first = false;
+			}
 		}
 	}
 
@@ -4079,58 +5813,61 @@ PdfRenderer::addFootnote( const QString & refId,
 	{
 		for( auto it = b->items().cbegin(), last = b->items().cend(); it != last; ++it )
 		{
-			auto cb = dynamic_cast< MD::Block< MD::QStringTrait >* > ( it->get() );
-
-			if( cb )
-				findFootnoteRefs( cb, pdfData );
-			else
+			switch( (*it)->type() )
 			{
-				switch( (*it)->type() )
+				case MD::ItemType::Paragraph :
+				case MD::ItemType::Blockquote :
+				case MD::ItemType::List :
+				case MD::ItemType::ListItem :
+					findFootnoteRefs( static_cast< MD::Block< MD::QStringTrait >* > (
+						it->get() ), pdfData );
+					break;
+
+				case MD::ItemType::Heading :
+					findFootnoteRefs( static_cast< MD::Heading< MD::QStringTrait >* > (
+						it->get() )->text().get(), pdfData );
+					break;
+
+				case MD::ItemType::Table :
 				{
-					case MD::ItemType::Heading :
-						findFootnoteRefs( static_cast< MD::Heading< MD::QStringTrait >* > (
-							it->get() )->text().get(), pdfData );
-						break;
+					auto t = static_cast< MD::Table< MD::QStringTrait >* > ( it->get() );
 
-					case MD::ItemType::Table :
+					for( const auto & r: t->rows() )
 					{
-						auto t = static_cast< MD::Table< MD::QStringTrait >* > ( it->get() );
-
-						for( const auto & r: t->rows() )
-						{
-							for( const auto & c : r->cells() )
-								findFootnoteRefs( c.get(), pdfData );
-						}
+						for( const auto & c : r->cells() )
+							findFootnoteRefs( c.get(), pdfData );
 					}
-						break;
+				}
+					break;
 
-					case MD::ItemType::FootnoteRef :
-					{
-						auto * ref = static_cast< MD::FootnoteRef< MD::QStringTrait >* > ( it->get() );
+				case MD::ItemType::FootnoteRef :
+				{
+					auto * ref = static_cast< MD::FootnoteRef< MD::QStringTrait >* > ( it->get() );
 
-						const auto fit = doc->footnotesMap().find( ref->id() );
+					const auto fit = doc->footnotesMap().find( ref->id() );
 
-						if( fit != doc->footnotesMap().cend() )
-						{
-							this->addFootnote( ref->id(), fit->second, pdfData,
-								renderOpts, doc );
-						}
+					if( fit != doc->footnotesMap().cend() )
+					{
+						this->addFootnote( ref->id(), fit->second, pdfData,
+							renderOpts, doc );
 					}
-						break;
-
-					default :
-						break;
 				}
+					break;
+
+				default :
+					break;
 			}
 		}
 	};
 
-	if( std::find_if( m_footnotes.cbegin(), m_footnotes.cend(),
-		[&refId] ( const auto & p ) { return p.first == refId; } ) == m_footnotes.cend() )
+	if( !m_footnotesIds.contains( refId ) )
 	{
-		m_footnotes.append( { refId, f } );
+		m_footnotes.append( { refId, f, pdfData.currentFile } );
+		m_footnotesIds.insert( refId );
 
 		PdfAuxData tmpData = pdfData;
+		// Anchors are moved to not detach them on insertion.
+		tmpData.footnotesAnchorsMap = std::move( pdfData.footnotesAnchorsMap );
 		tmpData.coords = { { pdfData.coords.margins.left, pdfData.coords.margins.right,
 				pdfData.coords.margins.top, pdfData.coords.margins.bottom },
 			pdfData.page->GetRect().Width,
@@ -4145,14 +5882,14 @@ PdfRenderer::addFootnote( const QString & refId,
 		reserveSpaceForFootnote( pdfData, renderOpts, h, pdfData.coords.y,
 			pdfData.currentPageIdx, lineHeight );
 
-		pdfData.footnotesAnchorsMap = tmpData.footnotesAnchorsMap;
+		pdfData.footnotesAnchorsMap = std::move( tmpData.footnotesAnchorsMap );
 
 		findFootnoteRefs( f.get(), pdfData );
 	}
 }
 
 QPair< QVector< WhereDrawn >, WhereDrawn >
-PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfAuxData & pdfData,
+PdfRenderer::drawTableRow( AuxTable & table, int row, PdfAuxData & pdfData,
 	double offset, double lineHeight, const RenderOpts & renderOpts,
 	std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
 	QVector< QPair< QString, std::shared_ptr< MD::Footnote< MD::QStringTrait > > > > & footnotes,
@@ -4169,8 +5906,11 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 
 	emit status( tr( "Drawing table row." ) );
 
+	// Cells and borders are drawn from the start page of the row.
+	PagePin pin( pdfData, true );
+
 	auto * textFont = createFont( renderOpts.m_textFont, false, false, renderOpts.m_textFontSize,
-		pdfData.doc, scale, pdfData );
+		pdfData.context->doc, scale, pdfData );
 
 	const auto startPage = pdfData.currentPageIndex();
 	const auto startY = pdfData.coords.y;
@@ -4184,10 +5924,8 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 	TextToDraw text;
 	QMap< QString, QVector< QPair< QRectF, unsigned int > > > links;
 
-	int column = 0;
-
 	// Draw cells.
-	for( auto it = table.cbegin(), last = table.cend(); it != last; ++it )
+	for( int column = 0; column < table.columnsCount; ++column )
 	{
 		{
 			QMutexLocker lock( &m_mutex );
@@ -4198,8 +5936,8 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 
 		emit status( tr( "Drawing table cell." ) );
 
-		text.alignment = it->at( 0 ).alignment;
-		text.availableWidth = it->at( 0 ).width;
+		text.alignment = table.alignments.at( column );
+		text.availableWidth = table.widths.at( column );
 		text.lineHeight = lineHeight;
 
 		pdfData.currentPainterIdx = startPage;
@@ -4209,7 +5947,7 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 		auto startX = pdfData.coords.margins.left + offset;
 
 		for( int i = 0; i < column; ++i )
-			startX += table[ i ][ 0 ].width + c_tableMargin * 2.0;
+			startX += table.widths.at( i ) + c_tableMargin * 2.0;
 
 		startX += c_tableMargin;
 
@@ -4226,26 +5964,29 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 				y -= pdfData.extraInFootnote;
 		}
 
+		const auto cell = table.cell( row, column );
+		const auto cfirst = table.items.cbegin() + table.cells.at( cell );
+		const auto clast = table.items.cbegin() + table.cells.at( cell + 1 );
+
 		bool textBefore = false;
-		const CellItem * lastItemInCell = it->at( row ).items.isEmpty() ?
-			nullptr : &( it->at( row ).items.back() );
+		const AuxTable::Item * lastItemInCell = ( cfirst == clast ? nullptr : &( *( clast - 1 ) ) );
 		const bool wasTextInLastPos = lastItemInCell ? ( !lastItemInCell->word.isEmpty() ||
-			( lastItemInCell->image.isEmpty() && !lastItemInCell->url.isEmpty() ) ||
+			( !lastItemInCell->isImage() && !lastItemInCell->url.isEmpty() ) ||
 			!lastItemInCell->footnote.isEmpty() ) : false;
 
 		bool addMargin = false;
 
-		for( auto c = it->at( row ).items.cbegin(), clast = it->at( row ).items.cend(); c != clast; ++c )
+		for( auto c = cfirst; c != clast; ++c )
 		{
-			if( !c->image.isNull() && !text.text.isEmpty() )
+			if( c->isImage() && !text.text.isEmpty() )
 			{
-				drawTextLineInTable( renderOpts, x, y, text, lineHeight, pdfData,
+				drawTextLineInTable( renderOpts, table, x, y, text, lineHeight, pdfData,
 					links, textFont, currentPage,
 					endPage, endY, footnotes, scale );
 				addMargin = false;
 			}
 
-			if( !c->image.isNull() )
+			if( c->isImage() )
 			{
 				if( textBefore )
 					y -= lineHeight;
@@ -4253,16 +5994,19 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 				if( addMargin )
 					y -= c_tableMargin;
 
-				auto img = pdfData.doc->CreateImage();
-				img->LoadFromBuffer( { c->image.data(), static_cast< size_t > ( c->image.size() ) } );
+				const auto & image = table.images.at( c->image );
+
+				const auto img = pdfData.embedImage( image );
+				const auto pixels = imagePixelSize( image );
 
-				const double iWidth = std::round( (double) img->GetWidth() /
-					(double) pdfData.dpi * 72.0 );
-				const double iHeight = std::round( (double) img->GetHeight() /
-					(double) pdfData.dpi * 72.0 );
-				const double dpiScale = (double) img->GetWidth() / iWidth;
+				const double iWidth = std::round( (double) pixels.width() /
+					(double) pdfData.context->dpi * 72.0 );
+				const double iHeight = std::round( (double) pixels.height() /
+					(double) pdfData.context->dpi * 72.0 );
+				const double dpiScale = (double) pixels.width() / iWidth;
 
-				auto ratio = ( iWidth > it->at( 0 ).width ? it->at( 0 ).width / iWidth * scale :
+				auto ratio = ( iWidth > table.widths.at( column ) ?
+					table.widths.at( column ) / iWidth * scale :
 					1.0 * scale );
 
 				auto h = iHeight * ratio;
@@ -4287,16 +6031,16 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 				const auto w = iWidth * ratio;
 				auto o = 0.0;
 
-				if( w < table[ column ][ 0 ].width )
-					o = ( table[ column ][ 0 ].width - w ) / 2.0;
+				if( w < table.widths.at( column ) )
+					o = ( table.widths.at( column ) - w ) / 2.0;
 
 				y -= iHeight * ratio;
 
 				pdfData.drawImage( x + o, y, img.get(), ratio / dpiScale, ratio / dpiScale );
 
 				if( !c->url.isEmpty() )
-					links[ c->url ].append( qMakePair( QRectF( x + o, y,
-							c->width( pdfData, this, scale ),
+					links[ table.string( c->url ) ].append( qMakePair( QRectF( x + o, y,
+							c->width,
 							iHeight * ratio ),
 						currentPage ) );
 
@@ -4307,17 +6051,14 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 			{
 				addMargin = false;
 
-				auto * font = createFont( c->font.family, c->font.bold, c->font.italic,
-					c->font.size, pdfData.doc, scale, pdfData );
-
-				auto w = pdfData.stringWidth( font, c->font.size, scale,
-					createUtf8String( c->word.isEmpty() ? c->url : c->word ) );
+				// Widths of items are measured once in calculateCellsSize().
+				auto w = ( c->word.isEmpty() && c->url.isEmpty() ? 0.0 : c->width );
 				double s = 0.0;
 
 				if( !text.text.isEmpty() )
 				{
 					if( text.text.last().font == c->font )
-						s = pdfData.stringWidth( font, c->font.size, scale, " " );
+						s = table.spaceWidths.at( c->font );
 					else
 						s = pdfData.stringWidth( textFont, renderOpts.m_textFontSize, scale, " " );
 				}
@@ -4326,16 +6067,18 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 
 				if( c + 1 != clast && !( c + 1 )->footnote.isEmpty() )
 				{
-					auto * f1 = createFont( ( c + 1 )->font.family, ( c + 1 )->font.bold,
-						( c + 1 )->font.italic, ( c + 1 )->font.size, pdfData.doc, scale, pdfData );
+					const auto & nf = table.fonts.at( ( c + 1 )->font );
+
+					auto * f1 = createFont( nf.family, nf.bold, nf.italic, nf.size,
+						pdfData.context->doc, scale, pdfData );
 
-					fw = pdfData.stringWidth( f1, ( c + 1 )->font.size, scale,
-						createUtf8String( ( c + 1 )->footnote ) );
+					fw = pdfData.stringWidth( f1, nf.size, scale,
+						createUtf8String( table.string( ( c + 1 )->footnote ) ) );
 					w += fw;
 				}
 
-				if( text.width + s + w < it->at( 0 ).width ||
-					qAbs( text.width + s + w - it->at( 0 ).width ) < 0.01 )
+				if( text.width + s + w < table.widths.at( column ) ||
+					qAbs( text.width + s + w - table.widths.at( column ) ) < 0.01 )
 				{
 					text.text.append( *c );
 
@@ -4348,7 +6091,7 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 				{
 					if( !text.text.isEmpty() )
 					{
-						drawTextLineInTable( renderOpts, x, y, text, lineHeight, pdfData, links,
+						drawTextLineInTable( renderOpts, table, x, y, text, lineHeight, pdfData, links,
 							textFont, currentPage, endPage, endY, footnotes, scale );
 						text.text.append( *c );
 
@@ -4361,7 +6104,7 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 					{
 						text.text.append( *c );
 						text.width += w;
-						drawTextLineInTable( renderOpts, x, y, text, lineHeight, pdfData, links,
+						drawTextLineInTable( renderOpts, table, x, y, text, lineHeight, pdfData, links,
 							textFont, currentPage, endPage, endY, footnotes, scale );
 
 						if( c + 1 != clast && !( c + 1 )->footnote.isEmpty() )
@@ -4380,7 +6123,7 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 		}
 
 		if( !text.text.isEmpty() )
-			drawTextLineInTable( renderOpts, x, y, text, lineHeight, pdfData,
+			drawTextLineInTable( renderOpts, table, x, y, text, lineHeight, pdfData,
 				links, textFont, currentPage,
 				endPage, endY, footnotes, scale );
 
@@ -4389,8 +6132,6 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 
 		if( y < endY  && currentPage == pdfData.currentPageIndex() )
 			endY = y;
-
-		++column;
 	}
 
 	drawRowBorder( pdfData, startPage, ret, renderOpts, offset, table, startY, endY );
@@ -4405,7 +6146,7 @@ PdfRenderer::drawTableRow( QVector< QVector< CellData > > & table, int row, PdfA
 
 void
 PdfRenderer::drawRowBorder( PdfAuxData & pdfData, int startPage, QVector< WhereDrawn > & ret,
-	const RenderOpts & renderOpts, double offset, const QVector< QVector< CellData > > & table,
+	const RenderOpts & renderOpts, double offset, const AuxTable & table,
 	double startY, double endY )
 {
 	for( int i = startPage; i <= pdfData.currentPageIndex(); ++i )
@@ -4417,8 +6158,8 @@ PdfRenderer::drawRowBorder( PdfAuxData & pdfData, int startPage, QVector< WhereD
 		const auto startX = pdfData.coords.margins.left + offset;
 		auto endX = startX;
 
-		for( int c = 0; c < table.size(); ++ c )
-			endX += table.at( c ).at( 0 ).width + c_tableMargin * 2.0;
+		for( int c = 0; c < table.columnsCount; ++ c )
+			endX += table.widths.at( c ) + c_tableMargin * 2.0;
 
 		if( i == startPage )
 		{
@@ -4438,9 +6179,9 @@ PdfRenderer::drawRowBorder( PdfAuxData & pdfData, int startPage, QVector< WhereD
 				y = pdfData.allowedY( i );
 			}
 
-			for( int c = 0; c < table.size(); ++c )
+			for( int c = 0; c < table.columnsCount; ++c )
 			{
-				x += table.at( c ).at( 0 ).width + c_tableMargin * 2.0;
+				x += table.widths.at( c ) + c_tableMargin * 2.0;
 
 				pdfData.drawLine( x, startY, x, y );
 			}
@@ -4459,9 +6200,9 @@ PdfRenderer::drawRowBorder( PdfAuxData & pdfData, int startPage, QVector< WhereD
 
 			pdfData.drawLine( x, sy, x, y );
 
-			for( int c = 0; c < table.size(); ++c )
+			for( int c = 0; c < table.columnsCount; ++c )
 			{
-				x += table.at( c ).at( 0 ).width + c_tableMargin * 2.0;
+				x += table.widths.at( c ) + c_tableMargin * 2.0;
 
 				pdfData.drawLine( x, sy, x, y );
 			}
@@ -4480,9 +6221,9 @@ PdfRenderer::drawRowBorder( PdfAuxData & pdfData, int startPage, QVector< WhereD
 
 			pdfData.drawLine( x, sy, x, y );
 
-			for( int c = 0; c < table.size(); ++c )
+			for( int c = 0; c < table.columnsCount; ++c )
 			{
-				x += table.at( c ).at( 0 ).width + c_tableMargin * 2.0;
+				x += table.widths.at( c ) + c_tableMargin * 2.0;
 
 				pdfData.drawLine( x, sy, x, y );
 			}
@@ -4498,7 +6239,7 @@ PdfRenderer::drawRowBorder( PdfAuxData & pdfData, int startPage, QVector< WhereD
 }
 
 void
-PdfRenderer::drawTextLineInTable( const RenderOpts & renderOpts,
+PdfRenderer::drawTextLineInTable( const RenderOpts & renderOpts, const AuxTable & table,
 	double x, double & y, TextToDraw & text, double lineHeight,
 	PdfAuxData & pdfData, QMap< QString, QVector< QPair< QRectF, unsigned int > > > & links,
 	Font * font, int & currentPage, int & endPage, double & endY,
@@ -4536,97 +6277,104 @@ PdfRenderer::drawTextLineInTable( const RenderOpts & renderOpts,
 	}
 	else
 	{
-		const auto str = ( text.text.first().word.isEmpty() ? text.text.first().url :
-			text.text.first().word );
+		auto & first = text.text.first();
+		const auto & firstFont = table.fonts.at( first.font );
+		const auto span = ( first.word.isEmpty() ? first.url : first.word );
 
-		QString res;
+		qint32 length = 0;
 
 		double w = 0.0;
 
-		auto * f = createFont( text.text.first().font.family, text.text.first().font.bold,
-			text.text.first().font.italic, text.text.first().font.size, pdfData.doc, scale, pdfData );
+		auto * f = createFont( firstFont.family, firstFont.bold,
+			firstFont.italic, firstFont.size, pdfData.context->doc, scale, pdfData );
 
-		for( const auto & ch : str )
+		for( const auto & ch : table.view( span ) )
 		{
-			w += pdfData.stringWidth( f, text.text.first().font.size, scale,
+			w += pdfData.stringWidth( f, firstFont.size, scale,
 				createUtf8String( QString( ch ) ) );
 
 			if( w >= text.availableWidth )
 				break;
 			else
-				res.append( ch );
+				++length;
 		}
 
-		text.text.first().word = res;
+		first.word = { span.pos, length };
+		first.width = table.itemWidth( first, pdfData, this, scale );
 	}
 
 	for( auto it = text.text.cbegin(), last = text.text.cend(); it != last; ++it )
 	{
-		auto * f = createFont( it->font.family, it->font.bold,
-			it->font.italic, it->font.size, pdfData.doc, scale, pdfData );
+		const auto & itFont = table.fonts.at( it->font );
+
+		auto * f = createFont( itFont.family, itFont.bold,
+			itFont.italic, itFont.size, pdfData.context->doc, scale, pdfData );
 
-		if( it->background.isValid() )
+		if( it->background )
 		{
-			pdfData.setColor( it->background );
+			pdfData.setColor( table.colors.at( it->background ) );
 
-			pdfData.drawRectangle( x, y + pdfData.fontDescent( f, it->font.size, scale ),
-				it->width( pdfData, this, scale ), pdfData.lineSpacing( f, it->font.size, scale ),
+			pdfData.drawRectangle( x, y + pdfData.fontDescent( f, itFont.size, scale ),
+				it->width, pdfData.lineSpacing( f, itFont.size, scale ),
 				PoDoFo::PdfPathDrawMode::Fill );
 
 			pdfData.restoreColor();
 		}
 
-		if( it->color.isValid() )
-			pdfData.setColor( it->color );
+		if( it->color )
+			pdfData.setColor( table.colors.at( it->color ) );
 
-		pdfData.drawText( x, y, createUtf8String( it->word.isEmpty() ?
-			it->url : it->word ), f, it->font.size * scale, 1.0, it->font.strikethrough );
+		pdfData.drawText( x, y, createUtf8String( table.string( it->word.isEmpty() ?
+			it->url : it->word ) ), f, itFont.size * scale, 1.0, itFont.strikethrough );
 
 		pdfData.restoreColor();
 
 		if( !it->url.isEmpty() )
-			links[ it->url ].append( qMakePair( QRectF( x, y, it->width( pdfData, this, scale ),
+			links[ table.string( it->url ) ].append( qMakePair( QRectF( x, y, it->width,
 				lineHeight ), currentPage ) );
 
-		x += it->width( pdfData, this, scale );
+		x += it->width;
 
 		if( it + 1 != last && !( it + 1 )->footnote.isEmpty() )
 		{
 			++it;
 
-			const auto str = createUtf8String( it->footnote );
+			const auto str = createUtf8String( table.string( it->footnote ) );
+			const auto footnoteSize = table.fonts.at( it->font ).size * c_footnoteScale;
+			const auto & footnote = table.footnotes.at( it->footnoteRef );
 
-			const auto w = pdfData.stringWidth( f, it->font.size * c_footnoteScale, scale, str );
+			const auto w = pdfData.stringWidth( f, footnoteSize, scale, str );
 
-			m_unresolvedFootnotesLinks.insert( it->footnoteRef,
+			m_unresolvedFootnotesLinks.insert( footnote.first,
 				qMakePair( QRectF( x, y, w, lineHeight ),
 					pdfData.currentPageIndex() ) );
 
 			pdfData.setColor( renderOpts.m_linkColor );
 
 			pdfData.drawText( x, y + lineHeight -
-					pdfData.lineSpacing( f, it->font.size * c_footnoteScale, scale ),
-				str, f, it->font.size * c_footnoteScale * scale, 1.0, false );
+					pdfData.lineSpacing( f, footnoteSize, scale ),
+				str, f, footnoteSize * scale, 1.0, false );
 
 			pdfData.restoreColor();
 
 			x += w;
 
-			footnotes.append( { it->footnoteRef, it->footnoteObj } );
+			footnotes.append( footnote );
 		}
 
 		if( it + 1 != last )
 		{
 			auto tmpX = x;
+			const auto size = table.fonts.at( it->font ).size;
 
-			if( it->background.isValid() && it->font == ( it + 1 )->font )
+			if( it->background && it->font == ( it + 1 )->font )
 			{
-				pdfData.setColor( it->background );
+				pdfData.setColor( table.colors.at( it->background ) );
 
-				const auto sw = pdfData.stringWidth( f, it->font.size, scale, " " );
+				const auto sw = pdfData.stringWidth( f, size, scale, " " );
 
-				pdfData.drawRectangle( x, y + pdfData.fontDescent( f, it->font.size, scale ),
-					sw, pdfData.lineSpacing( f, it->font.size, scale ),
+				pdfData.drawRectangle( x, y + pdfData.fontDescent( f, size, scale ),
+					sw, pdfData.lineSpacing( f, size, scale ),
 					PoDoFo::PdfPathDrawMode::Fill );
 
 				x += sw;
@@ -4634,11 +6382,11 @@ PdfRenderer::drawTextLineInTable( const RenderOpts & renderOpts,
 				pdfData.restoreColor();
 			}
 			else
-				x += pdfData.stringWidth( font, it->font.size, scale, " " );
+				x += pdfData.stringWidth( font, size, scale, " " );
 
-			if( !( it + 1 )->url.isEmpty() && it->url == ( it + 1 )->url )
-				links[ it->url ].append( qMakePair( QRectF( tmpX, y, x - tmpX, lineHeight ),
-					currentPage ) );
+			if( !( it + 1 )->url.isEmpty() && table.view( it->url ) == table.view( ( it + 1 )->url ) )
+				links[ table.string( it->url ) ].append( qMakePair(
+					QRectF( tmpX, y, x - tmpX, lineHeight ), currentPage ) );
 		}
 	}
 
@@ -4707,18 +6455,18 @@ PdfRenderer::processLinksInTable( PdfAuxData & pdfData,
 
 			rects.append( r );
 
-			if( !pdfData.anchors.contains( url ) &&
-				pdfData.md->labeledHeadings().find( url ) == pdfData.md->labeledHeadings().cend() )
+			if( !pdfData.context->anchors.contains( url ) &&
+				pdfData.context->md->labeledHeadings().find( url ) == pdfData.context->md->labeledHeadings().cend() )
 			{
 				for( const auto & r : std::as_const( rects ) )
 				{
-					auto & annot = pdfData.doc->GetPages().GetPageAt(
+					auto & annot = pdfData.context->doc->GetPages().GetPageAt(
 						static_cast< unsigned int >( r.second ) )
 							.GetAnnotations().CreateAnnot< PoDoFo::PdfAnnotationLink >(
 						Rect( r.first.x(), r.first.y(), r.first.width(), r.first.height() ) );
 					annot.SetBorderStyle( 0.0, 0.0, 0.0 );
 
-					auto action = std::make_shared< PoDoFo::PdfAction >( *pdfData.doc,
+					auto action = std::make_shared< PoDoFo::PdfAction >( *pdfData.context->doc,
 						PoDoFo::PdfActionType::URI );
 					action->SetURI( url.toLatin1().data() );
 
@@ -4736,6 +6484,14 @@ PdfRenderer::minNecessaryHeight( PdfAuxData & pdfData, const RenderOpts & render
 	std::shared_ptr< MD::Item< MD::QStringTrait > > item, std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
 	double offset, double scale )
 {
+	TimelineSpan span( m_timeline, "minNecessaryHeight", "measure" );
+
+	if( span )
+	{
+		span.setArg( QStringLiteral( "type" ), QLatin1String( itemTypeName( item->type() ) ) );
+		span.setArg( QStringLiteral( "line" ), item->startLine() + 1 );
+	}
+
 	QVector< WhereDrawn > ret;
 
 	PdfAuxData tmp = pdfData;
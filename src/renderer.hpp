@@ -36,6 +36,11 @@
 #include <QNetworkReply>
 #include <QStack>
 #include <QByteArray>
+#include <QThreadPool>
+#include <QJsonObject>
+#include <QHash>
+#include <QSet>
+#include <QSizeF>
 
 #ifdef MD_PDF_TESTING
 #include <QFile>
@@ -78,11 +83,17 @@ using String = Utf8String;
 #endif // MD_PDF_USE_PODOFO
 
 // C++ include.
+#include <array>
+#include <future>
+#include <list>
 #include <memory>
 #include <string_view>
+#include <variant>
 
 // nd-pdf include.
 #include "syntax.hpp"
+#include "trace.hpp"
+#include "report.hpp"
 
 
 //! Footnote scale.
@@ -114,6 +125,53 @@ struct DrawPrimitive {
 #endif // MD_PDF_TESTING
 
 
+//
+// ImagesCache
+//
+
+//! Cache of images shared between renderers, thread-safe.
+/*!
+	Least recently used images are dropped when size of the cache exceeds
+	the given count of bytes.
+*/
+class ImagesCache final {
+public:
+	//! Default maximum size of the cache.
+	static constexpr qint64 c_defaultMaxBytes = 256 * 1024 * 1024;
+
+	explicit ImagesCache( qint64 maxBytes = c_defaultMaxBytes );
+
+	//! \return Is image found? Found image becomes the most recently used.
+	bool find( const QString & key, QByteArray & data );
+	//! Insert image.
+	void insert( const QString & key, const QByteArray & data );
+	//! \return Size of the cached images in bytes.
+	qint64 bytes() const;
+
+private:
+	//! Cached image.
+	struct Entry {
+		//! Data.
+		QByteArray data;
+		//! Position in the order of use.
+		std::list< QString >::iterator pos;
+	}; // struct Entry
+
+	//! Mutex.
+	mutable QMutex m_mutex;
+	//! Keys from the most recently used.
+	std::list< QString > m_order;
+	//! Images by their keys.
+	QHash< QString, Entry > m_images;
+	//! Size of the cached images.
+	qint64 m_bytes;
+	//! Maximum size of the cached images.
+	qint64 m_maxBytes;
+
+	Q_DISABLE_COPY( ImagesCache )
+}; // class ImagesCache
+
+
 //
 // RenderOpts
 //
@@ -149,6 +207,33 @@ struct RenderOpts
 	quint16 m_dpi;
 	//! Syntax highlighter.
 	std::shared_ptr< Syntax > m_syntax;
+	//! Compression level of streams (0-9), -1 for the default.
+	int m_compressionLevel = -1;
+	//! Count of threads for compressing streams, 0 for the ideal count. Streams are
+	//! re-compressed only with compression level, PoDoFo compresses them with the
+	//! default one itself.
+	int m_compressionThreads = 0;
+	//! Write cross-reference table as a compressed stream.
+	bool m_useXRefStream = false;
+	//! Embed whole fonts instead of subsets of used glyphs.
+	bool m_fullFontEmbedding = false;
+	//! Use not embedded standard 14 fonts instead of real ones.
+	bool m_useStandardFonts = false;
+	//! Cache of images shared between renderers, may be null.
+	std::shared_ptr< ImagesCache > m_imagesCache;
+	//! Only lay out the document, page map in JSON is saved instead of PDF.
+	bool m_dryRun = false;
+	//! Record drawing primitives into this binary trace file, if not empty.
+	QString m_traceFileName;
+	//! Write timeline of the render in Chrome trace event format to this file, if not empty.
+	QString m_timelineFileName;
+	//! Finish pages that can't change anymore while rendering, otherwise all pages
+	//! are kept open till the end. Finishing releases painters and uncompressed
+	//! content, pages stay in the document till save, so memory still grows.
+	bool m_finishPagesEarly = true;
+	//! Fail the render when resident memory of the process exceeds this count of bytes,
+	//! 0 means no limit.
+	qint64 m_memoryBudget = 0;
 
 #ifdef MD_PDF_TESTING
 	bool printDrawings = false;
@@ -194,6 +279,10 @@ static const double c_beforeHeading = 15.0;
 static const double c_blockquoteBaseOffset = 10.0;
 static const double c_blockquoteMarkWidth = 3.0;
 static const double c_tableMargin = 2.0;
+//! Cells of tables with at least this count of cells are measured in parallel.
+static const int c_parallelCellsCount = 256;
+//! Rows of tables are laid out and drawn by windows of this count of rows.
+static const int c_tableRowsWindow = 1024;
 
 //! Mrgins.
 struct PageMargins {
@@ -215,20 +304,187 @@ struct CoordsPageAttribs {
 class PdfRenderer;
 
 
-//! Auxiliary struct for rendering.
-struct PdfAuxData {
+//
+// PainterSink
+//
+
+//! Sink of drawing primitives that draws on PoDoFo painters.
+class PainterSink {
+public:
+	//! Draw text.
+	void drawText( Painter & p, double x, double y, const char * text, Font * font,
+		double size, double scale, bool strikeout );
+	//! Draw image.
+	void drawImage( Painter & p, double x, double y, Image * img, double xScale, double yScale );
+	//! Draw line.
+	void drawLine( Painter & p, double x1, double y1, double x2, double y2 );
+	//! Draw rectangle.
+	void drawRectangle( Painter & p, double x, double y, double width, double height,
+		PoDoFo::PdfPathDrawMode m );
+	//! Draw circle.
+	void drawCircle( Painter & p, double x, double y, double r, PoDoFo::PdfPathDrawMode m );
+	//! Set color.
+	void setColor( Painter & p, const QColor & c );
+	//! Save document.
+	void save( Document * doc, const QString & fileName, const RenderOpts & opts );
+}; // class PainterSink
+
+
+//
+// NullSink
+//
+
+//! Sink of drawing primitives that discards everything, layout is done as usual.
+class NullSink final {
+public:
+	void drawText( Painter &, double, double, const char *, Font *, double, double, bool ) {}
+	void drawImage( Painter &, double, double, Image *, double, double ) {}
+	void drawLine( Painter &, double, double, double, double ) {}
+	void drawRectangle( Painter &, double, double, double, double, PoDoFo::PdfPathDrawMode ) {}
+	void drawCircle( Painter &, double, double, double, PoDoFo::PdfPathDrawMode ) {}
+	void setColor( Painter &, const QColor & ) {}
+	void save( Document *, const QString &, const RenderOpts & ) {}
+}; // class NullSink
+
+
+//
+// RecordingSink
+//
+
+//! Sink that draws primitives and records them into the binary trace.
+class RecordingSink final
+	:	public PainterSink
+{
+public:
+	explicit RecordingSink( const QString & fileName );
+
+	//! Open file.
+	bool open();
+
+	void drawText( Painter & p, double x, double y, const char * text, Font * font,
+		double size, double scale, bool strikeout );
+	void drawImage( Painter & p, double x, double y, Image * img, double xScale, double yScale );
+	void drawLine( Painter & p, double x1, double y1, double x2, double y2 );
+	void drawRectangle( Painter & p, double x, double y, double width, double height,
+		PoDoFo::PdfPathDrawMode m );
+	void drawCircle( Painter & p, double x, double y, double r, PoDoFo::PdfPathDrawMode m );
+	void setColor( Painter & p, const QColor & c );
+	void save( Document * doc, const QString & fileName, const RenderOpts & opts );
+
+private:
+	//! \return Index of the page of the painter.
+	static quint32 pageIndex( const Painter & p );
+
+private:
+	TraceWriter m_writer;
+}; // class RecordingSink
+
+#ifdef MD_PDF_TESTING
+
+//
+// PrintingSink
+//
+
+//! Sink that prints primitives to the file of test data.
+class PrintingSink final
+	:	public PainterSink
+{
+public:
+	explicit PrintingSink( const QString & fileName );
+
+	//! Open file.
+	bool open();
+
+	void drawText( Painter & p, double x, double y, const char * text, Font * font,
+		double size, double scale, bool strikeout );
+	void drawImage( Painter & p, double x, double y, Image * img, double xScale, double yScale );
+	void drawLine( Painter & p, double x1, double y1, double x2, double y2 );
+	void drawRectangle( Painter & p, double x, double y, double width, double height,
+		PoDoFo::PdfPathDrawMode m );
+	void save( Document * doc, const QString & fileName, const RenderOpts & opts );
+
+private:
+	QFile m_file;
+	QTextStream m_stream;
+}; // class PrintingSink
+
+
+//
+// VerifyingSink
+//
+
+//! Sink that draws primitives and compares them with test data.
+class VerifyingSink final
+	:	public PainterSink
+{
+public:
+	VerifyingSink( const QVector< DrawPrimitive > & data, PdfRenderer * self );
+
+	//! \return Are all primitives from test data drawn?
+	bool isFinished() const;
+
+	void drawText( Painter & p, double x, double y, const char * text, Font * font,
+		double size, double scale, bool strikeout );
+	void drawImage( Painter & p, double x, double y, Image * img, double xScale, double yScale );
+	void drawLine( Painter & p, double x1, double y1, double x2, double y2 );
+	void drawRectangle( Painter & p, double x, double y, double width, double height,
+		PoDoFo::PdfPathDrawMode m );
+
+private:
+	QVector< DrawPrimitive > m_data;
+	int m_pos = 0;
+	PdfRenderer * m_self;
+}; // class VerifyingSink
+
+#endif // MD_PDF_TESTING
+
+//! Receiver of drawing primitives. Sink is chosen at runtime, every primitive
+//! is dispatched with one std::visit (a jump table, no virtual functions), and
+//! sink specific accounting is selected with if constexpr inside the visitor.
+//! Printing and verifying sinks exist only in testing builds.
+using DrawSink = std::variant< PainterSink, NullSink, RecordingSink
+#ifdef MD_PDF_TESTING
+	, PrintingSink, VerifyingSink
+#endif // MD_PDF_TESTING
+	>;
+
+
+//! Data of the render shared by all layouts of the document, speculative layouts too.
+struct PdfRenderContext {
 	//! Document.
 	Document * doc = nullptr;
 	//! Painters.
 	std::vector< std::shared_ptr< Painter > > * painters = nullptr;
+	//! Receiver of drawing primitives.
+	DrawSink * sink = nullptr;
+	//! Report of the render, may be null.
+	RenderReport * report = nullptr;
+	//! Labels of anchors in document, links are checked against them.
+	QSet< QString > anchors;
+	//! DPI.
+	quint16 dpi;
+	//! Markdown document.
+	std::shared_ptr< MD::Document< MD::QStringTrait > > md;
+	//! Syntax highlighter.
+	std::shared_ptr< Syntax > syntax;
+
+#ifdef MD_PDF_TESTING
+	QMap< QString, QString > fonts;
+#endif // MD_PDF_TESTING
+}; // struct PdfRenderContext
+
+
+//! Auxiliary struct for rendering, it's a cursor of layout and is copied
+//! for speculative layouts, shared data of the render is in the context.
+struct PdfAuxData {
+	//! Shared data of the render.
+	PdfRenderContext * context = nullptr;
 	//! Page.
 	Page * page = nullptr;
 	//! Index of the current page.
 	int currentPageIdx = -1;
 	//! Coordinates and margins.
 	CoordsPageAttribs coords;
-	//! Anchors in document.
-	QStringList anchors;
 	//! Reserved spaces on the pages for footnotes.
 	QMap< unsigned int, double > reserved;
 	//! Drawing footnotes or the document?
@@ -237,6 +493,10 @@ struct PdfAuxData {
 	int footnotePageIdx = -1;
 	//! Current painter index.
 	int currentPainterIdx = -1;
+	//! Index of the first page which painter is not finished yet.
+	int firstUnfinishedPageIdx = 0;
+	//! Start pages of items being drawn, these pages can't be finished.
+	QVector< int > pinnedPages;
 	//! Current index of the footnote (for drawing number in the PDF).
 	int currentFootnote = 1;
 	//! Is this first item on the page?
@@ -249,12 +509,6 @@ struct PdfAuxData {
 	double extraInFootnote = 0.0;
 	//! Colors stack.
 	QStack< QColor > colorsStack;
-	//! DPI.
-	quint16 dpi;
-	//! Markdown document.
-	std::shared_ptr< MD::Document< MD::QStringTrait > > md;
-	//! Syntax highlighter.
-	std::shared_ptr< Syntax > syntax;
 	//! Start line of procesing in the document.
 	long long int startLine = 0;
 	//! Start position in the start line.
@@ -266,17 +520,11 @@ struct PdfAuxData {
 	//! Current file.
 	QString currentFile;
 	//! Footnotes map to map anchors.
-	QMap< MD::Footnote< MD::QStringTrait > *, QPair< QString, int > > footnotesAnchorsMap;
-
-#ifdef MD_PDF_TESTING
-	QMap< QString, QString > fonts;
-	QSharedPointer< QFile > drawingsFile;
-	QSharedPointer< QTextStream > drawingsStream;
-	bool printDrawings = false;
-	QVector< DrawPrimitive > testData;
-	int testPos = 0;
-	PdfRenderer * self = nullptr;
-#endif // MD_PDF_TESTING
+	QHash< MD::Footnote< MD::QStringTrait > *, QPair< QString, int > > footnotesAnchorsMap;
+	//! Estimated bytes of content of pages, content is released when page is finished.
+	QVector< qint64 > contentBytes;
+	//! Bytes of images embedded in PDF.
+	qint64 imagesBytes = 0;
 
 	//! \return Top Y coordinate on the page.
 	double topY( int page ) const;
@@ -290,18 +538,28 @@ struct PdfAuxData {
 	double allowedY( int page ) const;
 	//! Reserve space for drawing, i.e. move footnotes on the next page.
 	void freeSpaceOn( int page );
+	//! \return Index of the lowest page that still can be changed.
+	int lowestReachablePage() const;
 
+	//! \return Painter of the current page, throws if the page is finished.
+	Painter & painter();
+	//! Count bytes of content drawn on the current page.
+	void countContent( qint64 bytes );
 	//! Draw text
 	void drawText( double x, double y, const char * text, Font * font, double size,
 		double scale, bool strikeout );
-	//! Draw image.
+	//! \return Image embedded into the document, null in dry run where nothing is drawn.
+	std::unique_ptr< Image > embedImage( const QByteArray & data );
+	//! Draw image, \a img is null in dry run.
 	void drawImage( double x, double y, Image * img, double xScale, double yScale );
 	//! Draw line.
 	void drawLine( double x1, double y1, double x2, double y2 );
 	//! Save document.
-	void save( const QString & fileName );
+	void save( const QString & fileName, const RenderOpts & opts );
 	//! Draw rectangle.
 	void drawRectangle( double x, double y, double width, double height, PoDoFo::PdfPathDrawMode m );
+	//! Draw circle.
+	void drawCircle( double x, double y, double r, PoDoFo::PdfPathDrawMode m );
 
 	//! Set color.
 	void setColor( const QColor & c );
@@ -310,8 +568,6 @@ struct PdfAuxData {
 	//! Repeat color (needed after new page creation).
 	void repeatColor();
 
-	//! \return Image width.
-	double imageWidth( const QByteArray & image );
 	//! \return String width.
 	double stringWidth( Font * font, double size, double scale, const String & s ) const;
 	//! \return Line spacing.
@@ -335,6 +591,11 @@ struct WhereDrawn {
 //
 
 //! Renderer to PDF.
+/*!
+	Any number of renderers may work in parallel threads of one process.
+	Options may share syntax highlighter and cache of images, everything else
+	is owned by the renderer.
+*/
 class PdfRenderer
 	:	public Renderer
 {
@@ -343,6 +604,12 @@ class PdfRenderer
 signals:
 	//! Internal signal for start rendering.
 	void start();
+	//! Page map of the dry run.
+	void pageMap( const QJsonObject & map );
+	//! Timings and counters of the finished render.
+	void report( const QJsonObject & report );
+	//! Markdown is parsed by the renderer, emitted before rendering in the renderer's thread.
+	void parsed( std::shared_ptr< MD::Document< MD::QStringTrait > > doc );
 
 public:
 	PdfRenderer();
@@ -356,6 +623,11 @@ public:
 	//! Convert UTF-8 to QString.
 	static QString createQString( const char * str );
 
+	//! \return Peak resident set size of the process in bytes, 0 if unknown.
+	static qint64 peakMemoryUsage();
+	//! \return Current resident set size of the process in bytes, 0 if unknown.
+	static qint64 currentMemoryUsage();
+
 #ifdef MD_PDF_TESTING
 	bool isError() const;
 #endif
@@ -366,6 +638,13 @@ public slots:
 	//! Renderer will delete himself on job finish.
 	void render( const QString & fileName, std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
 		const RenderOpts & opts, bool testing = false ) override;
+	//! Parse Markdown file and render it. Parsing is done in the renderer's thread.
+	void renderFile( const QString & fileName, const QString & markdownFileName, bool recursive,
+		const RenderOpts & opts );
+	//! Parse Markdown file and render it in the calling thread, for a thread pool.
+	//! Renderer will delete himself on job finish.
+	void renderFileNow( const QString & fileName, const QString & markdownFileName,
+		bool recursive, const RenderOpts & opts );
 	//! Terminate rendering.
 	void terminate();
 
@@ -376,11 +655,13 @@ private slots:
 	void clean() override;
 
 protected:
-	friend struct CellItem;
-	friend struct CellData;
 #ifdef MD_PDF_TESTING
 	friend struct TestRendering;
 #endif
+#ifdef MD_PDF_BENCHMARK
+	friend struct MeasureBenchmark;
+	friend struct PrimitivesBenchmark;
+#endif
 
 	//! Create font.
 	Font * createFont( const QString & name, bool bold, bool italic, double size,
@@ -389,12 +670,18 @@ protected:
 private:
 	//! Create new page.
 	void createPage( PdfAuxData & pdfData );
+	//! Save page map of the dry run.
+	void savePageMap( const QJsonObject & map );
+	//! Update tracked memory, sample it for the phase and check memory budget.
+	void sampleMemory( PdfAuxData & pdfData, RenderReport::Phase phase );
 
 	//! Draw empty line.
 	void moveToNewLine( PdfAuxData & pdfData, double xOffset, double yOffset,
 		double yOffsetMultiplier, double yOffsetOnNewPage );
 	//! Load image.
 	QByteArray loadImage( MD::Image< MD::QStringTrait > * item );
+	//! Start loading of all images of the document in background.
+	void prefetchImages();
 	//! Make all links clickable.
 	void resolveLinks( PdfAuxData & pdfData );
 	//! Max width of numbered list bullet.
@@ -412,6 +699,10 @@ private:
 
 	//! Finish pages.
 	void finishPages( PdfAuxData & pdfData );
+	//! Finish pages before the given one, they can't be changed anymore.
+	void finishPagesBefore( PdfAuxData & pdfData, int pageIdx );
+	//! Finish pages before the lowest reachable one, if it's allowed by options.
+	void finishUnreachablePages( PdfAuxData & pdfData );
 
 	//! Draw heading.
 	QPair< QVector< WhereDrawn >, WhereDrawn > drawHeading( PdfAuxData & pdfData,
@@ -552,6 +843,8 @@ private:
 		//! Move to next line.
 		void moveToNextLine() { ++m_pos; }
 		//! Is drawing? This struct can be used to precalculate widthes and for actual drawing.
+		//! Only drawString() is instantiated separately for both modes, the other
+		//! layout functions check it and CalcHeightOpt at runtime.
 		bool isDrawing() const { return m_drawing; }
 		//! Set drawing.
 		void setDrawing( bool on = true ) { m_drawing = on; }
@@ -566,6 +859,8 @@ private:
 
 		//! \return Height of first item.
 		double firstItemHeight() const;
+		//! \return Estimated size of buffers in bytes.
+		qint64 memoryUsage() const;
 		//! Calculate scales.
 		void calcScale( double lineWidth );
 
@@ -640,6 +935,36 @@ private:
 		long long int startPos,
 		long long int endLine,
 		long long int endPos );
+	//! Draw string, or only measure it into CustomWidth if \p Draw is false.
+	template< bool Draw >
+	QVector< QPair< QRectF, unsigned int > > drawStringImpl( PdfAuxData & pdfData,
+		const RenderOpts & renderOpts,
+		const QString & str,
+		Font * firstSpaceFont,
+		double firstSpaceFontSize,
+		double firstSpaceFontScale,
+		Font * spaceFont,
+		double spaceFontSize,
+		double spaceFontScale,
+		Font * font,
+		double fontSize,
+		double fontScale,
+		double lineHeight,
+		std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
+		bool & newLine,
+		Font * footnoteFont,
+		double footnoteFontSize,
+		double footnoteFontScale,
+		MD::Item< MD::QStringTrait > * nextItem,
+		int footnoteNum, double offset,
+		bool firstInParagraph,
+		CustomWidth * cw,
+		const QColor & background,
+		bool strikeout,
+		long long int startLine,
+		long long int startPos,
+		long long int endLine,
+		long long int endPos );
 	//! Draw link.
 	QVector< QPair< QRectF, unsigned int > > drawLink( PdfAuxData & pdfData,
 		const RenderOpts & renderOpts,
@@ -691,63 +1016,140 @@ private:
 	friend bool operator == ( const PdfRenderer::FontAttribs & f1,
 		const PdfRenderer::FontAttribs & f2 );
 
-	//! Item in the table's cell.
-	struct CellItem {
-		QString word;
-		QByteArray image;
-		QString url;
-		QString footnote;
-		QString footnoteRef;
-		QColor color;
-		QColor background;
-		std::shared_ptr< MD::Footnote< MD::QStringTrait > > footnoteObj;
-		FontAttribs font;
-
+	//! Widths of characters of the font, taken from the font once, before measuring of
+	//! cells in parallel. It's read-only while cells are measured.
+	struct GlyphWidths {
+		//! Index of the font in the table.
+		quint16 font = 0;
+		double size = 0.0;
+		double scale = 1.0;
+		Font * pdfFont = nullptr;
+		//! Widths of ASCII characters.
+		std::array< double, 128 > ascii = {};
+		//! Widths of other characters.
+		QHash< char32_t, double > other;
+
+		//! Add widths of characters of the string that are not known yet.
+		void add( QStringView s, const PdfAuxData & pdfData );
+		//! \return Width of the string, all characters should be added.
+		double width( QStringView s ) const;
+
+		//! \return Widths of the font with the given size.
+		static const GlyphWidths & find( const QVector< GlyphWidths > & glyphs,
+			quint16 font, double size );
+	}; // struct GlyphWidths
+
+	//! Auxiliary table for drawing. Cells are stored row by row in flat arrays,
+	//! strings of items are spans in one text buffer, fonts and colors are shared.
+	struct AuxTable {
+		//! Span of the string in the text buffer.
+		struct Span {
+			qint32 pos = 0;
+			qint32 length = 0;
+
+			bool isEmpty() const { return length == 0; }
+		}; // struct Span
+
+		//! Item in the table's cell.
+		struct Item {
+			Span word;
+			Span url;
+			Span footnote;
+			//! Width of the item, it's calculated once in measureAuxTable().
+			double width = 0.0;
+			//! Index of the image, -1 if the item is not an image.
+			qint32 image = -1;
+			//! Index of the footnote, -1 if there is no footnote.
+			qint32 footnoteRef = -1;
+			//! Index of the font.
+			quint16 font = 0;
+			//! Indexes of colors, 0 is the invalid color.
+			quint16 color = 0;
+			quint16 background = 0;
+
+			bool isImage() const { return image >= 0; }
+		}; // struct Item
+
+		int columnsCount = 0;
+		int rowsCount = 0;
+		//! Alignments of columns.
+		QVector< MD::Table< MD::QStringTrait >::Alignment > alignments;
+		//! Widths of columns.
+		QVector< double > widths;
+		//! Heights of cells, row by row.
+		QVector< double > heights;
+		//! Indexes of first items of cells, row by row, the last one is the count of items.
+		QVector< qint32 > cells;
+		QVector< Item > items;
+		//! Text of items.
+		QString text;
+		QVector< FontAttribs > fonts;
+		//! Widths of space in fonts.
+		QVector< double > spaceWidths;
+		QVector< QColor > colors = { QColor() };
+		QVector< QByteArray > images;
+		//! Sizes of images in points.
+		QVector< QSizeF > imagesSizes;
+		QVector< QPair< QString, std::shared_ptr< MD::Footnote< MD::QStringTrait > > > > footnotes;
+
+		//! \return Index of the cell.
+		int cell( int row, int column ) const { return row * columnsCount + column; }
+		//! \return String of the span.
+		QString string( const Span & s ) const { return text.mid( s.pos, s.length ); }
+		//! \return View of the string of the span.
+		QStringView view( const Span & s ) const { return QStringView( text ).mid( s.pos, s.length ); }
+		//! Add string to the text.
+		Span addString( const QString & s );
+		//! \return Index of the font.
+		quint16 addFont( const FontAttribs & font );
+		//! \return Index of the color.
+		quint16 addColor( const QColor & color );
 		//! \return Width of the item.
-		double width( PdfAuxData & pdfData, PdfRenderer * render, double scale ) const;
-	}; // struct CellItem
+		double itemWidth( const Item & item, PdfAuxData & pdfData, PdfRenderer * render,
+			double scale ) const;
+		//! \return Width of the item from widths of characters, it's thread-safe.
+		double itemWidth( const Item & item, const QVector< GlyphWidths > & glyphs ) const;
+		//! Calculate height of the cell for the width of the column.
+		void heightToWidth( int cell, double lineHeight, double spaceWidth, double scale );
+		//! \return Height of the row.
+		double rowHeight( int row ) const;
+		//! \return Estimated size of the table in bytes.
+		qint64 memoryUsage() const;
+	}; // struct AuxTable
 
-	//! Cell in the table.
-	struct CellData {
-		double width = 0.0;
-		double height = 0.0;
-		MD::Table< MD::QStringTrait >::Alignment alignment;
-		QVector< CellItem > items;
-
-		void setWidth( double w ) { width = w; }
-		//! Calculate height for the given width.
-		void heightToWidth( double lineHeight, double spaceWidth, double scale,
-			PdfAuxData & pdfData, PdfRenderer * render );
-	}; //  struct CellData
-
-	//! \return Height of the row.
-	double rowHeight( const QVector< QVector< CellData > > & table, int row );
 	//! Create auxiliary cell.
 	void
 	createAuxCell( const RenderOpts & renderOpts,
 		PdfAuxData & pdfData,
-		CellData & data,
+		AuxTable & table,
 		MD::Item< MD::QStringTrait > * item,
 		std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
 		const QString & url = {},
 		const QColor & color = {} );
-	//! Create auxiliary table for drawing.
-	QVector< QVector< CellData > >
+	//! Create auxiliary table for drawing of \p rowsCount rows starting from \p firstRow,
+	//! all rows if \p rowsCount is negative.
+	AuxTable
 	createAuxTable( PdfAuxData & pdfData,
 		const RenderOpts & renderOpts,
 		MD::Table< MD::QStringTrait > * item,
 		std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
+		double scale,
+		int firstRow = 0,
+		int rowsCount = -1 );
+	//! Measure fonts, images and items of the table.
+	void measureAuxTable( PdfAuxData & pdfData,
+		AuxTable & table,
 		double scale );
 	//! Calculate size of the cells in the table.
 	void calculateCellsSize( PdfAuxData & pdfData,
-		QVector< QVector< CellData > > & auxTable,
+		AuxTable & auxTable,
 		double spaceWidth,
 		double offset,
 		double lineHeight,
 		double scale );
 	//! Draw table's row.
 	QPair< QVector< WhereDrawn >, WhereDrawn > drawTableRow(
-		QVector< QVector< CellData > > & table,
+		AuxTable & table,
 		int row,
 		PdfAuxData & pdfData,
 		double offset,
@@ -761,7 +1163,7 @@ private:
 		int startPage, QVector< WhereDrawn > & ret,
 		const RenderOpts & renderOpts,
 		double offset,
-		const QVector< QVector< CellData > > & table,
+		const AuxTable & table,
 		double startY,
 		double endY );
 
@@ -771,13 +1173,14 @@ private:
 		double availableWidth = 0.0;
 		double lineHeight = 0.0;
 		MD::Table< MD::QStringTrait >::Alignment alignment;
-		QVector< CellItem > text;
+		QVector< AuxTable::Item > text;
 
 		void clear() { width = 0.0; text.clear(); }
 	}; // struct TextToDraw
 
 	//! Draw text line in the cell.
 	void drawTextLineInTable( const RenderOpts & renderOpts,
+		const AuxTable & table,
 		double x,
 		double & y,
 		TextToDraw & text,
@@ -807,10 +1210,24 @@ private:
 	void handleException( PdfAuxData & pdfData, const QString & msg );
 
 private:
+	//! Footnote to draw.
+	struct PendingFootnote {
+		//! ID of the footnote.
+		QString id;
+		//! Footnote.
+		std::shared_ptr< MD::Footnote< MD::QStringTrait > > footnote;
+		//! File where the footnote is referenced first.
+		QString file;
+	}; // struct PendingFootnote
+
 	//! Name of the output file.
 	QString m_fileName;
 	//! Markdown document.
 	std::shared_ptr< MD::Document< MD::QStringTrait > > m_doc;
+	//! Markdown file to parse if there is no document.
+	QString m_markdownFileName;
+	//! Parse all linked Markdown files.
+	bool m_recursive;
 	//! Render options.
 	RenderOpts m_opts;
 	//! Mutex.
@@ -825,16 +1242,45 @@ private:
 	QMultiMap< QString, QPair< QRectF, unsigned int > > m_unresolvedFootnotesLinks;
 	//! Cache of images.
 	QMap< QString, QByteArray > m_imageCache;
+	//! Mutex for cache of images, that is filled in background.
+	QMutex m_imageCacheMutex;
+	//! Bytes of images in the cache.
+	qint64 m_imageCacheBytes = 0;
+	//! Threads for loading images in background.
+	QThreadPool m_imagesPool;
+	//! Images loading in background by URL.
+	QHash< QString, std::shared_future< void > > m_imagesLoading;
 	//! Footnote counter.
 	int m_footnoteNum;
 	//! Footnotes to draw.
-	QVector< QPair< QString, std::shared_ptr< MD::Footnote< MD::QStringTrait > > > > m_footnotes;
+	QVector< PendingFootnote > m_footnotes;
+	//! IDs of footnotes to draw.
+	QSet< QString > m_footnotesIds;
+	//! Timings and counters of the render.
+	RenderReport m_report;
+	//! Timeline of the render.
+	Timeline m_timeline;
 #ifdef MD_PDF_TESTING
 	bool m_isError;
 #endif
 }; // class Renderer
 
 
+namespace Magick {
+
+class Image;
+
+} /* namespace Magick */
+
+//
+// convert
+//
+
+//! Convert image from ImageMagick to Qt.
+QImage
+convert( const Magick::Image & img );
+
+
 //
 // LoadImageFromNetwork
 //
@@ -0,0 +1,277 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// md-pdf include.
+#include "report.hpp"
+
+// Qt include.
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QFile>
+#include <QStringList>
+
+// C++ include.
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+
+namespace /* anonymous */ {
+
+//! Names of phases in JSON.
+static const char * c_phases[] = {
+	"parse",
+	"anchors",
+	"heading",
+	"paragraph",
+	"code",
+	"blockquote",
+	"list",
+	"table",
+	"images",
+	"highlighting",
+	"math",
+	"footnotes",
+	"resolveLinks",
+	"finishPages",
+	"save"
+};
+
+static_assert( sizeof( c_phases ) / sizeof( c_phases[ 0 ] ) ==
+	static_cast< size_t > ( RenderReport::Phase::Count ), "Names of phases are out of sync." );
+
+//! Names of counters in JSON.
+static const char * c_counters[] = {
+	"stringWidth",
+	"createFont",
+	"objects",
+	"pages",
+	"images",
+	"bytesWritten"
+};
+
+static_assert( sizeof( c_counters ) / sizeof( c_counters[ 0 ] ) ==
+	static_cast< size_t > ( RenderReport::Counter::Count ), "Names of counters are out of sync." );
+
+//! Names of categories of memory in JSON.
+static const char * c_memory[] = {
+	"imageCache",
+	"customWidth",
+	"auxTables",
+	"painters",
+	"pdfObjects",
+	"document"
+};
+
+static_assert( sizeof( c_memory ) / sizeof( c_memory[ 0 ] ) ==
+	static_cast< size_t > ( RenderReport::Memory::Count ), "Names of memory are out of sync." );
+
+//! Count of the most expensive blocks in the report.
+static const size_t c_topBlocksCount = 20;
+
+//! \return Milliseconds from nanoseconds.
+inline double
+ms( qint64 ns )
+{
+	return static_cast< double > ( ns ) / 1000000.0;
+}
+
+} /* namespace anonymous */
+
+
+//
+// RenderReport
+//
+
+QJsonObject
+RenderReport::toJson() const
+{
+	QJsonObject phases;
+
+	for( int i = 0; i < static_cast< int > ( Phase::Count ); ++i )
+	{
+		const auto & t = m_times[ i ];
+
+		if( t.calls )
+			phases.insert( QLatin1String( c_phases[ i ] ), QJsonObject{
+				{ QStringLiteral( "wallMs" ), ms( t.wall ) },
+				{ QStringLiteral( "cpuMs" ), ms( t.cpu ) },
+				{ QStringLiteral( "calls" ), t.calls } } );
+	}
+
+	QJsonObject counters;
+
+	for( int i = 0; i < static_cast< int > ( Counter::Count ); ++i )
+		counters.insert( QLatin1String( c_counters[ i ] ), m_counters[ i ] );
+
+	QJsonArray blocks;
+
+	for( const auto & b : topBlocks( c_topBlocksCount ) )
+		blocks.append( QJsonObject{ { QStringLiteral( "type" ), QLatin1String( b.type ) },
+			{ QStringLiteral( "file" ), b.file },
+			{ QStringLiteral( "startLine" ), b.startLine },
+			{ QStringLiteral( "endLine" ), b.endLine },
+			{ QStringLiteral( "wallMs" ), ms( b.wall ) },
+			{ QStringLiteral( "measures" ), b.measures },
+			{ QStringLiteral( "bytes" ), b.bytes } } );
+
+	QJsonObject categories;
+
+	for( int i = 0; i < static_cast< int > ( Memory::Count ); ++i )
+		categories.insert( QLatin1String( c_memory[ i ] ), QJsonObject{
+			{ QStringLiteral( "bytes" ), m_memory[ i ] },
+			{ QStringLiteral( "peakBytes" ), m_peakMemory[ i ] } } );
+
+	QJsonObject phasesMemory;
+
+	for( int i = 0; i < static_cast< int > ( Phase::Count ); ++i )
+	{
+		if( m_times[ i ].calls )
+			phasesMemory.insert( QLatin1String( c_phases[ i ] ), QJsonObject{
+				{ QStringLiteral( "trackedBytes" ), m_phaseMemory[ i ].tracked },
+				{ QStringLiteral( "rssBytes" ), m_phaseMemory[ i ].rss } } );
+	}
+
+	const QJsonObject memory = { { QStringLiteral( "peakRssBytes" ), m_peakRss },
+		{ QStringLiteral( "peakTrackedBytes" ), m_peakTrackedMemory },
+		{ QStringLiteral( "categories" ), categories },
+		{ QStringLiteral( "phases" ), phasesMemory } };
+
+	return { { QStringLiteral( "totalMs" ), ms( m_total ) },
+		{ QStringLiteral( "phases" ), phases },
+		{ QStringLiteral( "counters" ), counters },
+		{ QStringLiteral( "memory" ), memory },
+		{ QStringLiteral( "topBlocks" ), blocks } };
+}
+
+QString
+RenderReport::memoryBreakdown() const
+{
+	std::array< int, static_cast< int > ( Memory::Count ) > order;
+
+	for( int i = 0; i < static_cast< int > ( Memory::Count ); ++i )
+		order[ i ] = i;
+
+	std::sort( order.begin(), order.end(),
+		[this] ( int i1, int i2 ) { return m_memory[ i1 ] > m_memory[ i2 ]; } );
+
+	QStringList parts;
+
+	for( const auto i : order )
+		parts.append( QStringLiteral( "%1 %2 MB" ).arg( QLatin1String( c_memory[ i ] ) )
+			.arg( static_cast< double > ( m_memory[ i ] ) / ( 1024.0 * 1024.0 ), 0, 'f', 1 ) );
+
+	return parts.join( QStringLiteral( ", " ) );
+}
+
+std::vector< RenderReport::BlockCost >
+RenderReport::topBlocks( size_t count ) const
+{
+	std::vector< BlockCost > top = m_blocks;
+
+	count = std::min( count, top.size() );
+
+	std::partial_sort( top.begin(), top.begin() + count, top.end(),
+		[] ( const BlockCost & b1, const BlockCost & b2 ) { return b1.wall > b2.wall; } );
+
+	top.resize( count );
+
+	return top;
+}
+
+qint64
+RenderReport::threadCpuTime()
+{
+#ifdef Q_OS_WIN
+	FILETIME creation, exit, kernel, user;
+
+	if( GetThreadTimes( GetCurrentThread(), &creation, &exit, &kernel, &user ) )
+	{
+		const auto toNs = [] ( const FILETIME & t )
+		{
+			return ( ( static_cast< qint64 > ( t.dwHighDateTime ) << 32 ) |
+				static_cast< qint64 > ( t.dwLowDateTime ) ) * 100;
+		};
+
+		return toNs( kernel ) + toNs( user );
+	}
+
+	return 0;
+#else
+	struct timespec ts;
+
+	if( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) == 0 )
+		return static_cast< qint64 > ( ts.tv_sec ) * 1000000000 + ts.tv_nsec;
+
+	return 0;
+#endif
+}
+
+
+//
+// Timeline
+//
+
+void
+Timeline::add( const char * name, const char * category, qint64 start, qint64 duration,
+	const QJsonObject & args )
+{
+	m_events.push_back( { name, category, start, duration, args } );
+}
+
+bool
+Timeline::save( const QString & fileName ) const
+{
+	QJsonArray events;
+
+	for( const auto & e : m_events )
+	{
+		// Times of trace events are in microseconds.
+		QJsonObject event = { { QStringLiteral( "name" ), QLatin1String( e.name ) },
+			{ QStringLiteral( "cat" ), QLatin1String( e.category ) },
+			{ QStringLiteral( "ph" ), QStringLiteral( "X" ) },
+			{ QStringLiteral( "ts" ), static_cast< double > ( e.start ) / 1000.0 },
+			{ QStringLiteral( "dur" ), static_cast< double > ( e.duration ) / 1000.0 },
+			{ QStringLiteral( "pid" ), 1 },
+			{ QStringLiteral( "tid" ), 1 } };
+
+		if( !e.args.isEmpty() )
+			event.insert( QStringLiteral( "args" ), e.args );
+
+		events.append( event );
+	}
+
+	QFile file( fileName );
+
+	if( !file.open( QIODevice::WriteOnly ) )
+		return false;
+
+	file.write( QJsonDocument( QJsonObject{ { QStringLiteral( "traceEvents" ), events },
+		{ QStringLiteral( "displayTimeUnit" ), QStringLiteral( "ms" ) } } )
+			.toJson( QJsonDocument::Compact ) );
+
+	return ( file.error() == QFileDevice::NoError );
+}
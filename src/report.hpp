@@ -0,0 +1,414 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MD_PDF_REPORT_HPP_INCLUDED
+#define MD_PDF_REPORT_HPP_INCLUDED
+
+// Qt include.
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+
+// C++ include.
+#include <algorithm>
+#include <array>
+#include <vector>
+
+
+//
+// RenderReport
+//
+
+//! Timings and counters of the render.
+/*!
+	Phases of layout of blocks include nested phases, like loading of images,
+	highlighting and math, that are reported separately too.
+
+	Costs are attributed to top-level blocks and footnotes by their source lines,
+	the report lists 20 most expensive of them.
+
+	Memory is tracked by categories. Long-living data, like the image cache, is
+	tracked by its current size, transient buffers, like auxiliary tables, by the size
+	of the last one. Peaks of categories, the peak of the sum and resident memory
+	at the end of phases are reported too.
+*/
+class RenderReport final {
+public:
+	//! Phase of the render.
+	enum class Phase {
+		Parse = 0,
+		Anchors,
+		Heading,
+		Paragraph,
+		Code,
+		Blockquote,
+		List,
+		Table,
+		Images,
+		Highlighting,
+		Math,
+		Footnotes,
+		ResolveLinks,
+		FinishPages,
+		Save,
+		//! Count of phases.
+		Count
+	}; // enum class Phase
+
+	//! Counter.
+	enum class Counter {
+		StringWidth = 0,
+		CreateFont,
+		Objects,
+		Pages,
+		Images,
+		BytesWritten,
+		//! Count of counters.
+		Count
+	}; // enum class Counter
+
+	//! Category of tracked memory.
+	enum class Memory {
+		//! Loaded images.
+		ImageCache = 0,
+		//! Widths of items on lines of paragraphs.
+		CustomWidth,
+		//! Auxiliary tables of cells.
+		AuxTables,
+		//! Content of not finished pages.
+		Painters,
+		//! Objects of PDF.
+		PdfObjects,
+		//! Parsed Markdown.
+		Document,
+		//! Count of categories.
+		Count
+	}; // enum class Memory
+
+	//! Time of the phase in nanoseconds.
+	struct Time {
+		qint64 wall = 0;
+		qint64 cpu = 0;
+		qint64 calls = 0;
+	}; // struct Time
+
+	//! Cost of the top-level block of Markdown.
+	struct BlockCost {
+		//! Type of the block.
+		const char * type = nullptr;
+		//! File of the block.
+		QString file;
+		//! Lines of the block, starting from 1.
+		long long startLine = 0;
+		long long endLine = 0;
+		//! Wall time in nanoseconds.
+		qint64 wall = 0;
+		//! Count of measuring passes of layout.
+		qint64 measures = 0;
+		//! Bytes of text and images emitted.
+		qint64 bytes = 0;
+	}; // struct BlockCost
+
+	RenderReport() = default;
+
+	//! Add time to the phase.
+	void add( Phase p, qint64 wall, qint64 cpu )
+	{
+		auto & t = m_times[ static_cast< int > ( p ) ];
+		t.wall += wall;
+		t.cpu += cpu;
+		++t.calls;
+	}
+
+	//! Increment counter.
+	void count( Counter c, qint64 n = 1 )
+	{
+		m_counters[ static_cast< int > ( c ) ] += n;
+	}
+
+	//! Set counter.
+	void set( Counter c, qint64 v )
+	{
+		m_counters[ static_cast< int > ( c ) ] = v;
+	}
+
+	//! \return Time of the phase.
+	const Time & time( Phase p ) const
+	{
+		return m_times[ static_cast< int > ( p ) ];
+	}
+
+	//! \return Counter.
+	qint64 counter( Counter c ) const
+	{
+		return m_counters[ static_cast< int > ( c ) ];
+	}
+
+	//! Start attribution of costs to the block.
+	void beginBlock( const char * type, const QString & file, long long startLine,
+		long long endLine )
+	{
+		m_blocks.push_back( { type, file, startLine, endLine } );
+		m_blockTimer.start();
+	}
+
+	//! Finish attribution of costs to the current block.
+	void endBlock()
+	{
+		if( !m_blocks.empty() && m_blockTimer.isValid() )
+		{
+			m_blocks.back().wall = m_blockTimer.nsecsElapsed();
+			m_blockTimer.invalidate();
+		}
+	}
+
+	//! Count measuring pass of layout in the current block.
+	void countMeasure()
+	{
+		if( m_blockTimer.isValid() )
+			++m_blocks.back().measures;
+	}
+
+	//! Count bytes emitted in the current block.
+	void countBytes( qint64 n )
+	{
+		if( m_blockTimer.isValid() )
+			m_blocks.back().bytes += n;
+	}
+
+	//! Add bytes to the category of memory, \p bytes can be negative.
+	void addMemory( Memory m, qint64 bytes )
+	{
+		setMemory( m, m_memory[ static_cast< int > ( m ) ] + bytes );
+	}
+
+	//! Set bytes of the category of memory.
+	void setMemory( Memory m, qint64 bytes )
+	{
+		const auto i = static_cast< int > ( m );
+
+		m_trackedMemory += bytes - m_memory[ i ];
+		m_memory[ i ] = bytes;
+		m_peakMemory[ i ] = std::max( m_peakMemory[ i ], bytes );
+		m_peakTrackedMemory = std::max( m_peakTrackedMemory, m_trackedMemory );
+	}
+
+	//! \return Bytes of the category of memory.
+	qint64 memory( Memory m ) const
+	{
+		return m_memory[ static_cast< int > ( m ) ];
+	}
+
+	//! \return Peak bytes of the category of memory.
+	qint64 peakMemory( Memory m ) const
+	{
+		return m_peakMemory[ static_cast< int > ( m ) ];
+	}
+
+	//! \return Sum of all categories of memory.
+	qint64 trackedMemory() const
+	{
+		return m_trackedMemory;
+	}
+
+	//! Sample tracked memory and resident memory, if known, at the end of the phase.
+	void sampleMemory( Phase p, qint64 rss = 0 )
+	{
+		auto & s = m_phaseMemory[ static_cast< int > ( p ) ];
+		s.tracked = std::max( s.tracked, m_trackedMemory );
+		s.rss = std::max( s.rss, rss );
+	}
+
+	//! Set peak resident memory of the process.
+	void setPeakRss( qint64 bytes )
+	{
+		m_peakRss = bytes;
+	}
+
+	//! \return Description of categories of memory, the largest first.
+	QString memoryBreakdown() const;
+
+	//! \return The most expensive blocks by time, the most expensive first.
+	std::vector< BlockCost > topBlocks( size_t count ) const;
+
+	//! Set total wall time of the render in nanoseconds.
+	void setTotal( qint64 wall )
+	{
+		m_total = wall;
+	}
+
+	//! \return Report as JSON, times are in milliseconds.
+	QJsonObject toJson() const;
+
+	//! \return CPU time of the current thread in nanoseconds.
+	static qint64 threadCpuTime();
+
+private:
+	std::array< Time, static_cast< int > ( Phase::Count ) > m_times = {};
+	std::array< qint64, static_cast< int > ( Counter::Count ) > m_counters = {};
+	qint64 m_total = 0;
+	//! Costs of blocks in order of drawing.
+	std::vector< BlockCost > m_blocks;
+	//! Timer of the current block, invalid between blocks.
+	QElapsedTimer m_blockTimer;
+
+	//! Memory at the end of the phase.
+	struct MemorySample {
+		qint64 tracked = 0;
+		qint64 rss = 0;
+	}; // struct MemorySample
+
+	std::array< qint64, static_cast< int > ( Memory::Count ) > m_memory = {};
+	std::array< qint64, static_cast< int > ( Memory::Count ) > m_peakMemory = {};
+	std::array< MemorySample, static_cast< int > ( Phase::Count ) > m_phaseMemory = {};
+	qint64 m_trackedMemory = 0;
+	qint64 m_peakTrackedMemory = 0;
+	qint64 m_peakRss = 0;
+}; // class RenderReport
+
+
+//
+// PhaseTimer
+//
+
+//! Adds wall and CPU time of the scope to the phase of the report, samples tracked memory.
+class PhaseTimer final {
+public:
+	PhaseTimer( RenderReport & report, RenderReport::Phase phase )
+		:	m_report( report )
+		,	m_phase( phase )
+		,	m_cpu( RenderReport::threadCpuTime() )
+	{
+		m_timer.start();
+	}
+
+	~PhaseTimer()
+	{
+		m_report.add( m_phase, m_timer.nsecsElapsed(), RenderReport::threadCpuTime() - m_cpu );
+		m_report.sampleMemory( m_phase );
+	}
+
+private:
+	RenderReport & m_report;
+	RenderReport::Phase m_phase;
+	QElapsedTimer m_timer;
+	qint64 m_cpu;
+
+	Q_DISABLE_COPY( PhaseTimer )
+}; // class PhaseTimer
+
+
+//
+// Timeline
+//
+
+//! Timeline of the render in Chrome trace event format, disabled by default.
+class Timeline final {
+public:
+	Timeline() = default;
+
+	//! Enable timeline, start of spans is counted from this moment.
+	void enable()
+	{
+		m_enabled = true;
+		m_origin.start();
+	}
+
+	//! \return Is timeline enabled?
+	bool isEnabled() const
+	{
+		return m_enabled;
+	}
+
+	//! \return Nanoseconds since enabling.
+	qint64 now() const
+	{
+		return m_origin.nsecsElapsed();
+	}
+
+	//! Add complete event.
+	void add( const char * name, const char * category, qint64 start, qint64 duration,
+		const QJsonObject & args );
+
+	//! Save timeline to the file. \return false on error.
+	bool save( const QString & fileName ) const;
+
+private:
+	//! Complete event.
+	struct Event {
+		const char * name;
+		const char * category;
+		qint64 start;
+		qint64 duration;
+		QJsonObject args;
+	}; // struct Event
+
+	bool m_enabled = false;
+	QElapsedTimer m_origin;
+	std::vector< Event > m_events;
+}; // class Timeline
+
+
+//
+// TimelineSpan
+//
+
+//! Adds event of the scope to the timeline if timeline is enabled.
+class TimelineSpan final {
+public:
+	TimelineSpan( Timeline & timeline, const char * name, const char * category )
+		:	m_timeline( timeline.isEnabled() ? &timeline : nullptr )
+		,	m_name( name )
+		,	m_category( category )
+		,	m_start( m_timeline ? m_timeline->now() : 0 )
+	{
+	}
+
+	~TimelineSpan()
+	{
+		if( m_timeline )
+			m_timeline->add( m_name, m_category, m_start, m_timeline->now() - m_start, m_args );
+	}
+
+	//! \return Is span recorded? Arguments should be set only in this case.
+	explicit operator bool () const
+	{
+		return ( m_timeline != nullptr );
+	}
+
+	//! Set argument of the event.
+	void setArg( const QString & key, const QJsonValue & value )
+	{
+		m_args.insert( key, value );
+	}
+
+private:
+	Timeline * m_timeline;
+	const char * m_name;
+	const char * m_category;
+	qint64 m_start;
+	QJsonObject m_args;
+
+	Q_DISABLE_COPY( TimelineSpan )
+}; // class TimelineSpan
+
+#endif // MD_PDF_REPORT_HPP_INCLUDED
@@ -0,0 +1,445 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// md-pdf include.
+#include "server.hpp"
+
+// Qt include.
+#include <QJsonDocument>
+#include <QFont>
+#include <QDir>
+
+
+namespace /* anonymous */ {
+
+//! Send error event to the client, ID is omitted if empty.
+void
+sendError( QLocalSocket * socket, const QString & id, const QString & msg )
+{
+	QJsonObject e = { { QStringLiteral( "event" ), QStringLiteral( "error" ) },
+		{ QStringLiteral( "message" ), msg } };
+
+	if( !id.isEmpty() )
+		e.insert( QStringLiteral( "id" ), id );
+
+	socket->write( QJsonDocument( e ).toJson( QJsonDocument::Compact ) );
+	socket->write( "\n" );
+}
+
+} /* namespace anonymous */
+
+
+//
+// RenderJob
+//
+
+RenderJob::RenderJob( const QString & id, QLocalSocket * socket, QObject * parent )
+	:	QObject( parent )
+	,	m_id( id )
+	,	m_socket( socket )
+{
+}
+
+const QString &
+RenderJob::id() const
+{
+	return m_id;
+}
+
+PdfRenderer *
+RenderJob::renderer() const
+{
+	return m_renderer;
+}
+
+QLocalSocket *
+RenderJob::socket() const
+{
+	return m_socket;
+}
+
+void
+RenderJob::setRenderer( PdfRenderer * r )
+{
+	m_renderer = r;
+
+	connect( r, &PdfRenderer::progress, this, &RenderJob::progress );
+	connect( r, &PdfRenderer::error, this, &RenderJob::error );
+	connect( r, &PdfRenderer::done, this, &RenderJob::done );
+	connect( r, &PdfRenderer::status, this, &RenderJob::status );
+	connect( r, &PdfRenderer::report, this, &RenderJob::report );
+}
+
+void
+RenderJob::setMarkdownFile( QTemporaryFile * file )
+{
+	file->setParent( this );
+}
+
+void
+RenderJob::send( const QJsonObject & event )
+{
+	if( m_socket )
+	{
+		QJsonObject e = event;
+		e.insert( QStringLiteral( "id" ), m_id );
+
+		m_socket->write( QJsonDocument( e ).toJson( QJsonDocument::Compact ) );
+		m_socket->write( "\n" );
+	}
+}
+
+void
+RenderJob::progress( int percent )
+{
+	send( { { QStringLiteral( "event" ), QStringLiteral( "progress" ) },
+		{ QStringLiteral( "value" ), percent } } );
+}
+
+void
+RenderJob::error( const QString & msg )
+{
+	send( { { QStringLiteral( "event" ), QStringLiteral( "error" ) },
+		{ QStringLiteral( "message" ), msg } } );
+}
+
+void
+RenderJob::done( bool terminated )
+{
+	send( { { QStringLiteral( "event" ), QStringLiteral( "done" ) },
+		{ QStringLiteral( "terminated" ), terminated } } );
+}
+
+void
+RenderJob::status( const QString & msg )
+{
+	send( { { QStringLiteral( "event" ), QStringLiteral( "status" ) },
+		{ QStringLiteral( "message" ), msg } } );
+}
+
+void
+RenderJob::report( const QJsonObject & r )
+{
+	send( { { QStringLiteral( "event" ), QStringLiteral( "report" ) },
+		{ QStringLiteral( "report" ), r } } );
+}
+
+
+//
+// RenderServer
+//
+
+RenderServer::RenderServer( QObject * parent )
+	:	QObject( parent )
+	,	m_imagesCache( new ImagesCache )
+	,	m_memoryBudget( 0 )
+	,	m_compressionThreads( 0 )
+{
+	m_pool.setMaxThreadCount( qMax( 1, QThread::idealThreadCount() ) );
+
+	connect( &m_server, &QLocalServer::newConnection, this, &RenderServer::newConnection );
+}
+
+RenderServer::~RenderServer()
+{
+	for( const auto & j : std::as_const( m_jobs ) )
+	{
+		if( j && j->renderer() )
+			j->renderer()->terminate();
+	}
+
+	m_pool.waitForDone();
+}
+
+bool
+RenderServer::listen( const QString & name )
+{
+	// Socket may be left from the crashed server.
+	QLocalServer::removeServer( name );
+
+	return m_server.listen( name );
+}
+
+QString
+RenderServer::errorString() const
+{
+	return ( m_reportFile.error() != QFileDevice::NoError ? m_reportFile.errorString() :
+		m_server.errorString() );
+}
+
+bool
+RenderServer::setReportFile( const QString & fileName )
+{
+	m_reportFile.setFileName( fileName );
+
+	return m_reportFile.open( QIODevice::WriteOnly | QIODevice::Append );
+}
+
+void
+RenderServer::setMemoryBudget( qint64 bytes )
+{
+	m_memoryBudget = bytes;
+}
+
+void
+RenderServer::setCompressionThreads( int count )
+{
+	m_compressionThreads = qMax( 0, count );
+}
+
+void
+RenderServer::writeReport( const QJsonObject & r )
+{
+	m_reportFile.write( QJsonDocument( r ).toJson( QJsonDocument::Compact ) );
+	m_reportFile.write( "\n" );
+	m_reportFile.flush();
+}
+
+void
+RenderServer::newConnection()
+{
+	while( m_server.hasPendingConnections() )
+	{
+		auto * socket = m_server.nextPendingConnection();
+
+		connect( socket, &QLocalSocket::readyRead, this, &RenderServer::readyRead );
+		connect( socket, &QLocalSocket::disconnected, this, &RenderServer::disconnected );
+		connect( socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater );
+	}
+}
+
+void
+RenderServer::disconnected()
+{
+	auto * socket = qobject_cast< QLocalSocket* > ( sender() );
+
+	// Nobody waits for results of jobs of the gone client.
+	for( const auto & j : std::as_const( m_jobs ) )
+	{
+		if( j && j->socket() == socket && j->renderer() )
+			j->renderer()->terminate();
+	}
+}
+
+void
+RenderServer::readyRead()
+{
+	auto * socket = qobject_cast< QLocalSocket* > ( sender() );
+
+	if( !socket )
+		return;
+
+	while( socket->canReadLine() )
+	{
+		const auto line = socket->readLine().trimmed();
+
+		if( line.isEmpty() )
+			continue;
+
+		QJsonParseError err;
+		const auto json = QJsonDocument::fromJson( line, &err );
+
+		if( err.error != QJsonParseError::NoError || !json.isObject() )
+		{
+			sendError( socket, {}, tr( "Wrong job: %1." ).arg( err.errorString() ) );
+
+			continue;
+		}
+
+		const auto job = json.object();
+
+		if( job.value( QStringLiteral( "cancel" ) ).toBool() )
+			cancelJob( job.value( QStringLiteral( "id" ) ).toString() );
+		else
+			startJob( job, socket );
+	}
+}
+
+void
+RenderServer::startJob( const QJsonObject & job, QLocalSocket * socket )
+{
+	const auto id = job.value( QStringLiteral( "id" ) ).toString();
+	const auto output = job.value( QStringLiteral( "output" ) ).toString();
+	auto input = job.value( QStringLiteral( "input" ) ).toString();
+
+	// Events of the job are addressed by ID, so it should be unique.
+	if( id.isEmpty() )
+	{
+		sendError( socket, id, tr( "Job should have ID." ) );
+
+		return;
+	}
+
+	if( m_jobs.value( id ) )
+	{
+		sendError( socket, id, tr( "Job with ID \"%1\" is already running." ).arg( id ) );
+
+		return;
+	}
+
+	if( output.isEmpty() || ( input.isEmpty() && !job.contains( QStringLiteral( "markdown" ) ) ) )
+	{
+		sendError( socket, id, tr( "Job should have input Markdown and output PDF file name." ) );
+
+		return;
+	}
+
+	const auto opts = job.value( QStringLiteral( "opts" ) ).toObject();
+
+	// Without level streams stay as PoDoFo compressed them, threads would do nothing.
+	if( opts.contains( QStringLiteral( "compressionThreads" ) ) &&
+		!opts.contains( QStringLiteral( "compressionLevel" ) ) )
+	{
+		sendError( socket, id, tr( "Option \"compressionThreads\" requires \"compressionLevel\"." ) );
+
+		return;
+	}
+
+	auto * j = new RenderJob( id, socket, this );
+
+	if( job.contains( QStringLiteral( "markdown" ) ) )
+	{
+		auto * file = new QTemporaryFile( QDir::tempPath() +
+			QStringLiteral( "/md-pdf-XXXXXX.md" ) );
+
+		if( file->open() )
+		{
+			file->write( job.value( QStringLiteral( "markdown" ) ).toString().toUtf8() );
+			file->close();
+
+			input = file->fileName();
+		}
+
+		j->setMarkdownFile( file );
+	}
+
+	if( input.isEmpty() )
+	{
+		j->error( tr( "Unable to write Markdown to temporary file." ) );
+		j->deleteLater();
+
+		return;
+	}
+
+	auto * pdf = new PdfRenderer();
+
+	j->setRenderer( pdf );
+
+	if( m_reportFile.isOpen() )
+		connect( pdf, &PdfRenderer::report, this, &RenderServer::writeReport );
+
+	// Renderer deletes himself on finish.
+	connect( pdf, &QObject::destroyed, j, &QObject::deleteLater );
+	connect( j, &QObject::destroyed, this, &RenderServer::jobDone );
+
+	m_jobs.insert( id, j );
+
+	const auto recursive = job.value( QStringLiteral( "recursive" ) ).toBool( true );
+
+	// Renderer belongs to the thread that renders, it's pulled there by the pool task.
+	pdf->moveToThread( nullptr );
+
+	// Jobs wait in the queue of the pool for a free thread.
+	m_pool.start( [pdf, output, input, recursive, mainThread = thread(),
+		o = renderOpts( opts )] ()
+		{
+			pdf->moveToThread( QThread::currentThread() );
+
+			pdf->renderFileNow( output, input, recursive, o );
+
+			// Pool threads have no event loop, so the renderer is deleted in the main one.
+			pdf->moveToThread( mainThread );
+		} );
+}
+
+void
+RenderServer::cancelJob( const QString & id )
+{
+	const auto it = m_jobs.constFind( id );
+
+	if( it != m_jobs.cend() && it.value() && it.value()->renderer() )
+		it.value()->renderer()->terminate();
+}
+
+void
+RenderServer::jobDone()
+{
+	for( auto it = m_jobs.begin(); it != m_jobs.end(); )
+	{
+		if( !it.value() )
+			it = m_jobs.erase( it );
+		else
+			++it;
+	}
+}
+
+RenderOpts
+RenderServer::renderOpts( const QJsonObject & opts )
+{
+	const QFont defaultFont;
+
+	RenderOpts o;
+
+	o.m_textFont = opts.value( QStringLiteral( "textFont" ) ).toString( defaultFont.family() );
+	o.m_textFontSize = opts.value( QStringLiteral( "textFontSize" ) ).toInt( 8 );
+	o.m_codeFont = opts.value( QStringLiteral( "codeFont" ) ).toString( defaultFont.family() );
+	o.m_codeFontSize = opts.value( QStringLiteral( "codeFontSize" ) ).toInt( 8 );
+	o.m_mathFont = opts.value( QStringLiteral( "mathFont" ) ).toString( defaultFont.family() );
+	o.m_mathFontSize = opts.value( QStringLiteral( "mathFontSize" ) ).toInt( 8 );
+	o.m_linkColor = QColor( opts.value( QStringLiteral( "linkColor" ) )
+		.toString( QStringLiteral( "#217aff" ) ) );
+	o.m_borderColor = QColor( opts.value( QStringLiteral( "borderColor" ) )
+		.toString( QStringLiteral( "#515151" ) ) );
+	o.m_left = opts.value( QStringLiteral( "left" ) ).toDouble( c_margin );
+	o.m_right = opts.value( QStringLiteral( "right" ) ).toDouble( c_margin );
+	o.m_top = opts.value( QStringLiteral( "top" ) ).toDouble( c_margin );
+	o.m_bottom = opts.value( QStringLiteral( "bottom" ) ).toDouble( c_margin );
+	o.m_dpi = static_cast< quint16 > ( opts.value( QStringLiteral( "dpi" ) ).toInt( 300 ) );
+	o.m_compressionLevel = opts.value( QStringLiteral( "compressionLevel" ) ).toInt( -1 );
+	o.m_compressionThreads = qMax( 0, opts.value( QStringLiteral( "compressionThreads" ) )
+		.toInt( m_compressionThreads ) );
+	o.m_useXRefStream = opts.value( QStringLiteral( "useXRefStream" ) ).toBool( false );
+	o.m_fullFontEmbedding = opts.value( QStringLiteral( "fullFontEmbedding" ) ).toBool( false );
+	o.m_useStandardFonts = opts.value( QStringLiteral( "useStandardFonts" ) ).toBool( false );
+	o.m_dryRun = opts.value( QStringLiteral( "dryRun" ) ).toBool( false );
+	o.m_traceFileName = opts.value( QStringLiteral( "trace" ) ).toString();
+	o.m_timelineFileName = opts.value( QStringLiteral( "timeline" ) ).toString();
+	o.m_memoryBudget = ( opts.contains( QStringLiteral( "memoryBudget" ) ) ?
+		static_cast< qint64 > ( opts.value( QStringLiteral( "memoryBudget" ) ).toDouble() *
+			1024.0 * 1024.0 ) : m_memoryBudget );
+	o.m_imagesCache = m_imagesCache;
+
+	// Highlighters are shared by all jobs, they highlight code blocks in parallel.
+	const auto theme = opts.value( QStringLiteral( "codeTheme" ) )
+		.toString( QStringLiteral( "GitHub Light" ) );
+	auto & syntax = m_syntax[ theme ];
+
+	if( !syntax )
+	{
+		syntax = std::make_shared< Syntax > ();
+		syntax->setTheme( syntax->themeForName( theme ) );
+	}
+
+	o.m_syntax = syntax;
+
+	return o;
+}
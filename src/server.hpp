@@ -0,0 +1,184 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MD_PDF_SERVER_HPP_INCLUDED
+#define MD_PDF_SERVER_HPP_INCLUDED
+
+// md-pdf include.
+#include "renderer.hpp"
+#include "syntax.hpp"
+
+// Qt include.
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QTemporaryFile>
+#include <QFile>
+#include <QJsonObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QMap>
+
+// C++ include.
+#include <memory>
+
+
+//
+// RenderJob
+//
+
+//! Render job of the server, sends events of renderer to the client.
+class RenderJob final
+	:	public QObject
+{
+	Q_OBJECT
+
+public:
+	RenderJob( const QString & id, QLocalSocket * socket, QObject * parent );
+	~RenderJob() override = default;
+
+	//! \return ID of the job.
+	const QString & id() const;
+	//! \return Renderer.
+	PdfRenderer * renderer() const;
+	//! \return Socket of the client, null if the client is gone.
+	QLocalSocket * socket() const;
+	//! Set renderer.
+	void setRenderer( PdfRenderer * r );
+	//! Set temporary file with inline Markdown.
+	void setMarkdownFile( QTemporaryFile * file );
+
+	//! Send event to the client.
+	void send( const QJsonObject & event );
+
+public slots:
+	void progress( int percent );
+	void error( const QString & msg );
+	void done( bool terminated );
+	void status( const QString & msg );
+	void report( const QJsonObject & r );
+
+private:
+	QString m_id;
+	QPointer< QLocalSocket > m_socket;
+	QPointer< PdfRenderer > m_renderer;
+
+	Q_DISABLE_COPY( RenderJob )
+}; // class RenderJob
+
+
+//
+// RenderServer
+//
+
+//! Render service over local socket.
+/*!
+	Client sends jobs as JSON objects, one per line:
+
+	{ "id" : "1", "input" : "/path/to/file.md", "recursive" : true,
+		"output" : "/path/to/file.pdf", "opts" : { "textFont" : "Droid Serif" } }
+
+	Instead of "input" may be "markdown" with Markdown text. All keys of "opts" are
+	optional: "textFont", "textFontSize", "codeFont", "codeFontSize", "mathFont",
+	"mathFontSize", "linkColor", "borderColor", "left", "right", "top", "bottom" (in points),
+	"dpi", "codeTheme", "compressionLevel", "compressionThreads" (0 for the ideal
+	count, the default is set with setCompressionThreads(); streams are re-compressed
+	only with "compressionLevel", so a job with threads but without level is
+	rejected), "useXRefStream",
+	"fullFontEmbedding", "useStandardFonts", "dryRun" (page map in JSON is written to "output" instead of PDF),
+	"trace" (file for binary trace of drawing primitives), "timeline" (file for
+	timeline of the render in Chrome trace event format), "memoryBudget" (in MB,
+	the render fails when resident memory of the service exceeds it, the default
+	is set with setMemoryBudget()).
+
+	Report has "memory" with bytes of tracked categories of memory, their peaks,
+	memory at the end of phases and peak resident memory of the service.
+
+	{ "id" : "1", "cancel" : true } terminates the job.
+
+	Server answers with events, one per line:
+
+	{ "id" : "1", "event" : "progress", "value" : 50 }
+	{ "id" : "1", "event" : "status", "message" : "..." }
+	{ "id" : "1", "event" : "error", "message" : "..." }
+	{ "id" : "1", "event" : "report", "report" : { "totalMs" : 10.5, "phases" : {...},
+		"counters" : {...}, "file" : "/path/to/file.pdf" } }
+	{ "id" : "1", "event" : "done", "terminated" : false }
+*/
+class RenderServer final
+	:	public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit RenderServer( QObject * parent = nullptr );
+	~RenderServer() override;
+
+	//! Start listening on the local socket with the given name.
+	bool listen( const QString & name );
+	//! \return Error string.
+	QString errorString() const;
+	//! Append reports of all renders to the file, one JSON per line.
+	bool setReportFile( const QString & fileName );
+	//! Set default memory budget of renders in bytes, 0 means no limit.
+	void setMemoryBudget( qint64 bytes );
+	//! Set default count of threads for compressing streams, 0 means the ideal count.
+	//! It's used only by jobs with compression level.
+	void setCompressionThreads( int count );
+
+private slots:
+	void newConnection();
+	void disconnected();
+	void readyRead();
+	void jobDone();
+	void writeReport( const QJsonObject & r );
+
+private:
+	//! Start job.
+	void startJob( const QJsonObject & job, QLocalSocket * socket );
+	//! Cancel job.
+	void cancelJob( const QString & id );
+	//! \return Render options from JSON.
+	RenderOpts renderOpts( const QJsonObject & opts );
+
+private:
+	QLocalServer m_server;
+	//! Queue of jobs and worker threads.
+	QThreadPool m_pool;
+	//! Syntax highlighters shared by jobs, one per theme, they are loaded once.
+	QMap< QString, std::shared_ptr< Syntax > > m_syntax;
+	//! Cache of images for all jobs, least recently used images are dropped.
+	std::shared_ptr< ImagesCache > m_imagesCache;
+	//! Running jobs.
+	QMap< QString, QPointer< RenderJob > > m_jobs;
+	//! File for reports of renders.
+	QFile m_reportFile;
+	//! Default memory budget of renders in bytes.
+	qint64 m_memoryBudget;
+	//! Default count of threads for compressing streams.
+	int m_compressionThreads;
+
+	Q_DISABLE_COPY( RenderServer )
+}; // class RenderServer
+
+#endif // MD_PDF_SERVER_HPP_INCLUDED
@@ -33,6 +33,52 @@
 #include <utility>
 
 
+namespace /* anonymous */ {
+
+//
+// Highlighter
+//
+
+//! Highlighter of one code block, it keeps state of the highlighting.
+class Highlighter final
+	:	public KSyntaxHighlighting::AbstractHighlighter
+{
+public:
+	explicit Highlighter( const KSyntaxHighlighting::Definition & definition )
+	{
+		setDefinition( definition );
+	}
+
+	//! \return Colors of the lines.
+	Syntax::Colors highlight( const QStringList & lines )
+	{
+		KSyntaxHighlighting::State st;
+		m_currentLineNumber = 0;
+		m_currentColors.clear();
+
+		for( const auto & s : lines )
+		{
+			st = highlightLine( s, st );
+			++m_currentLineNumber;
+		}
+
+		return m_currentColors;
+	}
+
+protected:
+	void applyFormat( int offset, int length, const KSyntaxHighlighting::Format & format ) override
+	{
+		m_currentColors.push_back( { m_currentLineNumber, offset, offset + length - 1, format } );
+	}
+
+private:
+	int m_currentLineNumber = 0;
+	Syntax::Colors m_currentColors;
+}; // class Highlighter
+
+} /* namespace anonymous */
+
+
 //
 // Syntax
 //
@@ -93,23 +139,37 @@ Syntax::themeForName( const QString & name ) const
 }
 
 void
-Syntax::applyFormat( int offset, int length, const KSyntaxHighlighting::Format & format )
+Syntax::setTheme( const KSyntaxHighlighting::Theme & theme )
 {
-	m_currentColors.push_back( { m_currentLineNumber, offset, offset + length - 1, format } );
+	m_theme = theme;
 }
 
-Syntax::Colors
-Syntax::prepare( const QStringList & lines )
+KSyntaxHighlighting::Theme
+Syntax::theme() const
+{
+	return m_theme;
+}
+
+KSyntaxHighlighting::Definition
+Syntax::loadedDefinition( const QString & name ) const
 {
-	KSyntaxHighlighting::State st;
-	m_currentLineNumber = 0;
-	m_currentColors.clear();
+	const auto definition = definitionForName( name );
 
-	for( const auto & s : std::as_const( lines ) )
+	QMutexLocker lock( &m_mutex );
+
+	// Definitions are loaded lazily on first use, included ones are loaded with it.
+	if( !m_loaded.contains( definition.name() ) )
 	{
-		st = highlightLine( s, st );
-		++m_currentLineNumber;
+		definition.includedDefinitions();
+
+		m_loaded.insert( definition.name() );
 	}
 
-	return m_currentColors;
+	return definition;
+}
+
+Syntax::Colors
+Syntax::prepare( const QStringList & lines, const QString & syntax ) const
+{
+	return Highlighter( loadedDefinition( syntax ) ).highlight( lines );
 }
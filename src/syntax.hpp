@@ -27,6 +27,8 @@
 #include <QString>
 #include <QVector>
 #include <QMap>
+#include <QMutex>
+#include <QSet>
 
 // KF6SyntaxHighlighting include.
 #include <abstracthighlighter.h>
@@ -41,12 +43,18 @@
 //
 
 //! Syntax highlighters.
+/*!
+	Loading of definitions is expensive, so one instance may be shared between
+	renderers in different threads. Repository and loaded definitions are shared
+	read-only, every call of prepare() highlights with its own highlighter and
+	state, so code blocks are highlighted in parallel. Theme should not be changed
+	while rendering.
+*/
 class Syntax final
-	:	public KSyntaxHighlighting::AbstractHighlighter
 {
 public:
 	Syntax();
-	~Syntax() override = default;
+	~Syntax() = default;
 
 	//! Color for the text.
 	struct Color {
@@ -63,22 +71,34 @@ public:
 	//! Vector of colored text auxiliary structs.
 	using Colors = QVector< Color >;
 
-	void applyFormat( int offset, int length, const KSyntaxHighlighting::Format & format ) override;
-
 	//! \return Vector of colored text auxiliary structs.
-	Colors prepare( const QStringList & lines );
+	Colors prepare( const QStringList & lines, const QString & syntax ) const;
 
 	KSyntaxHighlighting::Definition definitionForName( const QString & name ) const;
 	KSyntaxHighlighting::Theme themeForName( const QString & name ) const;
 
+	//! Set theme of highlighting.
+	void setTheme( const KSyntaxHighlighting::Theme & theme );
+	//! \return Theme of highlighting.
+	KSyntaxHighlighting::Theme theme() const;
+
 	const KSyntaxHighlighting::Repository & repository() const;
 
 private:
-	int m_currentLineNumber = 0;
-	Colors m_currentColors;
+	//! \return Definition for the name, it and included definitions are loaded.
+	KSyntaxHighlighting::Definition loadedDefinition( const QString & name ) const;
+
+private:
 	KSyntaxHighlighting::Repository m_repository;
 	QMap< QString, KSyntaxHighlighting::Definition > m_definitions;
 	QMap< QString, KSyntaxHighlighting::Theme > m_themes;
+	KSyntaxHighlighting::Theme m_theme;
+	//! Guard of lazy loading of definitions.
+	mutable QMutex m_mutex;
+	//! Names of loaded definitions.
+	mutable QSet< QString > m_loaded;
+
+	Q_DISABLE_COPY( Syntax )
 }; // class Syntax
 
 #endif // MD_PDF_SYNTAX_HPP_INCLUDED
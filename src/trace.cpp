@@ -0,0 +1,464 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// md-pdf include.
+#include "trace.hpp"
+
+// C++ include.
+#include <cstring>
+
+
+namespace /* anonymous */ {
+
+//! Magic of the trace file.
+static const char c_magic[ 8 ] = { 'M', 'D', 'P', 'D', 'F', 'T', 'R', 'C' };
+
+//! Version of the trace format.
+static const quint32 c_version = 1;
+
+//! Write plain value.
+template< typename T >
+void
+writeValue( QFile & file, const T & v )
+{
+	file.write( reinterpret_cast< const char* > ( &v ), sizeof( T ) );
+}
+
+//! Write bytes with length.
+void
+writeBytes( QFile & file, const QByteArray & data )
+{
+	writeValue( file, static_cast< quint32 > ( data.size() ) );
+	file.write( data );
+}
+
+//! Read plain value from the mapped data. \return false if out of bounds.
+template< typename T >
+bool
+readValue( const uchar * data, qint64 size, qint64 & pos, T & v )
+{
+	if( pos + static_cast< qint64 > ( sizeof( T ) ) > size )
+		return false;
+
+	std::memcpy( &v, data + pos, sizeof( T ) );
+	pos += sizeof( T );
+
+	return true;
+}
+
+//! Read bytes with length. \return false if out of bounds.
+bool
+readBytes( const uchar * data, qint64 size, qint64 & pos, QByteArray & v )
+{
+	quint32 length = 0;
+
+	if( !readValue( data, size, pos, length ) || pos + length > size )
+		return false;
+
+	v = QByteArray( reinterpret_cast< const char* > ( data + pos ), length );
+	pos += length;
+
+	return true;
+}
+
+//! \return Empty record of the given type.
+TraceRecord
+record( TraceRecordType type, quint32 page )
+{
+	TraceRecord r;
+	std::memset( &r, 0, sizeof( TraceRecord ) );
+	r.type = type;
+	r.page = page;
+
+	return r;
+}
+
+} /* namespace anonymous */
+
+
+//
+// TraceWriter
+//
+
+TraceWriter::TraceWriter( const QString & fileName )
+	:	m_file( fileName )
+{
+}
+
+bool
+TraceWriter::open()
+{
+	if( !m_file.open( QIODevice::WriteOnly ) )
+		return false;
+
+	// Header is rewritten on finish.
+	TraceHeader h;
+	std::memset( &h, 0, sizeof( TraceHeader ) );
+	writeValue( m_file, h );
+
+	return true;
+}
+
+bool
+TraceWriter::finish( quint32 pagesCount, double pageWidth, double pageHeight )
+{
+	TraceHeader h;
+	std::memset( &h, 0, sizeof( TraceHeader ) );
+	std::memcpy( h.magic, c_magic, sizeof( c_magic ) );
+	h.version = c_version;
+	h.pagesCount = pagesCount;
+	h.recordsCount = m_recordsCount;
+	h.tablesOffset = m_file.pos();
+	h.pageWidth = pageWidth;
+	h.pageHeight = pageHeight;
+
+	writeValue( m_file, static_cast< quint32 > ( m_strings.size() ) );
+
+	for( const auto & s : std::as_const( m_strings ) )
+		writeBytes( m_file, s );
+
+	writeValue( m_file, static_cast< quint32 > ( m_fonts.size() ) );
+
+	for( const auto & f : std::as_const( m_fonts ) )
+	{
+		writeValue( m_file, f.standard14 );
+		writeValue( m_file, f.faceIndex );
+		writeBytes( m_file, f.path.toUtf8() );
+	}
+
+	writeValue( m_file, static_cast< quint32 > ( m_images.size() ) );
+
+	for( const auto & i : std::as_const( m_images ) )
+	{
+		writeValue( m_file, static_cast< quint32 > ( i.width() ) );
+		writeValue( m_file, static_cast< quint32 > ( i.height() ) );
+	}
+
+	if( !m_file.seek( 0 ) )
+		return false;
+
+	writeValue( m_file, h );
+
+	m_file.close();
+
+	return ( m_file.error() == QFileDevice::NoError );
+}
+
+void
+TraceWriter::drawText( quint32 page, double x, double y, const char * text, PoDoFo::PdfFont * f,
+	double size, double scale, bool strikeout )
+{
+	auto r = record( TraceRecordType::Text, page );
+	r.flags = ( strikeout ? 1 : 0 );
+	r.string = string( text );
+	r.object = font( f );
+	r.args[ 0 ] = x;
+	r.args[ 1 ] = y;
+	r.args[ 2 ] = size;
+	r.args[ 3 ] = scale;
+
+	write( r );
+}
+
+void
+TraceWriter::drawImage( quint32 page, double x, double y, PoDoFo::PdfImage * img,
+	double xScale, double yScale )
+{
+	auto r = record( TraceRecordType::Image, page );
+	r.object = image( img );
+	r.args[ 0 ] = x;
+	r.args[ 1 ] = y;
+	r.args[ 2 ] = xScale;
+	r.args[ 3 ] = yScale;
+
+	write( r );
+}
+
+void
+TraceWriter::drawLine( quint32 page, double x1, double y1, double x2, double y2 )
+{
+	auto r = record( TraceRecordType::Line, page );
+	r.args[ 0 ] = x1;
+	r.args[ 1 ] = y1;
+	r.args[ 2 ] = x2;
+	r.args[ 3 ] = y2;
+
+	write( r );
+}
+
+void
+TraceWriter::drawRectangle( quint32 page, double x, double y, double width, double height,
+	PoDoFo::PdfPathDrawMode m )
+{
+	auto r = record( TraceRecordType::Rectangle, page );
+	r.flags = static_cast< quint8 > ( m );
+	r.args[ 0 ] = x;
+	r.args[ 1 ] = y;
+	r.args[ 2 ] = width;
+	r.args[ 3 ] = height;
+
+	write( r );
+}
+
+void
+TraceWriter::drawCircle( quint32 page, double x, double y, double radius,
+	PoDoFo::PdfPathDrawMode m )
+{
+	auto r = record( TraceRecordType::Circle, page );
+	r.flags = static_cast< quint8 > ( m );
+	r.args[ 0 ] = x;
+	r.args[ 1 ] = y;
+	r.args[ 2 ] = radius;
+
+	write( r );
+}
+
+void
+TraceWriter::setColor( quint32 page, double red, double green, double blue )
+{
+	auto r = record( TraceRecordType::Color, page );
+	r.args[ 0 ] = red;
+	r.args[ 1 ] = green;
+	r.args[ 2 ] = blue;
+
+	write( r );
+}
+
+quint32
+TraceWriter::string( const char * text )
+{
+	const QByteArray s( text );
+
+	const auto it = m_stringsIdx.constFind( s );
+
+	if( it != m_stringsIdx.cend() )
+		return it.value();
+
+	const auto idx = static_cast< quint32 > ( m_strings.size() );
+	m_strings.append( s );
+	m_stringsIdx.insert( s, idx );
+
+	return idx;
+}
+
+quint32
+TraceWriter::font( PoDoFo::PdfFont * f )
+{
+	const auto it = m_fontsIdx.constFind( f );
+
+	if( it != m_fontsIdx.cend() )
+		return it.value();
+
+	TraceFont tf;
+	PoDoFo::PdfStandard14FontType type;
+
+	if( f->IsStandard14Font( type ) )
+		tf.standard14 = static_cast< qint32 > ( type );
+	else
+	{
+		tf.faceIndex = f->GetMetrics().GetFaceIndex();
+		tf.path = QString::fromStdString( f->GetMetrics().GetFilePath() );
+	}
+
+	const auto idx = static_cast< quint32 > ( m_fonts.size() );
+	m_fonts.append( tf );
+	m_fontsIdx.insert( f, idx );
+
+	return idx;
+}
+
+quint32
+TraceWriter::image( PoDoFo::PdfImage * img )
+{
+	const auto it = m_imagesIdx.constFind( img );
+
+	if( it != m_imagesIdx.cend() )
+		return it.value();
+
+	const auto idx = static_cast< quint32 > ( m_images.size() );
+	m_images.append( QSize( img->GetWidth(), img->GetHeight() ) );
+	m_imagesIdx.insert( img, idx );
+
+	return idx;
+}
+
+void
+TraceWriter::write( const TraceRecord & r )
+{
+	writeValue( m_file, r );
+	++m_recordsCount;
+}
+
+
+//
+// TraceReader
+//
+
+TraceReader::TraceReader( const QString & fileName )
+	:	m_file( fileName )
+{
+	std::memset( &m_header, 0, sizeof( TraceHeader ) );
+}
+
+bool
+TraceReader::open()
+{
+	if( !m_file.open( QIODevice::ReadOnly ) )
+	{
+		m_error = m_file.errorString();
+
+		return false;
+	}
+
+	const auto size = m_file.size();
+	m_data = m_file.map( 0, size );
+
+	if( !m_data )
+	{
+		m_error = m_file.errorString();
+
+		return false;
+	}
+
+	qint64 pos = 0;
+
+	if( !readValue( m_data, size, pos, m_header ) ||
+		std::memcmp( m_header.magic, c_magic, sizeof( c_magic ) ) != 0 )
+	{
+		m_error = QStringLiteral( "Not a trace of drawing primitives." );
+
+		return false;
+	}
+
+	if( m_header.version != c_version )
+	{
+		m_error = QStringLiteral( "Unsupported version of the trace: %1." )
+			.arg( m_header.version );
+
+		return false;
+	}
+
+	if( m_header.tablesOffset != sizeof( TraceHeader ) +
+		m_header.recordsCount * sizeof( TraceRecord ) )
+	{
+		m_error = QStringLiteral( "Trace is corrupted." );
+
+		return false;
+	}
+
+	pos = static_cast< qint64 > ( m_header.tablesOffset );
+
+	quint32 count = 0;
+	bool ok = readValue( m_data, size, pos, count );
+
+	for( quint32 i = 0; ok && i < count; ++i )
+	{
+		QByteArray s;
+		ok = readBytes( m_data, size, pos, s );
+		m_strings.append( s );
+	}
+
+	ok = ok && readValue( m_data, size, pos, count );
+
+	for( quint32 i = 0; ok && i < count; ++i )
+	{
+		TraceFont f;
+		QByteArray path;
+		ok = readValue( m_data, size, pos, f.standard14 ) &&
+			readValue( m_data, size, pos, f.faceIndex ) &&
+			readBytes( m_data, size, pos, path );
+		f.path = QString::fromUtf8( path );
+		m_fonts.append( f );
+	}
+
+	ok = ok && readValue( m_data, size, pos, count );
+
+	for( quint32 i = 0; ok && i < count; ++i )
+	{
+		quint32 width = 0, height = 0;
+		ok = readValue( m_data, size, pos, width ) && readValue( m_data, size, pos, height );
+		m_images.append( QSize( width, height ) );
+	}
+
+	if( !ok )
+	{
+		m_error = QStringLiteral( "Trace is corrupted." );
+
+		return false;
+	}
+
+	const auto * r = records();
+
+	for( quint64 i = 0; i < m_header.recordsCount; ++i, ++r )
+	{
+		const bool validObject = ( r->type == TraceRecordType::Text ?
+				r->object < static_cast< quint32 > ( m_fonts.size() ) &&
+					r->string < static_cast< quint32 > ( m_strings.size() ) :
+			( r->type == TraceRecordType::Image ?
+				r->object < static_cast< quint32 > ( m_images.size() ) : true ) );
+
+		if( r->page >= m_header.pagesCount || !validObject )
+		{
+			m_error = QStringLiteral( "Trace is corrupted." );
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const QString &
+TraceReader::errorString() const
+{
+	return m_error;
+}
+
+const TraceHeader &
+TraceReader::header() const
+{
+	return m_header;
+}
+
+const TraceRecord *
+TraceReader::records() const
+{
+	return reinterpret_cast< const TraceRecord* > ( m_data + sizeof( TraceHeader ) );
+}
+
+const QVector< QByteArray > &
+TraceReader::strings() const
+{
+	return m_strings;
+}
+
+const QVector< TraceFont > &
+TraceReader::fonts() const
+{
+	return m_fonts;
+}
+
+const QVector< QSize > &
+TraceReader::images() const
+{
+	return m_images;
+}
@@ -0,0 +1,194 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MD_PDF_TRACE_HPP_INCLUDED
+#define MD_PDF_TRACE_HPP_INCLUDED
+
+// Qt include.
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+#include <QSize>
+
+// podofo include.
+#include <podofo/podofo.h>
+
+
+//
+// Binary trace of drawing primitives.
+//
+// Layout of the file (native byte order):
+//
+//	TraceHeader
+//	TraceRecord[ recordsCount ]
+//	strings: quint32 count, { quint32 length, bytes }
+//	fonts: quint32 count, { qint32 standard 14 type or -1, quint32 face index,
+//		quint32 length, bytes of path }
+//	images: quint32 count, { quint32 width, quint32 height }
+//
+// Records have fixed size and start right after the header, so the trace
+// can be mapped in memory and records used in place.
+//
+
+//! Type of the trace record.
+enum class TraceRecordType : quint8 {
+	//! args: x, y, size, scale. string, object - font, flags - strikeout.
+	Text = 0,
+	//! args: x, y, xScale, yScale. object - image.
+	Image,
+	//! args: x1, y1, x2, y2.
+	Line,
+	//! args: x, y, width, height. flags - draw mode.
+	Rectangle,
+	//! args: x, y, r. flags - draw mode.
+	Circle,
+	//! args: red, green, blue.
+	Color
+}; // enum class TraceRecordType
+
+//! Record of the drawing primitive.
+struct TraceRecord {
+	//! Type.
+	TraceRecordType type;
+	//! Flags, see TraceRecordType.
+	quint8 flags;
+	quint16 reserved;
+	//! Index of the page.
+	quint32 page;
+	//! Index of the string in the strings table.
+	quint32 string;
+	//! Index of the font or of the image.
+	quint32 object;
+	//! Arguments.
+	double args[ 6 ];
+}; // struct TraceRecord
+
+static_assert( sizeof( TraceRecord ) == 64, "Trace record should have fixed size." );
+
+//! Header of the trace.
+struct TraceHeader {
+	//! Magic, "MDPDFTRC".
+	char magic[ 8 ];
+	//! Version of the format.
+	quint32 version;
+	//! Count of pages.
+	quint32 pagesCount;
+	//! Count of records.
+	quint64 recordsCount;
+	//! Offset of the tables.
+	quint64 tablesOffset;
+	//! Size of the page.
+	double pageWidth;
+	double pageHeight;
+}; // struct TraceHeader
+
+//! Font in the trace.
+struct TraceFont {
+	//! Type of the standard 14 font, or -1 if font is loaded from file.
+	qint32 standard14 = -1;
+	//! Face index in the file.
+	quint32 faceIndex = 0;
+	//! Path to the file of the font.
+	QString path;
+}; // struct TraceFont
+
+
+//
+// TraceWriter
+//
+
+//! Writer of the trace of drawing primitives.
+class TraceWriter final {
+public:
+	explicit TraceWriter( const QString & fileName );
+
+	//! Open file. \return false on error.
+	bool open();
+	//! Write tables and finalize header. \return false on error.
+	bool finish( quint32 pagesCount, double pageWidth, double pageHeight );
+
+	void drawText( quint32 page, double x, double y, const char * text, PoDoFo::PdfFont * font,
+		double size, double scale, bool strikeout );
+	void drawImage( quint32 page, double x, double y, PoDoFo::PdfImage * img,
+		double xScale, double yScale );
+	void drawLine( quint32 page, double x1, double y1, double x2, double y2 );
+	void drawRectangle( quint32 page, double x, double y, double width, double height,
+		PoDoFo::PdfPathDrawMode m );
+	void drawCircle( quint32 page, double x, double y, double r, PoDoFo::PdfPathDrawMode m );
+	void setColor( quint32 page, double r, double g, double b );
+
+private:
+	//! \return Index of the interned string.
+	quint32 string( const char * text );
+	//! \return Index of the interned font.
+	quint32 font( PoDoFo::PdfFont * f );
+	//! \return Index of the interned image.
+	quint32 image( PoDoFo::PdfImage * img );
+	//! Write record.
+	void write( const TraceRecord & r );
+
+private:
+	QFile m_file;
+	quint64 m_recordsCount = 0;
+	QHash< QByteArray, quint32 > m_stringsIdx;
+	QVector< QByteArray > m_strings;
+	QHash< PoDoFo::PdfFont*, quint32 > m_fontsIdx;
+	QVector< TraceFont > m_fonts;
+	QHash< PoDoFo::PdfImage*, quint32 > m_imagesIdx;
+	QVector< QSize > m_images;
+}; // class TraceWriter
+
+
+//
+// TraceReader
+//
+
+//! Reader of the trace, records are mapped in memory.
+class TraceReader final {
+public:
+	explicit TraceReader( const QString & fileName );
+
+	//! Open and map trace. \return false on error.
+	bool open();
+	//! \return Description of the last error.
+	const QString & errorString() const;
+
+	const TraceHeader & header() const;
+	//! \return Pointer to the first record.
+	const TraceRecord * records() const;
+	const QVector< QByteArray > & strings() const;
+	const QVector< TraceFont > & fonts() const;
+	const QVector< QSize > & images() const;
+
+private:
+	QFile m_file;
+	QString m_error;
+	const uchar * m_data = nullptr;
+	TraceHeader m_header;
+	QVector< QByteArray > m_strings;
+	QVector< TraceFont > m_fonts;
+	QVector< QSize > m_images;
+}; // class TraceReader
+
+#endif // MD_PDF_TRACE_HPP_INCLUDED
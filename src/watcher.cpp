@@ -0,0 +1,265 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// md4qt include.
+#define MD4QT_QT_SUPPORT
+#include <md4qt/parser.hpp>
+
+// md-pdf include.
+#include "watcher.hpp"
+
+// Qt include.
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+
+
+namespace /* anonymous */ {
+
+//! \return Hash of the parsed item with all nested items.
+size_t
+itemHash( MD::Item< MD::QStringTrait > * item, size_t seed )
+{
+	size_t h = qHashMulti( seed, static_cast< int > ( item->type() ), item->startLine(),
+		item->startColumn(), item->endLine(), item->endColumn() );
+
+	switch( item->type() )
+	{
+		case MD::ItemType::Heading :
+		{
+			auto * heading = static_cast< MD::Heading< MD::QStringTrait >* > ( item );
+
+			h = qHashMulti( h, heading->level(), heading->label() );
+
+			if( heading->text() )
+				h = itemHash( heading->text().get(), h );
+		}
+			break;
+
+		case MD::ItemType::Text :
+		{
+			auto * text = static_cast< MD::Text< MD::QStringTrait >* > ( item );
+
+			h = qHashMulti( h, text->text(), text->opts() );
+		}
+			break;
+
+		case MD::ItemType::Code :
+		{
+			auto * code = static_cast< MD::Code< MD::QStringTrait >* > ( item );
+
+			h = qHashMulti( h, code->text(), code->syntax(), code->isInline(), code->opts() );
+		}
+			break;
+
+		case MD::ItemType::Math :
+		{
+			auto * math = static_cast< MD::Math< MD::QStringTrait >* > ( item );
+
+			h = qHashMulti( h, math->expr(), math->isInline() );
+		}
+			break;
+
+		case MD::ItemType::Link :
+		{
+			auto * link = static_cast< MD::Link< MD::QStringTrait >* > ( item );
+
+			h = qHashMulti( h, link->url(), link->text(), link->opts() );
+
+			if( link->p() )
+				h = itemHash( link->p().get(), h );
+
+			if( link->img() )
+				h = itemHash( link->img().get(), h );
+		}
+			break;
+
+		case MD::ItemType::Image :
+		{
+			auto * image = static_cast< MD::Image< MD::QStringTrait >* > ( item );
+
+			h = qHashMulti( h, image->url(), image->text() );
+		}
+			break;
+
+		case MD::ItemType::FootnoteRef :
+			h = qHashMulti( h,
+				static_cast< MD::FootnoteRef< MD::QStringTrait >* > ( item )->id() );
+			break;
+
+		case MD::ItemType::Anchor :
+			h = qHashMulti( h, static_cast< MD::Anchor< MD::QStringTrait >* > ( item )->label() );
+			break;
+
+		case MD::ItemType::ListItem :
+		{
+			auto * li = static_cast< MD::ListItem< MD::QStringTrait >* > ( item );
+
+			h = qHashMulti( h, static_cast< int > ( li->listType() ), li->isTaskList(),
+				li->isChecked() );
+		}
+			break;
+
+		case MD::ItemType::Table :
+		{
+			for( const auto & r : static_cast< MD::Table< MD::QStringTrait >* > ( item )->rows() )
+			{
+				for( const auto & c : r->cells() )
+					h = itemHash( c.get(), h );
+			}
+		}
+			break;
+
+		default :
+			break;
+	}
+
+	auto * block = dynamic_cast< MD::Block< MD::QStringTrait >* > ( item );
+
+	if( block )
+	{
+		for( const auto & i : block->items() )
+			h = itemHash( i.get(), h );
+	}
+
+	return h;
+}
+
+} /* namespace anonymous */
+
+size_t
+documentHash( std::shared_ptr< MD::Document< MD::QStringTrait > > doc )
+{
+	// Hash is taken from the parsed document, not from files that may be changed after parsing.
+	size_t h = itemHash( doc.get(), 0 );
+
+	for( const auto & f : doc->footnotesMap() )
+		h = itemHash( f.second.get(), qHashMulti( h, f.first ) );
+
+	return h;
+}
+
+//
+// Watcher
+//
+
+//! Delay before re-parsing, editors may write a file in a few steps.
+static const int c_reparseDelay = 300;
+
+Watcher::Watcher()
+	:	m_watcher( this )
+	,	m_timer( this )
+	,	m_recursive( false )
+	,	m_hash( 0 )
+{
+	m_timer.setSingleShot( true );
+	m_timer.setInterval( c_reparseDelay );
+
+	connect( &m_watcher, &QFileSystemWatcher::fileChanged, this, &Watcher::fileChanged );
+	connect( &m_timer, &QTimer::timeout, this, &Watcher::reparse );
+	connect( this, &Watcher::stopRequested, this, &Watcher::stopImpl, Qt::QueuedConnection );
+}
+
+void
+Watcher::watch( const QString & fileName, bool recursive,
+	std::shared_ptr< MD::Document< MD::QStringTrait > > doc )
+{
+	Q_ASSERT( thread() == QThread::currentThread() );
+
+	stopImpl();
+
+	m_fileName = fileName;
+	m_recursive = recursive;
+	m_hash = documentHash( doc );
+
+	watchFiles( doc );
+}
+
+void
+Watcher::stop()
+{
+	emit stopRequested();
+}
+
+void
+Watcher::stopImpl()
+{
+	m_timer.stop();
+
+	if( !m_watcher.files().isEmpty() )
+		m_watcher.removePaths( m_watcher.files() );
+
+	m_hash = 0;
+}
+
+void
+Watcher::watchFiles( std::shared_ptr< MD::Document< MD::QStringTrait > > doc )
+{
+	QStringList files;
+	files.append( QFileInfo( m_fileName ).absoluteFilePath() );
+
+	for( const auto & item : doc->items() )
+	{
+		if( item->type() == MD::ItemType::Anchor )
+		{
+			const auto & label = static_cast< MD::Anchor< MD::QStringTrait >* > ( item.get() )->label();
+
+			if( QFileInfo::exists( label ) && !files.contains( label ) )
+				files.append( label );
+		}
+	}
+
+	// Editors may save a file by replacing it, and such file is removed from watcher.
+	const auto watched = m_watcher.files();
+
+	for( const auto & f : std::as_const( files ) )
+	{
+		if( !watched.contains( f ) )
+			m_watcher.addPath( f );
+	}
+}
+
+void
+Watcher::fileChanged()
+{
+	m_timer.start();
+}
+
+void
+Watcher::reparse()
+{
+	MD::Parser< MD::QStringTrait > parser;
+
+	auto doc = parser.parse( m_fileName, m_recursive );
+
+	watchFiles( doc );
+
+	const auto hash = documentHash( doc );
+
+	// Saves without changes of content are skipped.
+	if( hash != m_hash && !doc->isEmpty() )
+	{
+		m_hash = hash;
+
+		emit changed( doc );
+	}
+}
@@ -0,0 +1,95 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MD_PDF_WATCHER_HPP_INCLUDED
+#define MD_PDF_WATCHER_HPP_INCLUDED
+
+// md4qt include.
+#define MD4QT_QT_SUPPORT
+#include <md4qt/traits.hpp>
+#include <md4qt/doc.hpp>
+
+// Qt include.
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+// C++ include.
+#include <memory>
+
+
+//! \return Hash of the parsed document with footnotes.
+size_t documentHash( std::shared_ptr< MD::Document< MD::QStringTrait > > doc );
+
+
+//
+// Watcher
+//
+
+//! Watcher for changes of Markdown files.
+/*!
+	On a change files are re-parsed and changed() is emitted only if the parsed
+	document differs from the previous one. The document is rendered again
+	as a whole, layout of unchanged blocks is not reused.
+*/
+class Watcher final
+	:	public QObject
+{
+	Q_OBJECT
+
+signals:
+	//! Markdown was changed.
+	void changed( std::shared_ptr< MD::Document< MD::QStringTrait > > doc );
+	//! Internal signal for stop watching.
+	void stopRequested();
+
+public:
+	Watcher();
+	~Watcher() override = default;
+
+	//! Start watching for the Markdown file and all linked files of the parsed document.
+	//! Should be called in the watcher's thread, re-parsing is done there too.
+	void watch( const QString & fileName, bool recursive,
+		std::shared_ptr< MD::Document< MD::QStringTrait > > doc );
+	//! Stop watching.
+	void stop();
+
+private slots:
+	void stopImpl();
+	void fileChanged();
+	void reparse();
+
+private:
+	//! Watch for files of the given document.
+	void watchFiles( std::shared_ptr< MD::Document< MD::QStringTrait > > doc );
+
+private:
+	QFileSystemWatcher m_watcher;
+	QTimer m_timer;
+	QString m_fileName;
+	bool m_recursive;
+	size_t m_hash;
+
+	Q_DISABLE_COPY( Watcher )
+}; // class Watcher
+
+#endif // MD_PDF_WATCHER_HPP_INCLUDED
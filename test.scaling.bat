@@ -0,0 +1,3 @@
+set OPENSSL_MODULES=./../lib/ossl-modules
+set OPENSSL_ENGINES=./../lib/engines-3
+start "" test.scaling.exe
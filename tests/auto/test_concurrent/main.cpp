@@ -0,0 +1,251 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <src/renderer.hpp>
+#include <src/syntax.hpp>
+#include <src/podofo_paintdevice.hpp>
+
+#include <test_const.hpp>
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QVector>
+#include <QMap>
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <QTemporaryDir>
+#include <QRegularExpression>
+
+// C++ include.
+#include <memory>
+
+
+//! Count of renderers running at once.
+static const int c_threadsCount = 16;
+
+//
+// TestConcurrent
+//
+
+class TestConcurrent final
+	:	public QObject
+{
+	Q_OBJECT
+
+private slots:
+	//! Init tests, render reference PDFs one by one.
+	void initTestCase();
+	//! Render corpus in parallel threads and compare with reference PDFs.
+	void testConcurrentRendering();
+	void testConcurrentRendering_data();
+
+private:
+	//! Render files, renderer of the file i works in the thread i % threadsCount.
+	void render( const QStringList & files, const QString & folder, int threadsCount,
+		bool standardFonts );
+
+private:
+	QTemporaryDir m_dir;
+	//! Markdown files of the corpus.
+	QStringList m_files;
+	//! Reference PDFs with standard and with embedded fonts.
+	QMap< bool, QMap< QString, QByteArray > > m_reference;
+	//! Syntax highlighter shared by all renderers.
+	std::shared_ptr< Syntax > m_syntax;
+}; // class TestConcurrent
+
+//! \return Content of PDF without dates and ID.
+static QByteArray
+normalizedPdf( const QString & fileName )
+{
+	QFile file( fileName );
+
+	if( !file.open( QIODevice::ReadOnly ) )
+		return {};
+
+	auto data = QString::fromLatin1( file.readAll() );
+
+	static const QRegularExpression dates( QStringLiteral(
+		"/(CreationDate|ModDate)\\s*\\([^)]*\\)" ) );
+	static const QRegularExpression id( QStringLiteral( "/ID\\s*\\[[^\\]]*\\]" ) );
+
+	data.remove( dates );
+	data.remove( id );
+
+	return data.toLatin1();
+}
+
+void
+TestConcurrent::initTestCase()
+{
+	QVERIFY( m_dir.isValid() );
+
+	m_syntax = std::make_shared< Syntax > ();
+	m_syntax->setTheme( m_syntax->themeForName( QStringLiteral( "GitHub Light" ) ) );
+
+	const QDir corpus( c_folder + QStringLiteral( "/../../manual" ) );
+	const auto files = corpus.entryList( { QStringLiteral( "*.md" ) }, QDir::Files, QDir::Name );
+
+	// Images from network may differ between renders.
+	static const QRegularExpression networkImage( QStringLiteral( "!\\[[^\\]]*\\]\\(https?://" ) );
+
+	for( const auto & f : files )
+	{
+		QFile file( corpus.absoluteFilePath( f ) );
+
+		if( file.open( QIODevice::ReadOnly ) &&
+			!QString::fromUtf8( file.readAll() ).contains( networkImage ) )
+				m_files.append( corpus.absoluteFilePath( f ) );
+	}
+
+	QVERIFY( !m_files.isEmpty() );
+
+	// Fonts of tests are found by fontconfig independently of fonts installed in the system.
+	{
+		QMutexLocker lock( &fontsMutex() );
+
+		PoDoFo::PdfFontManager::AddFontDirectory(
+			QDir( c_folder + QStringLiteral( "/../../fonts" ) ).absolutePath().toLocal8Bit().data() );
+	}
+
+	for( const auto standardFonts : { true, false } )
+	{
+		const auto folder = m_dir.path() + QStringLiteral( "/reference%1" ).arg( standardFonts );
+		QVERIFY( QDir().mkpath( folder ) );
+
+		render( m_files, folder, 1, standardFonts );
+
+		if( QTest::currentTestFailed() )
+			return;
+
+		for( qsizetype i = 0; i < m_files.size(); ++i )
+		{
+			const auto pdf = normalizedPdf( QStringLiteral( "%1/%2.pdf" ).arg( folder ).arg( i ) );
+
+			QVERIFY( !pdf.isEmpty() );
+
+			m_reference[ standardFonts ].insert( m_files.at( i ), pdf );
+		}
+	}
+}
+
+void
+TestConcurrent::render( const QStringList & files, const QString & folder, int threadsCount,
+	bool standardFonts )
+{
+	RenderOpts opts;
+	opts.m_borderColor = QColor( 81, 81, 81 );
+	opts.m_linkColor = QColor( 33, 122, 255 );
+	opts.m_syntax = m_syntax;
+	opts.m_textFont = QStringLiteral( "Droid Serif" );
+	opts.m_textFontSize = 8;
+	opts.m_codeFont = QStringLiteral( "Courier New" );
+	opts.m_codeFontSize = 8;
+	opts.m_mathFont = QStringLiteral( "Droid Serif" );
+	opts.m_mathFontSize = 8;
+	opts.m_left = 50.0;
+	opts.m_right = 50.0;
+	opts.m_top = 50.0;
+	opts.m_bottom = 50.0;
+	opts.m_dpi = 150;
+	// Embedded fonts are searched, created and subset by all threads at once.
+	opts.m_useStandardFonts = standardFonts;
+
+	QVector< QThread* > threads;
+
+	for( int i = 0; i < threadsCount; ++i )
+	{
+		threads.push_back( new QThread( this ) );
+		threads.back()->start();
+	}
+
+	QObject context;
+	int finished = 0;
+	QStringList errors;
+
+	for( qsizetype i = 0; i < files.size(); ++i )
+	{
+		auto * pdf = new PdfRenderer;
+		pdf->moveToThread( threads.at( i % threadsCount ) );
+
+		connect( pdf, &PdfRenderer::error, &context,
+			[&errors] ( const QString & msg ) { errors.append( msg ); } );
+		connect( pdf, &QObject::destroyed, &context, [&finished] () { ++finished; } );
+
+		pdf->renderFile( QStringLiteral( "%1/%2.pdf" ).arg( folder ).arg( i ),
+			files.at( i ), true, opts );
+	}
+
+	QTRY_COMPARE_WITH_TIMEOUT( finished, files.size(), 10 * 60 * 1000 );
+
+	for( auto * t : std::as_const( threads ) )
+	{
+		t->quit();
+		t->wait();
+		delete t;
+	}
+
+	QVERIFY2( errors.isEmpty(), qPrintable( errors.join( QLatin1Char( '\n' ) ) ) );
+}
+
+void
+TestConcurrent::testConcurrentRendering_data()
+{
+	QTest::addColumn< bool > ( "standardFonts" );
+
+	QTest::newRow( "standard fonts" ) << true;
+	QTest::newRow( "embedded fonts" ) << false;
+}
+
+void
+TestConcurrent::testConcurrentRendering()
+{
+	QFETCH( bool, standardFonts );
+
+	QStringList files;
+
+	// Every thread renders at least once, every file is rendered at least once.
+	for( qsizetype i = 0; i < qMax< qsizetype > ( c_threadsCount, m_files.size() ); ++i )
+		files.append( m_files.at( i % m_files.size() ) );
+
+	const auto folder = m_dir.path() + QStringLiteral( "/concurrent%1" ).arg( standardFonts );
+	QVERIFY( QDir().mkpath( folder ) );
+
+	render( files, folder, c_threadsCount, standardFonts );
+
+	if( QTest::currentTestFailed() )
+		return;
+
+	for( qsizetype i = 0; i < files.size(); ++i )
+	{
+		const auto pdf = normalizedPdf( QStringLiteral( "%1/%2.pdf" ).arg( folder ).arg( i ) );
+
+		QVERIFY2( pdf == m_reference[ standardFonts ].value( files.at( i ) ),
+			qPrintable( QStringLiteral( "PDF of %1 differs from the reference." )
+				.arg( files.at( i ) ) ) );
+	}
+}
+
+QTEST_MAIN( TestConcurrent )
+
+#include "main.moc"
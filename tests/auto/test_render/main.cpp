@@ -22,6 +22,7 @@
 
 #include <src/renderer.hpp>
 #include <src/syntax.hpp>
+#include <src/podofo_paintdevice.hpp>
 
 // md4qt include.
 #define MD4QT_QT_SUPPORT
@@ -34,6 +35,10 @@
 #include <QSignalSpy>
 #include <QVector>
 #include <QFontDatabase>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
 
 //
 // TestRender
@@ -108,11 +113,52 @@ private slots:
 	void testMath();
 	//! Test math.
 	void testMathBigFont();
+
+	//! Test dry run.
+	void testDryRun();
+	//! Test trace of drawing primitives.
+	void testTrace();
+	//! Test report of the render.
+	void testReport();
+	//! Test timeline of the render.
+	void testTimeline();
+	//! Test memory budget.
+	void testMemoryBudget();
+
+	//! Test subset of WinAnsi for standard 14 fonts.
+	void testWinAnsiSubset();
+
+	//! Test embedding of whole fonts.
+	void testFullFontEmbedding();
 }; // class TestRender
 
 //! Prepare test data or do actual test?
 static const bool c_printData = false;
 
+//! \return Options of the render shared by tests.
+static RenderOpts
+defaultOpts( double textFontSize = 8.0, double codeFontSize = 8.0 )
+{
+	RenderOpts opts;
+	opts.m_borderColor = QColor( 81, 81, 81 );
+	opts.m_linkColor = QColor( 33, 122, 255 );
+	opts.m_bottom = 50.0;
+	opts.m_syntax = std::make_shared< Syntax > ();
+	opts.m_syntax->setTheme( opts.m_syntax->themeForName( QStringLiteral( "GitHub Light" ) ) );
+	opts.m_codeFont = QStringLiteral( "Courier New" );
+	opts.m_codeFontSize = codeFontSize;
+	opts.m_left = 50.0;
+	opts.m_right = 50.0;
+	opts.m_textFont = QStringLiteral( "Droid Serif" );
+	opts.m_textFontSize = textFontSize;
+	opts.m_mathFont = QStringLiteral( "Droid Serif" );
+	opts.m_mathFontSize = textFontSize;
+	opts.m_top = 50.0;
+	opts.m_dpi = 150;
+
+	return opts;
+}
+
 struct TestRendering {
 	static void
 	testRendering( const QString & fileName, const QString & suffix,
@@ -122,23 +168,7 @@ struct TestRendering {
 
 		auto doc = parser.parse( c_folder + QStringLiteral( "/../../manual/" ) + fileName, true );
 
-		RenderOpts opts;
-		opts.m_borderColor = QColor( 81, 81, 81 );
-		opts.m_linkColor = QColor( 33, 122, 255 );
-		opts.m_bottom = 50.0;
-		opts.m_syntax = std::make_shared< Syntax > ();
-		opts.m_syntax->setTheme( opts.m_syntax->themeForName( QStringLiteral( "GitHub Light" ) ) );
-		opts.m_codeFont = QStringLiteral( "Courier New" );
-		opts.m_codeFontSize = codeFontSize;
-		opts.m_left = 50.0;
-		opts.m_linkColor = QColor( 33, 122, 255 );
-		opts.m_right = 50.0;
-		opts.m_textFont = QStringLiteral( "Droid Serif" );
-		opts.m_textFontSize = textFontSize;
-		opts.m_mathFont = QStringLiteral( "Droid Serif" );
-		opts.m_mathFontSize = textFontSize;
-		opts.m_top = 50.0;
-		opts.m_dpi = 150;
+		auto opts = defaultOpts( textFontSize, codeFontSize );
 
 		opts.testData = data;
 		opts.printDrawings = c_printData;
@@ -439,6 +469,327 @@ TestRender::testVeryLongFootnoteBigFont()
 	doTest( QStringLiteral( "footnotes4.md" ), QStringLiteral( "_big" ), 16.0, 14.0 );
 }
 
+void
+TestRender::testDryRun()
+{
+	MD::Parser< MD::QStringTrait > parser;
+
+	auto doc = parser.parse( c_folder + QStringLiteral( "/../../manual/complex.md" ), true );
+
+	auto opts = defaultOpts();
+	opts.m_dryRun = true;
+
+	const auto fileName = QStringLiteral( "./complex.md.json" );
+
+	PdfRenderer render;
+	QSignalSpy spy( &render, &PdfRenderer::pageMap );
+
+	render.render( fileName, doc, opts );
+	render.renderImpl();
+
+	QVERIFY( !render.isError() );
+	QCOMPARE( spy.count(), 1 );
+
+	const auto map = spy.at( 0 ).at( 0 ).value< QJsonObject > ();
+	const auto pages = map.value( QStringLiteral( "pages" ) ).toInt();
+	const auto blocks = map.value( QStringLiteral( "blocks" ) ).toArray();
+
+	QVERIFY( pages > 0 );
+	QVERIFY( !blocks.isEmpty() );
+
+	int prevPage = 1;
+
+	for( const auto & b : blocks )
+	{
+		const auto where = b.toObject().value( QStringLiteral( "where" ) ).toArray();
+
+		QVERIFY( !where.isEmpty() );
+
+		for( const auto & w : where )
+		{
+			const auto page = w.toObject().value( QStringLiteral( "page" ) ).toInt();
+
+			QVERIFY( page >= 1 && page <= pages );
+		}
+
+		const auto firstPage = where.first().toObject().value( QStringLiteral( "page" ) ).toInt();
+
+		QVERIFY( firstPage >= prevPage );
+
+		prevPage = firstPage;
+	}
+
+	QFile file( fileName );
+	QVERIFY( file.open( QIODevice::ReadOnly ) );
+	QCOMPARE( QJsonDocument::fromJson( file.readAll() ).object(), map );
+}
+
+void
+TestRender::testTrace()
+{
+	MD::Parser< MD::QStringTrait > parser;
+
+	auto doc = parser.parse( c_folder + QStringLiteral( "/../../manual/footnotes.md" ), true );
+
+	auto opts = defaultOpts();
+	opts.m_traceFileName = QStringLiteral( "./footnotes.md.trace" );
+
+	PdfRenderer render;
+
+	render.render( QStringLiteral( "./footnotes.md.trace.pdf" ), doc, opts );
+	render.renderImpl();
+
+	QVERIFY( !render.isError() );
+
+	TraceReader trace( opts.m_traceFileName );
+	QVERIFY2( trace.open(), qPrintable( trace.errorString() ) );
+
+	QVERIFY( trace.header().pagesCount > 0 );
+	QVERIFY( trace.header().recordsCount > 0 );
+	QVERIFY( trace.header().pageWidth > 0.0 );
+	QVERIFY( !trace.fonts().isEmpty() );
+
+	int texts = 0;
+	const auto * r = trace.records();
+
+	for( quint64 i = 0; i < trace.header().recordsCount; ++i, ++r )
+	{
+		if( r->type == TraceRecordType::Text )
+		{
+			QVERIFY( !trace.strings().at( r->string ).isEmpty() );
+			++texts;
+		}
+	}
+
+	QVERIFY( texts > 0 );
+}
+
+void
+TestRender::testReport()
+{
+	MD::Parser< MD::QStringTrait > parser;
+
+	auto doc = parser.parse( c_folder + QStringLiteral( "/../../manual/code.md" ), true );
+
+	auto opts = defaultOpts();
+	opts.m_dryRun = true;
+
+	PdfRenderer render;
+	QSignalSpy spy( &render, &PdfRenderer::report );
+
+	render.render( QStringLiteral( "./code.md.json" ), doc, opts );
+	render.renderImpl();
+
+	QVERIFY( !render.isError() );
+	QCOMPARE( spy.count(), 1 );
+
+	const auto report = spy.at( 0 ).at( 0 ).value< QJsonObject > ();
+	const auto phases = report.value( QStringLiteral( "phases" ) ).toObject();
+	const auto counters = report.value( QStringLiteral( "counters" ) ).toObject();
+
+	QVERIFY( report.value( QStringLiteral( "totalMs" ) ).toDouble() > 0.0 );
+
+	for( const auto & p : { QStringLiteral( "code" ), QStringLiteral( "highlighting" ),
+		QStringLiteral( "finishPages" ), QStringLiteral( "save" ) } )
+	{
+		const auto phase = phases.value( p ).toObject();
+
+		QVERIFY2( phase.value( QStringLiteral( "calls" ) ).toInt() > 0, qPrintable( p ) );
+		QVERIFY( phase.value( QStringLiteral( "wallMs" ) ).toDouble() >= 0.0 );
+	}
+
+	// Document is given, so it's not parsed.
+	QVERIFY( !phases.contains( QStringLiteral( "parse" ) ) );
+
+	QVERIFY( counters.value( QStringLiteral( "stringWidth" ) ).toInteger() > 0 );
+	QVERIFY( counters.value( QStringLiteral( "createFont" ) ).toInteger() > 0 );
+	QVERIFY( counters.value( QStringLiteral( "pages" ) ).toInteger() > 0 );
+	QVERIFY( counters.value( QStringLiteral( "bytesWritten" ) ).toInteger() > 0 );
+
+	const auto blocks = report.value( QStringLiteral( "topBlocks" ) ).toArray();
+
+	QVERIFY( !blocks.isEmpty() );
+	QVERIFY( blocks.size() <= 20 );
+
+	double prevTime = blocks.first().toObject().value( QStringLiteral( "wallMs" ) ).toDouble();
+
+	for( const auto & b : blocks )
+	{
+		const auto block = b.toObject();
+		const auto time = block.value( QStringLiteral( "wallMs" ) ).toDouble();
+
+		QVERIFY( time <= prevTime );
+		QVERIFY( block.value( QStringLiteral( "startLine" ) ).toInteger() > 0 );
+		QVERIFY( block.value( QStringLiteral( "endLine" ) ).toInteger() >=
+			block.value( QStringLiteral( "startLine" ) ).toInteger() );
+
+		prevTime = time;
+	}
+
+	const auto memory = report.value( QStringLiteral( "memory" ) ).toObject();
+	const auto categories = memory.value( QStringLiteral( "categories" ) ).toObject();
+
+	QVERIFY( memory.value( QStringLiteral( "peakRssBytes" ) ).toInteger() > 0 );
+	QVERIFY( memory.value( QStringLiteral( "peakTrackedBytes" ) ).toInteger() > 0 );
+	QVERIFY( categories.value( QStringLiteral( "document" ) ).toObject()
+		.value( QStringLiteral( "bytes" ) ).toInteger() > 0 );
+	QVERIFY( categories.value( QStringLiteral( "customWidth" ) ).toObject()
+		.value( QStringLiteral( "peakBytes" ) ).toInteger() > 0 );
+	// Nothing is drawn in dry run.
+	QCOMPARE( categories.value( QStringLiteral( "painters" ) ).toObject()
+		.value( QStringLiteral( "peakBytes" ) ).toInteger(), 0 );
+	QVERIFY( memory.value( QStringLiteral( "phases" ) ).toObject()
+		.contains( QStringLiteral( "code" ) ) );
+}
+
+void
+TestRender::testTimeline()
+{
+	MD::Parser< MD::QStringTrait > parser;
+
+	auto doc = parser.parse( c_folder + QStringLiteral( "/../../manual/code.md" ), true );
+
+	auto opts = defaultOpts();
+	opts.m_dryRun = true;
+	opts.m_timelineFileName = QStringLiteral( "./code.md.timeline.json" );
+
+	PdfRenderer render;
+
+	render.render( QStringLiteral( "./code.md.json" ), doc, opts );
+	render.renderImpl();
+
+	QVERIFY( !render.isError() );
+
+	QFile file( opts.m_timelineFileName );
+	QVERIFY( file.open( QIODevice::ReadOnly ) );
+
+	const auto events = QJsonDocument::fromJson( file.readAll() ).object()
+		.value( QStringLiteral( "traceEvents" ) ).toArray();
+
+	QVERIFY( !events.isEmpty() );
+
+	QStringList names;
+
+	for( const auto & e : events )
+	{
+		const auto event = e.toObject();
+
+		QCOMPARE( event.value( QStringLiteral( "ph" ) ).toString(), QStringLiteral( "X" ) );
+		QVERIFY( event.value( QStringLiteral( "dur" ) ).toDouble() >= 0.0 );
+
+		names.append( event.value( QStringLiteral( "name" ) ).toString() );
+	}
+
+	QVERIFY( names.contains( QStringLiteral( "code" ) ) );
+	QVERIFY( names.contains( QStringLiteral( "highlight" ) ) );
+	QVERIFY( names.contains( QStringLiteral( "createPage" ) ) );
+}
+
+void
+TestRender::testMemoryBudget()
+{
+	MD::Parser< MD::QStringTrait > parser;
+
+	auto doc = parser.parse( c_folder + QStringLiteral( "/../../manual/code.md" ), true );
+
+	auto opts = defaultOpts();
+	opts.m_dryRun = true;
+	// Any process needs more than a kilobyte.
+	opts.m_memoryBudget = 1024;
+
+	PdfRenderer render;
+	QSignalSpy spy( &render, &PdfRenderer::error );
+
+	render.render( QStringLiteral( "./code.md.json" ), doc, opts );
+	render.renderImpl();
+
+	QVERIFY( render.isError() );
+	QCOMPARE( spy.count(), 1 );
+	QVERIFY( spy.at( 0 ).at( 0 ).toString().startsWith( QStringLiteral( "Memory budget" ) ) );
+}
+
+void
+TestRender::testWinAnsiSubset()
+{
+	std::string buf;
+
+	// Encodable text is returned as is.
+	const char * plain = "Plain text \xC3\xA9";
+	QCOMPARE( winAnsiSubset( plain, buf ), plain );
+
+	// Curly quotes, dashes, euro, bullet and ellipsis are in WinAnsi.
+	const char * typography = "\xE2\x80\x9Cq\xE2\x80\x9D \xE2\x80\x93 \xE2\x80\x94 "
+		"\xE2\x82\xAC \xE2\x80\xA2 \xE2\x80\xA6";
+	QCOMPARE( winAnsiSubset( typography, buf ), typography );
+
+	// C1 controls, CJK and characters out of BMP are not.
+	QCOMPARE( QByteArray( winAnsiSubset( "a\xC2\x80" "b\xE4\xB8\xAD" "c\xF0\x9F\x98\x80" "d", buf ) ),
+		QByteArray( "a?b?c?d" ) );
+}
+
+//! \return Lengths of font programs embedded into PDF.
+static QVector< qint64 >
+embeddedFontsLengths( const QString & fileName )
+{
+	PoDoFo::PdfMemDocument doc;
+	doc.Load( fileName.toStdString() );
+
+	QVector< qint64 > lengths;
+
+	for( const auto * obj : doc.GetObjects() )
+	{
+		if( obj->IsDictionary() && obj->HasStream() )
+		{
+			const auto * length = obj->GetDictionary().FindKey( "Length1" );
+
+			if( length )
+				lengths.append( length->GetNumber() );
+		}
+	}
+
+	return lengths;
+}
+
+void
+TestRender::testFullFontEmbedding()
+{
+	MD::Parser< MD::QStringTrait > parser;
+
+	auto doc = parser.parse( c_folder + QStringLiteral( "/../../manual/footnotes.md" ), true );
+
+	const auto fontSize = QFileInfo( c_font ).size();
+
+	for( const auto full : { false, true } )
+	{
+		auto opts = defaultOpts();
+		// Trace sink draws without verification of test data.
+		opts.m_traceFileName = QStringLiteral( "./footnotes.md.fonts.trace" );
+		opts.m_fullFontEmbedding = full;
+
+		const auto fileName = QStringLiteral( "./footnotes.md.fonts.pdf" );
+
+		PdfRenderer render;
+
+		render.render( fileName, doc, opts );
+		render.renderImpl();
+
+		QVERIFY( !render.isError() );
+
+		const auto lengths = embeddedFontsLengths( fileName );
+
+		QVERIFY( !lengths.isEmpty() );
+
+		// PoDoFo subsets by default, with the opt-out the text font is embedded as is.
+		if( full )
+			QVERIFY( lengths.contains( fontSize ) );
+		else
+		{
+			for( const auto l : lengths )
+				QVERIFY( l < fontSize );
+		}
+	}
+}
+
 QTEST_MAIN( TestRender )
 
 #include "main.moc"
@@ -0,0 +1,384 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <src/renderer.hpp>
+#include <src/syntax.hpp>
+
+#include <tests/generator/generator.hpp>
+
+#include <test_const.hpp>
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+// C++ include.
+#include <cmath>
+#include <memory>
+
+
+Q_DECLARE_METATYPE( GeneratorOpts )
+
+//! Argument of the child process that renders one file.
+static const char * c_renderArg = "--render";
+//! Argument of the child process to keep all pages open till the end of the render.
+static const char * c_keepPagesArg = "--keep-pages";
+
+//! Sizes of the document.
+static const int c_factors[] = { 1, 2, 4, 8 };
+
+//! Maximum allowed exponent of growth of time.
+static const double c_timeExponent = 1.3;
+//! Maximum allowed exponent of growth of memory.
+static const double c_memoryExponent = 1.3;
+
+//! Measurements of one render.
+struct Measure {
+	//! Time of the render in milliseconds.
+	double ms = 0.0;
+	//! Growth of peak RSS during the render in bytes.
+	double memory = 0.0;
+}; // struct Measure
+
+//! Render Markdown file in this process and print measurements in JSON.
+static int
+renderFile( const QString & fileName, bool finishPagesEarly )
+{
+	RenderOpts opts;
+	opts.m_borderColor = QColor( 81, 81, 81 );
+	opts.m_linkColor = QColor( 33, 122, 255 );
+	opts.m_syntax = std::make_shared< Syntax > ();
+	opts.m_syntax->setTheme( opts.m_syntax->themeForName( QStringLiteral( "GitHub Light" ) ) );
+	opts.m_textFont = QStringLiteral( "Droid Serif" );
+	opts.m_textFontSize = 8;
+	opts.m_codeFont = QStringLiteral( "Courier New" );
+	opts.m_codeFontSize = 8;
+	opts.m_mathFont = QStringLiteral( "Droid Serif" );
+	opts.m_mathFontSize = 8;
+	opts.m_left = 50.0;
+	opts.m_right = 50.0;
+	opts.m_top = 50.0;
+	opts.m_bottom = 50.0;
+	opts.m_dpi = 150;
+	// Not embedded fonts don't depend on fonts installed in the system.
+	opts.m_useStandardFonts = true;
+	opts.m_finishPagesEarly = finishPagesEarly;
+
+	auto * pdf = new PdfRenderer;
+
+	QEventLoop loop;
+	QString error;
+
+	QObject::connect( pdf, &PdfRenderer::error,
+		[&error] ( const QString & msg ) { error = msg; } );
+	QObject::connect( pdf, &QObject::destroyed, &loop, &QEventLoop::quit );
+
+	const auto before = PdfRenderer::peakMemoryUsage();
+
+	QElapsedTimer timer;
+	timer.start();
+
+	pdf->renderFile( fileName + QStringLiteral( ".pdf" ), fileName, false, opts );
+
+	loop.exec();
+
+	const auto ms = static_cast< double > ( timer.nsecsElapsed() ) / 1000000.0;
+
+	if( !error.isEmpty() )
+	{
+		QTextStream( stderr ) << error << Qt::endl;
+
+		return 1;
+	}
+
+	QTextStream( stdout ) << QJsonDocument( QJsonObject{ { QStringLiteral( "ms" ), ms },
+		{ QStringLiteral( "memory" ), PdfRenderer::peakMemoryUsage() - before } } )
+			.toJson( QJsonDocument::Compact ) << Qt::endl;
+
+	return 0;
+}
+
+//! \return Slope of least squares line through points (log(x), log(y)).
+static double
+exponent( const QVector< QPair< double, double > > & points )
+{
+	double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+
+	for( const auto & p : points )
+	{
+		const auto x = std::log( p.first );
+		const auto y = std::log( qMax( p.second, 1.0 ) );
+
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+	}
+
+	const double n = points.size();
+
+	return ( n * sxy - sx * sy ) / ( n * sxx - sx * sx );
+}
+
+//
+// TestScaling
+//
+
+//! Renders generated documents of growing size and checks that cost grows almost linearly.
+class TestScaling final
+	:	public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	//! Time and memory grow not faster than allowed exponent.
+	void testScaling_data();
+	void testScaling();
+	//! Finishing of pages early lowers peak memory of a long document, but doesn't
+	//! make it flat: page objects with compressed content stay in the document.
+	void testPeakMemory();
+
+private:
+	//! Render file in child process, so peak memory of every render is its own.
+	Measure measure( const QString & fileName, bool finishPagesEarly = true );
+
+private:
+	QTemporaryDir m_dir;
+}; // class TestScaling
+
+void
+TestScaling::initTestCase()
+{
+	QVERIFY( m_dir.isValid() );
+}
+
+Measure
+TestScaling::measure( const QString & fileName, bool finishPagesEarly )
+{
+	QStringList args = { QString::fromLatin1( c_renderArg ), fileName };
+
+	if( !finishPagesEarly )
+		args.append( QString::fromLatin1( c_keepPagesArg ) );
+
+	QProcess process;
+	process.start( QCoreApplication::applicationFilePath(), args );
+
+	if( !process.waitForFinished( 10 * 60 * 1000 ) || process.exitCode() != 0 )
+	{
+		QTest::qFail( qPrintable( QStringLiteral( "Render of %1 failed: %2" ).arg( fileName,
+			QString::fromLocal8Bit( process.readAllStandardError() ) ) ), __FILE__, __LINE__ );
+
+		return {};
+	}
+
+	const auto json = QJsonDocument::fromJson( process.readAllStandardOutput().trimmed() ).object();
+
+	return { json.value( QStringLiteral( "ms" ) ).toDouble(),
+		json.value( QStringLiteral( "memory" ) ).toDouble() };
+}
+
+void
+TestScaling::testScaling_data()
+{
+	QTest::addColumn< GeneratorOpts > ( "opts" );
+	QTest::addColumn< bool > ( "scaleTableRows" );
+
+	GeneratorOpts mixed;
+	mixed.imagePath = c_folder + QStringLiteral( "/../../manual/img/1.jpg" );
+
+	QTest::newRow( "mixed" ) << mixed << false;
+
+	GeneratorOpts references;
+	references.paragraphs = 100;
+	references.footnotes = 200;
+	references.links = 400;
+	references.anchors = 100;
+	references.tables = 0;
+	references.codeBlocks = 0;
+	references.images = 0;
+
+	QTest::newRow( "footnotes and links" ) << references << false;
+
+	GeneratorOpts table;
+	table.paragraphs = 10;
+	table.footnotes = 0;
+	table.links = 0;
+	table.anchors = 1;
+	table.tables = 1;
+	table.tableRows = 200;
+	table.tableColumns = 6;
+	table.codeBlocks = 0;
+	table.images = 0;
+	table.nesting = 0;
+
+	QTest::newRow( "big table" ) << table << true;
+
+	GeneratorOpts tokens;
+	tokens.paragraphs = 100;
+	tokens.tables = 0;
+	tokens.images = 0;
+	tokens.tokenLength = 60;
+
+	QTest::newRow( "long tokens" ) << tokens << false;
+}
+
+void
+TestScaling::testScaling()
+{
+	QFETCH( GeneratorOpts, opts );
+	QFETCH( bool, scaleTableRows );
+
+	QVector< QPair< double, double > > time, memory;
+	QStringList log;
+
+	for( const auto factor : c_factors )
+	{
+		auto o = opts.scaled( factor );
+
+		if( scaleTableRows )
+			o.tableRows *= factor;
+
+		const auto fileName = m_dir.filePath( QStringLiteral( "%1_%2x.md" )
+			.arg( QTest::currentDataTag() ).arg( factor ) );
+
+		{
+			QFile file( fileName );
+			QVERIFY( file.open( QIODevice::WriteOnly ) );
+			file.write( Generator().generate( o ) );
+		}
+
+		// The best of two runs is less noisy.
+		auto m = measure( fileName );
+
+		if( QTest::currentTestFailed() )
+			return;
+
+		const auto second = measure( fileName );
+
+		if( QTest::currentTestFailed() )
+			return;
+
+		m.ms = qMin( m.ms, second.ms );
+		m.memory = qMin( m.memory, second.memory );
+
+		time.append( qMakePair( static_cast< double > ( factor ), m.ms ) );
+		memory.append( qMakePair( static_cast< double > ( factor ), m.memory ) );
+
+		log.append( QStringLiteral( "%1x: %2 ms, %3 KB" ).arg( factor )
+			.arg( m.ms, 0, 'f', 1 ).arg( m.memory / 1024.0, 0, 'f', 0 ) );
+	}
+
+	const auto timeExp = exponent( time );
+	const auto memoryExp = exponent( memory );
+
+	qInfo().noquote() << log.join( QStringLiteral( "; " ) )
+		<< QStringLiteral( "; time exponent %1, memory exponent %2" )
+			.arg( timeExp, 0, 'f', 2 ).arg( memoryExp, 0, 'f', 2 );
+
+	QVERIFY2( timeExp <= c_timeExponent,
+		qPrintable( QStringLiteral( "Time grows as n^%1: %2" ).arg( timeExp, 0, 'f', 2 )
+			.arg( log.join( QStringLiteral( "; " ) ) ) ) );
+	QVERIFY2( memoryExp <= c_memoryExponent,
+		qPrintable( QStringLiteral( "Memory grows as n^%1: %2" ).arg( memoryExp, 0, 'f', 2 )
+			.arg( log.join( QStringLiteral( "; " ) ) ) ) );
+}
+
+void
+TestScaling::testPeakMemory()
+{
+	// One long table keeps its start page reachable, so pages are finished inside of it.
+	GeneratorOpts opts;
+	opts.paragraphs = 10;
+	opts.footnotes = 0;
+	opts.links = 0;
+	opts.anchors = 1;
+	opts.tables = 1;
+	opts.tableRows = 3200;
+	opts.tableColumns = 6;
+	opts.codeBlocks = 0;
+	opts.images = 0;
+	opts.nesting = 0;
+
+	const auto fileName = m_dir.filePath( QStringLiteral( "peak_memory.md" ) );
+
+	{
+		QFile file( fileName );
+		QVERIFY( file.open( QIODevice::WriteOnly ) );
+		file.write( Generator().generate( opts ) );
+	}
+
+	// The best of two runs is less noisy.
+	const auto bestMemory = [this, &fileName] ( bool finishPagesEarly ) -> double
+	{
+		const auto first = measure( fileName, finishPagesEarly ).memory;
+
+		if( QTest::currentTestFailed() )
+			return 0.0;
+
+		return qMin( first, measure( fileName, finishPagesEarly ).memory );
+	};
+
+	const auto kept = bestMemory( false );
+
+	if( QTest::currentTestFailed() )
+		return;
+
+	const auto finished = bestMemory( true );
+
+	if( QTest::currentTestFailed() )
+		return;
+
+	const auto log = QStringLiteral( "peak RSS growth with all pages kept %1 KB, "
+		"with pages finished early %2 KB (not streaming, finished pages stay in "
+		"PdfMemDocument till save)" )
+			.arg( kept / 1024.0, 0, 'f', 0 ).arg( finished / 1024.0, 0, 'f', 0 );
+
+	qInfo().noquote() << log;
+
+	QVERIFY2( finished <= kept, qPrintable( log ) );
+}
+
+int
+main( int argc, char ** argv )
+{
+	QApplication app( argc, argv );
+
+	if( ( argc == 3 || argc == 4 ) && qstrcmp( argv[ 1 ], c_renderArg ) == 0 )
+		return renderFile( QString::fromLocal8Bit( argv[ 2 ] ),
+			!( argc == 4 && qstrcmp( argv[ 3 ], c_keepPagesArg ) == 0 ) );
+
+	TestScaling test;
+
+	QTEST_SET_MAIN_SOURCE_PATH
+
+	return QTest::qExec( &test, argc, argv );
+}
+
+#include "main.moc"
@@ -0,0 +1,370 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <src/renderer.hpp>
+
+#include <tests/generator/generator.hpp>
+
+#include <bench_const.hpp>
+
+// Qt include.
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTemporaryDir>
+#include <QRegularExpression>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+
+// C++ include.
+#include <algorithm>
+#include <memory>
+
+
+//! Result of the benchmark of one document.
+struct Result {
+	//! Name of the document.
+	QString name;
+	//! Size of Markdown in bytes.
+	qint64 markdownSize = 0;
+	//! Median time of the render in milliseconds.
+	double medianMs = 0.0;
+	//! Count of pages.
+	qint64 pages = 0;
+	//! Size of PDF in bytes.
+	qint64 outputSize = 0;
+	//! Error, if any.
+	QString error;
+
+	QJsonObject toJson() const
+	{
+		const double seconds = medianMs / 1000.0;
+
+		return { { QStringLiteral( "name" ), name },
+			{ QStringLiteral( "markdownBytes" ), markdownSize },
+			{ QStringLiteral( "medianMs" ), medianMs },
+			{ QStringLiteral( "pages" ), pages },
+			{ QStringLiteral( "outputBytes" ), outputSize },
+			{ QStringLiteral( "pagesPerSec" ), ( seconds > 0.0 ? pages / seconds : 0.0 ) },
+			{ QStringLiteral( "mbPerSec" ), ( seconds > 0.0 ?
+				markdownSize / ( 1024.0 * 1024.0 ) / seconds : 0.0 ) } };
+	}
+}; // struct Result
+
+//! \return Render options with pinned fonts.
+static RenderOpts
+renderOpts( std::shared_ptr< Syntax > syntax )
+{
+	RenderOpts opts;
+	opts.m_borderColor = QColor( 81, 81, 81 );
+	opts.m_linkColor = QColor( 33, 122, 255 );
+	opts.m_syntax = syntax;
+	opts.m_textFont = QStringLiteral( "Droid Serif" );
+	opts.m_textFontSize = 8;
+	opts.m_codeFont = QStringLiteral( "Courier New" );
+	opts.m_codeFontSize = 8;
+	opts.m_mathFont = QStringLiteral( "Droid Serif" );
+	opts.m_mathFontSize = 8;
+	opts.m_left = 50.0;
+	opts.m_right = 50.0;
+	opts.m_top = 50.0;
+	opts.m_bottom = 50.0;
+	opts.m_dpi = 150;
+
+	return opts;
+}
+
+//! Render file once. \return Time in milliseconds.
+static double
+renderOnce( const QString & markdown, const QString & pdf, const RenderOpts & opts,
+	Result & result )
+{
+	auto * renderer = new PdfRenderer;
+
+	QEventLoop loop;
+	QElapsedTimer timer;
+
+	QObject::connect( renderer, &PdfRenderer::error,
+		[&result] ( const QString & msg ) { result.error = msg; } );
+	QObject::connect( renderer, &PdfRenderer::report,
+		[&result] ( const QJsonObject & r )
+		{
+			const auto counters = r.value( QStringLiteral( "counters" ) ).toObject();
+
+			result.pages = counters.value( QStringLiteral( "pages" ) ).toInteger();
+			result.outputSize = counters.value( QStringLiteral( "bytesWritten" ) ).toInteger();
+		} );
+	// Renderer deletes himself on finish.
+	QObject::connect( renderer, &QObject::destroyed, &loop, &QEventLoop::quit );
+
+	timer.start();
+
+	renderer->renderFile( pdf, markdown, true, opts );
+
+	loop.exec();
+
+	return static_cast< double > ( timer.nsecsElapsed() ) / 1000000.0;
+}
+
+//! Benchmark rendering of the file.
+static Result
+bench( const QString & name, const QString & markdown, const QString & pdf,
+	const RenderOpts & opts, int iterations )
+{
+	Result result;
+	result.name = name;
+	result.markdownSize = QFileInfo( markdown ).size();
+
+	std::vector< double > times;
+
+	// Warm up caches of fonts and highlighters.
+	renderOnce( markdown, pdf, opts, result );
+
+	for( int i = 0; i < iterations && result.error.isEmpty(); ++i )
+		times.push_back( renderOnce( markdown, pdf, opts, result ) );
+
+	if( !times.empty() )
+	{
+		std::sort( times.begin(), times.end() );
+		result.medianMs = times.at( times.size() / 2 );
+	}
+
+	return result;
+}
+
+//! Compare results with baseline. \return Count of regressions.
+static int
+compare( const QJsonObject & results, const QJsonObject & baseline, double threshold,
+	QTextStream & out )
+{
+	int regressions = 0;
+
+	QMap< QString, QJsonObject > base;
+
+	for( const auto & d : baseline.value( QStringLiteral( "documents" ) ).toArray() )
+		base.insert( d.toObject().value( QStringLiteral( "name" ) ).toString(), d.toObject() );
+
+	const auto check = [&] ( const QString & what, double current, double reference,
+		bool higherIsBetter )
+	{
+		if( reference <= 0.0 )
+			return;
+
+		const double change = ( current - reference ) / reference * 100.0;
+
+		if( ( higherIsBetter ? -change : change ) > threshold )
+		{
+			out << QStringLiteral( "REGRESSION %1: %2 -> %3 (%4%)" )
+				.arg( what ).arg( reference ).arg( current ).arg( change, 0, 'f', 1 ) << Qt::endl;
+
+			++regressions;
+		}
+	};
+
+	for( const auto & d : results.value( QStringLiteral( "documents" ) ).toArray() )
+	{
+		const auto doc = d.toObject();
+		const auto name = doc.value( QStringLiteral( "name" ) ).toString();
+
+		if( !base.contains( name ) )
+			continue;
+
+		const auto & ref = base[ name ];
+
+		check( name + QStringLiteral( " pages/sec" ),
+			doc.value( QStringLiteral( "pagesPerSec" ) ).toDouble(),
+			ref.value( QStringLiteral( "pagesPerSec" ) ).toDouble(), true );
+		check( name + QStringLiteral( " output size" ),
+			doc.value( QStringLiteral( "outputBytes" ) ).toDouble(),
+			ref.value( QStringLiteral( "outputBytes" ) ).toDouble(), false );
+	}
+
+	check( QStringLiteral( "peak RSS" ),
+		results.value( QStringLiteral( "peakRssBytes" ) ).toDouble(),
+		baseline.value( QStringLiteral( "peakRssBytes" ) ).toDouble(), false );
+
+	return regressions;
+}
+
+int main( int argc, char ** argv )
+{
+	QApplication app( argc, argv );
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription( QStringLiteral(
+		"Benchmark of rendering of test and synthetic Markdown documents." ) );
+	parser.addHelpOption();
+	QCommandLineOption iterations( { QStringLiteral( "n" ), QStringLiteral( "iterations" ) },
+		QStringLiteral( "Render every document <count> times." ),
+		QStringLiteral( "count" ), QStringLiteral( "5" ) );
+	parser.addOption( iterations );
+	QCommandLineOption scale( { QStringLiteral( "s" ), QStringLiteral( "scale" ) },
+		QStringLiteral( "Large synthetic document is <factor> times bigger than the small one." ),
+		QStringLiteral( "factor" ), QStringLiteral( "20" ) );
+	parser.addOption( scale );
+	QCommandLineOption output( { QStringLiteral( "o" ), QStringLiteral( "output" ) },
+		QStringLiteral( "Write results in JSON to <file>." ), QStringLiteral( "file" ) );
+	parser.addOption( output );
+	QCommandLineOption baseline( { QStringLiteral( "b" ), QStringLiteral( "baseline" ) },
+		QStringLiteral( "Compare results with baseline results in <file>." ),
+		QStringLiteral( "file" ) );
+	parser.addOption( baseline );
+	QCommandLineOption threshold( { QStringLiteral( "t" ), QStringLiteral( "threshold" ) },
+		QStringLiteral( "Regression threshold in <percent>." ),
+		QStringLiteral( "percent" ), QStringLiteral( "10" ) );
+	parser.addOption( threshold );
+
+	parser.process( app );
+
+	QTextStream out( stdout );
+
+	// Fonts are taken from the test fonts, not from the system.
+	PoDoFo::PdfFontManager::AddFontDirectory( QDir::toNativeSeparators( c_fontsFolder )
+		.toLocal8Bit().data() );
+
+	QTemporaryDir dir;
+
+	if( !dir.isValid() )
+	{
+		QTextStream( stderr ) << QStringLiteral( "Unable to create temporary directory." )
+			<< Qt::endl;
+
+		return 1;
+	}
+
+	QStringList files;
+
+	const QDir corpus( c_folder + QStringLiteral( "/../../manual" ) );
+
+	// Images from network make results unstable.
+	static const QRegularExpression networkImage( QStringLiteral( "!\\[[^\\]]*\\]\\(https?://" ) );
+
+	for( const auto & f : corpus.entryList( { QStringLiteral( "*.md" ) }, QDir::Files, QDir::Name ) )
+	{
+		QFile file( corpus.absoluteFilePath( f ) );
+
+		if( file.open( QIODevice::ReadOnly ) &&
+			!QString::fromUtf8( file.readAll() ).contains( networkImage ) )
+				files.append( corpus.absoluteFilePath( f ) );
+	}
+
+	GeneratorOpts generatorOpts;
+	generatorOpts.imagePath = corpus.absoluteFilePath( QStringLiteral( "img/1.jpg" ) );
+
+	for( const int factor : { 1, qMax( 1, parser.value( scale ).toInt() ) } )
+	{
+		const auto fileName = dir.filePath( QStringLiteral( "synthetic_%1x.md" ).arg( factor ) );
+		QFile file( fileName );
+
+		if( file.open( QIODevice::WriteOnly ) )
+		{
+			file.write( Generator().generate( generatorOpts.scaled( factor ) ) );
+			file.close();
+
+			files.append( fileName );
+		}
+	}
+
+	auto syntax = std::make_shared< Syntax > ();
+	syntax->setTheme( syntax->themeForName( QStringLiteral( "GitHub Light" ) ) );
+
+	const auto opts = renderOpts( syntax );
+	const int count = qMax( 1, parser.value( iterations ).toInt() );
+
+	QJsonArray documents;
+	int errors = 0;
+
+	for( const auto & f : std::as_const( files ) )
+	{
+		const auto name = QFileInfo( f ).fileName();
+		const auto r = bench( name, f, dir.filePath( name + QStringLiteral( ".pdf" ) ),
+			opts, count );
+
+		if( !r.error.isEmpty() )
+		{
+			QTextStream( stderr ) << name << QStringLiteral( ": " ) << r.error << Qt::endl;
+
+			++errors;
+
+			continue;
+		}
+
+		const auto json = r.toJson();
+
+		out << QStringLiteral( "%1: %2 ms, %3 pages/sec, %4 MB/sec, %5 bytes" )
+			.arg( name ).arg( r.medianMs, 0, 'f', 1 )
+			.arg( json.value( QStringLiteral( "pagesPerSec" ) ).toDouble(), 0, 'f', 1 )
+			.arg( json.value( QStringLiteral( "mbPerSec" ) ).toDouble(), 0, 'f', 3 )
+			.arg( r.outputSize ) << Qt::endl;
+
+		documents.append( json );
+	}
+
+	const QJsonObject results = { { QStringLiteral( "iterations" ), count },
+		{ QStringLiteral( "peakRssBytes" ), PdfRenderer::peakMemoryUsage() },
+		{ QStringLiteral( "documents" ), documents } };
+
+	out << QStringLiteral( "Peak RSS: %1 MB" )
+		.arg( PdfRenderer::peakMemoryUsage() / ( 1024 * 1024 ) ) << Qt::endl;
+
+	if( parser.isSet( output ) )
+	{
+		QFile file( parser.value( output ) );
+
+		if( !file.open( QIODevice::WriteOnly ) )
+		{
+			QTextStream( stderr ) << QStringLiteral( "Unable to write results to %1." )
+				.arg( parser.value( output ) ) << Qt::endl;
+
+			return 1;
+		}
+
+		file.write( QJsonDocument( results ).toJson() );
+	}
+
+	if( parser.isSet( baseline ) )
+	{
+		QFile file( parser.value( baseline ) );
+
+		if( !file.open( QIODevice::ReadOnly ) )
+		{
+			QTextStream( stderr ) << QStringLiteral( "Unable to read baseline from %1." )
+				.arg( parser.value( baseline ) ) << Qt::endl;
+
+			return 1;
+		}
+
+		const auto regressions = compare( results, QJsonDocument::fromJson( file.readAll() ).object(),
+			parser.value( threshold ).toDouble(), out );
+
+		if( regressions )
+			return 2;
+	}
+
+	return ( errors ? 1 : 0 );
+}
@@ -0,0 +1,184 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <src/renderer.hpp>
+#include <src/syntax.hpp>
+
+// md4qt include.
+#define MD4QT_QT_SUPPORT
+#include <md4qt/parser.hpp>
+
+#include <bench_const.hpp>
+
+#include <QObject>
+#include <QtTest/QtTest>
+
+// C++ include.
+#include <memory>
+
+
+struct MeasureBenchmark {
+	//! Lay out all top-level paragraphs of the document with the given sink.
+	static void
+	drawParagraphs( PdfRenderer & pdf, DrawSink & sink, PdfRenderer::CalcHeightOpt heightCalcOpt )
+	{
+		std::unique_ptr< Document, DocumentDeleter > document( new Document );
+		std::vector< std::shared_ptr< Painter > > painters;
+
+		PdfRenderContext context;
+		context.doc = document.get();
+		context.painters = &painters;
+		context.sink = &sink;
+		context.dpi = pdf.m_opts.m_dpi;
+		context.syntax = pdf.m_opts.m_syntax;
+		context.md = pdf.m_doc;
+
+		PdfAuxData pdfData;
+		pdfData.context = &context;
+		pdfData.coords.margins.left = pdf.m_opts.m_left;
+		pdfData.coords.margins.right = pdf.m_opts.m_right;
+		pdfData.coords.margins.top = pdf.m_opts.m_top;
+		pdfData.coords.margins.bottom = pdf.m_opts.m_bottom;
+		pdfData.colorsStack.push( Qt::black );
+
+		pdf.createPage( pdfData );
+
+		for( const auto & item : pdf.m_doc->items() )
+		{
+			if( item->type() == MD::ItemType::Paragraph )
+				pdf.drawParagraph( pdfData, pdf.m_opts,
+					static_cast< MD::Paragraph< MD::QStringTrait >* > ( item.get() ),
+					pdf.m_doc, 0.0, true, heightCalcOpt, 1.0 );
+		}
+
+		pdf.finishPages( pdfData );
+	}
+}; // struct MeasureBenchmark
+
+//
+// MeasureBench
+//
+
+//! Compares measuring pass of paragraphs with the drawing one.
+class MeasureBench final
+	:	public QObject
+{
+	Q_OBJECT
+
+private slots:
+	//! Measure paragraphs.
+	void benchmarkMeasure_data();
+	void benchmarkMeasure();
+	//! Draw paragraphs.
+	void benchmarkDraw_data();
+	void benchmarkDraw();
+}; // class MeasureBench
+
+//! Prepare renderer for the given file.
+static void
+prepare( PdfRenderer & pdf, const QString & fileName )
+{
+	MD::Parser< MD::QStringTrait > parser;
+
+	auto doc = parser.parse( c_folder + QStringLiteral( "/../../manual/" ) + fileName, true );
+
+	RenderOpts opts;
+	opts.m_borderColor = QColor( 81, 81, 81 );
+	opts.m_linkColor = QColor( 33, 122, 255 );
+	opts.m_syntax = std::make_shared< Syntax > ();
+	opts.m_syntax->setTheme( opts.m_syntax->themeForName( QStringLiteral( "GitHub Light" ) ) );
+	opts.m_textFont = QStringLiteral( "Droid Serif" );
+	opts.m_textFontSize = 8;
+	opts.m_codeFont = QStringLiteral( "Courier New" );
+	opts.m_codeFontSize = 8;
+	opts.m_mathFont = QStringLiteral( "Droid Serif" );
+	opts.m_mathFontSize = 8;
+	opts.m_left = 50.0;
+	opts.m_right = 50.0;
+	opts.m_top = 50.0;
+	opts.m_bottom = 50.0;
+	opts.m_dpi = 150;
+	// Not embedded fonts don't depend on fonts installed in the system.
+	opts.m_useStandardFonts = true;
+
+	pdf.render( QString(), doc, opts, true );
+}
+
+//! Files with a lot of text.
+static void
+corpus()
+{
+	QTest::addColumn< QString > ( "fileName" );
+
+	QTest::newRow( "complex" ) << QStringLiteral( "complex.md" );
+	QTest::newRow( "complex2" ) << QStringLiteral( "complex2.md" );
+	QTest::newRow( "complex3" ) << QStringLiteral( "complex3.md" );
+	QTest::newRow( "footnotes" ) << QStringLiteral( "footnotes.md" );
+	QTest::newRow( "links" ) << QStringLiteral( "links.md" );
+}
+
+void
+MeasureBench::benchmarkMeasure_data()
+{
+	corpus();
+}
+
+void
+MeasureBench::benchmarkMeasure()
+{
+	QFETCH( QString, fileName );
+
+	PdfRenderer pdf;
+	prepare( pdf, fileName );
+
+	DrawSink sink;
+	sink.emplace< NullSink > ();
+
+	QBENCHMARK {
+		MeasureBenchmark::drawParagraphs( pdf, sink, PdfRenderer::CalcHeightOpt::Full );
+	}
+}
+
+void
+MeasureBench::benchmarkDraw_data()
+{
+	corpus();
+}
+
+void
+MeasureBench::benchmarkDraw()
+{
+	QFETCH( QString, fileName );
+
+	PdfRenderer pdf;
+	prepare( pdf, fileName );
+
+	DrawSink sink;
+
+	QBENCHMARK {
+		MeasureBenchmark::drawParagraphs( pdf, sink, PdfRenderer::CalcHeightOpt::Unknown );
+	}
+}
+
+QTEST_MAIN( MeasureBench )
+
+#include "main.moc"
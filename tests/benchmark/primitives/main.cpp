@@ -0,0 +1,473 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <src/renderer.hpp>
+#include <src/syntax.hpp>
+#include <src/podofo_paintdevice.hpp>
+
+// md4qt include.
+#define MD4QT_QT_SUPPORT
+#include <md4qt/parser.hpp>
+
+#include <bench_const.hpp>
+
+#include <QObject>
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QPainter>
+
+// Magick++ include.
+#include <Magick++.h>
+
+// C++ include.
+#include <memory>
+
+
+//! Fixed paragraph of text for measuring.
+static const QString c_text = QStringLiteral( "Lorem ipsum dolor sit amet, consectetur "
+	"adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. "
+	"Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip "
+	"ex ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit "
+	"esse cillum dolore eu fugiat nulla pariatur." );
+
+//! Fixed SVG image.
+static const QByteArray c_svg = QByteArrayLiteral( "<svg xmlns=\"http://www.w3.org/2000/svg\" "
+	"width=\"400\" height=\"300\"><rect width=\"400\" height=\"300\" fill=\"#217aff\"/>"
+	"<circle cx=\"200\" cy=\"150\" r=\"100\" fill=\"#515151\"/></svg>" );
+
+struct PrimitivesBenchmark {
+	//! Everything needed to call renderer's primitives outside of rendering.
+	struct Context {
+		PdfRenderer pdf;
+		std::unique_ptr< Document, DocumentDeleter > document;
+		std::vector< std::shared_ptr< Painter > > painters;
+		DrawSink sink;
+		PdfRenderContext context;
+		PdfAuxData pdfData;
+		Font * font = nullptr;
+		double lineHeight = 0.0;
+	}; // struct Context
+
+	//! Initialize context, a page is created to have valid coordinates.
+	static void
+	init( Context & ctx, std::shared_ptr< MD::Document< MD::QStringTrait > > doc,
+		const RenderOpts & opts )
+	{
+		ctx.pdf.render( QString(), doc, opts, true );
+		ctx.document.reset( new Document );
+		ctx.sink.emplace< NullSink > ();
+
+		ctx.context.doc = ctx.document.get();
+		ctx.context.painters = &ctx.painters;
+		ctx.context.sink = &ctx.sink;
+		ctx.context.dpi = opts.m_dpi;
+		ctx.context.syntax = opts.m_syntax;
+		ctx.context.md = doc;
+
+		auto & pdfData = ctx.pdfData;
+		pdfData.context = &ctx.context;
+		pdfData.coords.margins.left = opts.m_left;
+		pdfData.coords.margins.right = opts.m_right;
+		pdfData.coords.margins.top = opts.m_top;
+		pdfData.coords.margins.bottom = opts.m_bottom;
+		pdfData.colorsStack.push( Qt::black );
+
+		ctx.pdf.createPage( pdfData );
+
+		ctx.font = createFont( ctx, false, false );
+		ctx.lineHeight = pdfData.lineSpacing( ctx.font, opts.m_textFontSize, 1.0 );
+	}
+
+	//! \return Text font.
+	static Font *
+	createFont( Context & ctx, bool bold, bool italic )
+	{
+		return ctx.pdf.createFont( ctx.pdf.m_opts.m_textFont, bold, italic,
+			ctx.pdf.m_opts.m_textFontSize, ctx.pdfData.context->doc, 1.0, ctx.pdfData );
+	}
+
+	//! \return Prepared items of line for calculation of scales.
+	static PdfRenderer::CustomWidth
+	customWidth( Context & ctx, int lines )
+	{
+		PdfRenderer::CustomWidth cw;
+
+		const auto words = c_text.split( QLatin1Char( ' ' ) );
+		const auto spaceWidth = ctx.pdfData.stringWidth( ctx.font, ctx.pdf.m_opts.m_textFontSize,
+			1.0, String( " " ) );
+
+		for( int l = 0; l < lines; ++l )
+		{
+			for( const auto & w : words )
+			{
+				cw.append( { ctx.pdfData.stringWidth( ctx.font, ctx.pdf.m_opts.m_textFontSize, 1.0,
+						PdfRenderer::createUtf8String( w ) ),
+					ctx.lineHeight, 0.0, false, false, true, false, w } );
+				cw.append( { spaceWidth, ctx.lineHeight, 0.0, true, false, true, false, " " } );
+			}
+
+			cw.append( { 0.0, ctx.lineHeight, 0.0, false, true, true, false, "" } );
+		}
+
+		return cw;
+	}
+
+	//! Calculate scales of spaces.
+	static void
+	calcScale( Context & ctx, PdfRenderer::CustomWidth cw )
+	{
+		cw.calcScale( ctx.pdfData.coords.pageWidth - ctx.pdfData.coords.margins.left -
+			ctx.pdfData.coords.margins.right );
+	}
+
+	//! Measure string with word wrapping.
+	static void
+	drawString( Context & ctx, const QString & str )
+	{
+		PdfRenderer::CustomWidth cw;
+		bool newLine = false;
+		const auto size = ctx.pdf.m_opts.m_textFontSize;
+
+		ctx.pdfData.coords.x = ctx.pdfData.coords.margins.left;
+		ctx.pdfData.coords.y = ctx.pdfData.topY( ctx.pdfData.currentPageIndex() );
+
+		ctx.pdf.drawString( ctx.pdfData, ctx.pdf.m_opts, str,
+			ctx.font, size, 1.0,
+			ctx.font, size, 1.0,
+			ctx.font, size, 1.0,
+			ctx.lineHeight, ctx.pdf.m_doc, newLine,
+			ctx.font, size, 1.0,
+			nullptr, 0, 0.0, true, &cw, QColor(), false, 0, 0, 0, 0 );
+	}
+
+	//! \return Table with one cell of words in different fonts.
+	static PdfRenderer::AuxTable
+	auxTable( Context & ctx )
+	{
+		PdfRenderer::AuxTable table;
+		table.columnsCount = 1;
+		table.rowsCount = 1;
+		table.alignments.append( MD::Table< MD::QStringTrait >::AlignLeft );
+		table.widths.append( 150.0 );
+		table.heights.append( 0.0 );
+		table.cells.append( 0 );
+
+		int i = 0;
+
+		for( const auto & w : c_text.split( QLatin1Char( ' ' ) ) )
+		{
+			PdfRenderer::AuxTable::Item item;
+			item.word = table.addString( w );
+			item.font = table.addFont( { ctx.pdf.m_opts.m_textFont, ( i % 7 == 0 ), ( i % 5 == 0 ),
+				false, ctx.pdf.m_opts.m_textFontSize } );
+			table.items.append( item );
+			++i;
+		}
+
+		table.cells.append( table.items.size() );
+
+		return table;
+	}
+
+	//! Measure items and calculate height of the cell.
+	static void
+	heightToWidth( Context & ctx, PdfRenderer::AuxTable & table )
+	{
+		ctx.pdf.measureAuxTable( ctx.pdfData, table, 1.0 );
+
+		table.heightToWidth( 0, ctx.lineHeight, ctx.pdfData.stringWidth( ctx.font,
+			ctx.pdf.m_opts.m_textFontSize, 1.0, String( " " ) ), 1.0 );
+	}
+
+	//! Load image without caches.
+	static QByteArray
+	loadImage( Context & ctx, MD::Image< MD::QStringTrait > * img )
+	{
+		ctx.pdf.m_imageCache.clear();
+
+		return ctx.pdf.loadImage( img );
+	}
+
+	//! Lay out math expression.
+	static void
+	drawMathExpr( Context & ctx, MD::Math< MD::QStringTrait > * math )
+	{
+		bool newLine = false;
+
+		ctx.pdfData.coords.x = ctx.pdfData.coords.margins.left;
+		ctx.pdfData.coords.y = ctx.pdfData.topY( ctx.pdfData.currentPageIndex() );
+
+		ctx.pdf.drawMathExpr( ctx.pdfData, ctx.pdf.m_opts, math, ctx.pdf.m_doc, newLine,
+			0.0, false, true, nullptr, 1.0 );
+	}
+}; // struct PrimitivesBenchmark
+
+//
+// PrimitivesBench
+//
+
+//! Benchmarks of the renderer's primitives with fixed inputs.
+class PrimitivesBench final
+	:	public QObject
+{
+	Q_OBJECT
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	//! Width of the string.
+	void benchmarkStringWidth_data();
+	void benchmarkStringWidth();
+	//! Lookup of the font.
+	void benchmarkCreateFont();
+	//! Scales of spaces on lines.
+	void benchmarkCalcScale_data();
+	void benchmarkCalcScale();
+	//! Word wrapping of the string.
+	void benchmarkDrawString();
+	//! Height of the table's cell.
+	void benchmarkHeightToWidth();
+	//! Highlighting of the code.
+	void benchmarkSyntaxPrepare();
+	//! Loading of images.
+	void benchmarkLoadImage_data();
+	void benchmarkLoadImage();
+	//! Conversion of SVG pixels.
+	void benchmarkConvert();
+	//! Math expression.
+	void benchmarkDrawMathExpr_data();
+	void benchmarkDrawMathExpr();
+
+private:
+	std::unique_ptr< PrimitivesBenchmark::Context > m_ctx;
+	std::shared_ptr< MD::Document< MD::QStringTrait > > m_doc;
+	QTemporaryDir m_dir;
+}; // class PrimitivesBench
+
+void
+PrimitivesBench::initTestCase()
+{
+	QVERIFY( m_dir.isValid() );
+
+	// Fonts are taken from the test fonts, not from the system.
+	PoDoFo::PdfFontManager::AddFontDirectory( QDir::toNativeSeparators( c_fontsFolder )
+		.toLocal8Bit().data() );
+
+	MD::Parser< MD::QStringTrait > parser;
+
+	m_doc = parser.parse( c_folder + QStringLiteral( "/../../manual/code.md" ), false );
+
+	RenderOpts opts;
+	opts.m_borderColor = QColor( 81, 81, 81 );
+	opts.m_linkColor = QColor( 33, 122, 255 );
+	opts.m_syntax = std::make_shared< Syntax > ();
+	opts.m_syntax->setTheme( opts.m_syntax->themeForName( QStringLiteral( "GitHub Light" ) ) );
+	opts.m_textFont = QStringLiteral( "Droid Serif" );
+	opts.m_textFontSize = 8;
+	opts.m_codeFont = QStringLiteral( "Courier New" );
+	opts.m_codeFontSize = 8;
+	opts.m_mathFont = QStringLiteral( "Droid Serif" );
+	opts.m_mathFontSize = 8;
+	opts.m_left = 50.0;
+	opts.m_right = 50.0;
+	opts.m_top = 50.0;
+	opts.m_bottom = 50.0;
+	opts.m_dpi = 150;
+
+	m_ctx.reset( new PrimitivesBenchmark::Context );
+	PrimitivesBenchmark::init( *m_ctx, m_doc, opts );
+
+	QImage img( 800, 600, QImage::Format_RGB888 );
+	QPainter p( &img );
+	p.fillRect( img.rect(), QColor( 33, 122, 255 ) );
+	p.setPen( QColor( 81, 81, 81 ) );
+
+	for( int i = 0; i < 600; i += 10 )
+		p.drawLine( 0, i, 800, 600 - i );
+
+	p.end();
+
+	QVERIFY( img.save( m_dir.filePath( QStringLiteral( "image.png" ) ) ) );
+	QVERIFY( img.save( m_dir.filePath( QStringLiteral( "image.jpg" ) ) ) );
+
+	QFile svg( m_dir.filePath( QStringLiteral( "image.svg" ) ) );
+	QVERIFY( svg.open( QIODevice::WriteOnly ) );
+	svg.write( c_svg );
+	svg.close();
+}
+
+void
+PrimitivesBench::cleanupTestCase()
+{
+	m_ctx.reset();
+}
+
+void
+PrimitivesBench::benchmarkStringWidth_data()
+{
+	QTest::addColumn< QString > ( "text" );
+
+	QTest::newRow( "word" ) << QStringLiteral( "consectetur" );
+	QTest::newRow( "paragraph" ) << c_text;
+	QTest::newRow( "unicode" ) << QStringLiteral( "Съешь же ещё этих мягких французских булок" );
+}
+
+void
+PrimitivesBench::benchmarkStringWidth()
+{
+	QFETCH( QString, text );
+
+	auto & ctx = *m_ctx;
+	const auto str = PdfRenderer::createUtf8String( text );
+
+	QBENCHMARK {
+		ctx.pdfData.stringWidth( ctx.font, 8.0, 1.0, str );
+	}
+}
+
+void
+PrimitivesBench::benchmarkCreateFont()
+{
+	auto & ctx = *m_ctx;
+
+	QBENCHMARK {
+		PrimitivesBenchmark::createFont( ctx, true, false );
+	}
+}
+
+void
+PrimitivesBench::benchmarkCalcScale_data()
+{
+	QTest::addColumn< int > ( "lines" );
+
+	QTest::newRow( "1" ) << 1;
+	QTest::newRow( "100" ) << 100;
+}
+
+void
+PrimitivesBench::benchmarkCalcScale()
+{
+	QFETCH( int, lines );
+
+	const auto cw = PrimitivesBenchmark::customWidth( *m_ctx, lines );
+
+	QBENCHMARK {
+		PrimitivesBenchmark::calcScale( *m_ctx, cw );
+	}
+}
+
+void
+PrimitivesBench::benchmarkDrawString()
+{
+	QBENCHMARK {
+		PrimitivesBenchmark::drawString( *m_ctx, c_text );
+	}
+}
+
+void
+PrimitivesBench::benchmarkHeightToWidth()
+{
+	auto table = PrimitivesBenchmark::auxTable( *m_ctx );
+
+	QBENCHMARK {
+		PrimitivesBenchmark::heightToWidth( *m_ctx, table );
+	}
+}
+
+void
+PrimitivesBench::benchmarkSyntaxPrepare()
+{
+	QFile file( c_folder + QStringLiteral( "/../../../src/renderer.cpp" ) );
+	QVERIFY( file.open( QIODevice::ReadOnly ) );
+
+	const auto lines = QString::fromUtf8( file.readAll() ).split( QLatin1Char( '\n' ) ).mid( 0, 500 );
+
+	QBENCHMARK {
+		m_ctx->pdfData.context->syntax->prepare( lines, QStringLiteral( "cpp" ) );
+	}
+}
+
+void
+PrimitivesBench::benchmarkLoadImage_data()
+{
+	QTest::addColumn< QString > ( "fileName" );
+
+	QTest::newRow( "png" ) << QStringLiteral( "image.png" );
+	QTest::newRow( "jpg" ) << QStringLiteral( "image.jpg" );
+	QTest::newRow( "svg" ) << QStringLiteral( "image.svg" );
+}
+
+void
+PrimitivesBench::benchmarkLoadImage()
+{
+	QFETCH( QString, fileName );
+
+	MD::Image< MD::QStringTrait > img;
+	img.setUrl( m_dir.filePath( fileName ) );
+
+	QBENCHMARK {
+		PrimitivesBenchmark::loadImage( *m_ctx, &img );
+	}
+}
+
+void
+PrimitivesBench::benchmarkConvert()
+{
+	Magick::Image img;
+	img.read( m_dir.filePath( QStringLiteral( "image.svg" ) ).toStdString() );
+	img.magick( "png" );
+
+	QBENCHMARK {
+		convert( img );
+	}
+}
+
+void
+PrimitivesBench::benchmarkDrawMathExpr_data()
+{
+	QTest::addColumn< QString > ( "expr" );
+	QTest::addColumn< bool > ( "isInline" );
+
+	QTest::newRow( "inline" ) << QStringLiteral( "a^2 + b^2 = c^2" ) << true;
+	QTest::newRow( "block" ) << QStringLiteral( "\\int_{0}^{\\infty} e^{-x^2} dx = "
+		"\\frac{\\sqrt{\\pi}}{2}" ) << false;
+}
+
+void
+PrimitivesBench::benchmarkDrawMathExpr()
+{
+	QFETCH( QString, expr );
+	QFETCH( bool, isInline );
+
+	MD::Math< MD::QStringTrait > math;
+	math.setExpr( expr );
+	math.setInline( isInline );
+
+	QBENCHMARK {
+		PrimitivesBenchmark::drawMathExpr( *m_ctx, &math );
+	}
+}
+
+QTEST_MAIN( PrimitivesBench )
+
+#include "main.moc"
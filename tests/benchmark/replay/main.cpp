@@ -0,0 +1,260 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// md-pdf include.
+#include <src/trace.hpp>
+#include <src/podofo_paintdevice.hpp>
+
+// Qt include.
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+// C++ include.
+#include <memory>
+#include <vector>
+
+
+//! Timings of replay in milliseconds.
+struct Timings {
+	//! Generation of content streams.
+	qint64 draw = 0;
+	//! Finishing of content streams, i.e. compression.
+	qint64 finish = 0;
+	//! Saving of the document.
+	qint64 save = 0;
+}; // struct Timings
+
+//! \return Font of the trace in the document.
+static PoDoFo::PdfFont *
+createFont( PoDoFo::PdfMemDocument * doc, const TraceFont & f )
+{
+	if( f.standard14 >= 0 )
+		return standard14Font( doc, static_cast< PoDoFo::PdfStandard14FontType > ( f.standard14 ) );
+
+	try {
+		return fontFromFile( doc, f.path, {} );
+	}
+	catch( const PoDoFo::PdfError & )
+	{
+		// Font of the trace is not installed here.
+		return standard14Font( doc, PoDoFo::PdfStandard14FontType::Helvetica );
+	}
+}
+
+//! Draw text like PainterSink does.
+static void
+drawText( PoDoFo::PdfPainter & p, const TraceRecord & r, const QByteArray & text,
+	PoDoFo::PdfFont * font )
+{
+	const double x = r.args[ 0 ];
+	const double y = r.args[ 1 ];
+
+	p.TextObject.Begin();
+	p.TextObject.MoveTo( x, y );
+	p.TextState.SetFont( *font, r.args[ 2 ] );
+	p.TextState.SetFontScale( r.args[ 3 ] );
+	const auto st = p.TextState;
+	p.TextObject.AddText( text.data() );
+	p.TextObject.End();
+
+	if( r.flags )
+	{
+		p.Save();
+
+		p.GraphicsState.SetLineWidth( font->GetStrikeThroughThickness( st ) );
+
+		p.DrawLine( x,
+			y + font->GetStrikeThroughPosition( st ),
+			x + font->GetStringLength( text.data(), st ),
+			y + font->GetStrikeThroughPosition( st ) );
+
+		p.Restore();
+	}
+}
+
+//! Replay trace into new document and save it.
+static Timings
+replay( const TraceReader & trace, const QString & fileName )
+{
+	Timings t;
+	QElapsedTimer timer;
+
+	std::unique_ptr< PoDoFo::PdfMemDocument, DocumentDeleter > doc( new PoDoFo::PdfMemDocument );
+
+	// Images are not stored in the trace, they are replaced with plain ones of the same size.
+	std::vector< std::unique_ptr< PoDoFo::PdfImage > > images;
+
+	for( const auto & s : trace.images() )
+	{
+		images.push_back( doc->CreateImage() );
+
+		const QByteArray pixels( s.width() * s.height() * 3, static_cast< char > ( 0xC0 ) );
+
+		images.back()->SetData( { pixels.data(), static_cast< size_t > ( pixels.size() ) },
+			s.width(), s.height(), PoDoFo::PdfPixelFormat::RGB24 );
+	}
+
+	std::vector< PoDoFo::PdfFont* > fonts;
+
+	for( const auto & f : trace.fonts() )
+		fonts.push_back( createFont( doc.get(), f ) );
+
+	timer.start();
+
+	std::vector< std::unique_ptr< PoDoFo::PdfPainter > > painters;
+
+	for( quint32 i = 0; i < trace.header().pagesCount; ++i )
+	{
+		auto & page = doc->GetPages().CreatePage(
+			PoDoFo::Rect( 0.0, 0.0, trace.header().pageWidth, trace.header().pageHeight ) );
+		painters.push_back( std::make_unique< PoDoFo::PdfPainter > () );
+		painters.back()->SetCanvas( page );
+	}
+
+	const auto * r = trace.records();
+	const auto * end = r + trace.header().recordsCount;
+
+	for( ; r != end; ++r )
+	{
+		auto & p = *painters[ r->page ];
+
+		switch( r->type )
+		{
+			case TraceRecordType::Text :
+				drawText( p, *r, trace.strings().at( r->string ), fonts[ r->object ] );
+				break;
+
+			case TraceRecordType::Image :
+				p.DrawImage( *images[ r->object ], r->args[ 0 ], r->args[ 1 ],
+					r->args[ 2 ], r->args[ 3 ] );
+				break;
+
+			case TraceRecordType::Line :
+				p.DrawLine( r->args[ 0 ], r->args[ 1 ], r->args[ 2 ], r->args[ 3 ] );
+				break;
+
+			case TraceRecordType::Rectangle :
+				p.DrawRectangle( r->args[ 0 ], r->args[ 1 ], r->args[ 2 ], r->args[ 3 ],
+					static_cast< PoDoFo::PdfPathDrawMode > ( r->flags ) );
+				break;
+
+			case TraceRecordType::Circle :
+				p.DrawCircle( r->args[ 0 ], r->args[ 1 ], r->args[ 2 ],
+					static_cast< PoDoFo::PdfPathDrawMode > ( r->flags ) );
+				break;
+
+			case TraceRecordType::Color :
+			{
+				const PoDoFo::PdfColor c( r->args[ 0 ], r->args[ 1 ], r->args[ 2 ] );
+				p.GraphicsState.SetFillColor( c );
+				p.GraphicsState.SetStrokeColor( c );
+			}
+				break;
+
+			default :
+				break;
+		}
+	}
+
+	t.draw = timer.restart();
+
+	for( auto & p : painters )
+		p->FinishDrawing();
+
+	t.finish = timer.restart();
+
+	if( fileName.isEmpty() )
+	{
+		PoDoFo::NullStreamDevice device;
+		doc->Save( device );
+	}
+	else
+		doc->Save( fileName.toLocal8Bit().data() );
+
+	t.save = timer.elapsed();
+
+	return t;
+}
+
+int main( int argc, char ** argv )
+{
+	QCoreApplication app( argc, argv );
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription( QStringLiteral(
+		"Replay trace of drawing primitives into PDF and measure emission." ) );
+	parser.addHelpOption();
+	parser.addPositionalArgument( QStringLiteral( "trace" ),
+		QStringLiteral( "Trace of drawing primitives." ) );
+	parser.addPositionalArgument( QStringLiteral( "pdf" ),
+		QStringLiteral( "Output PDF, if not set document is saved to nowhere." ) );
+	QCommandLineOption iterations( { QStringLiteral( "n" ), QStringLiteral( "iterations" ) },
+		QStringLiteral( "Replay trace <count> times." ),
+		QStringLiteral( "count" ), QStringLiteral( "1" ) );
+	parser.addOption( iterations );
+
+	parser.process( app );
+
+	const auto args = parser.positionalArguments();
+
+	if( args.isEmpty() )
+		parser.showHelp( 1 );
+
+	QTextStream out( stdout );
+
+	TraceReader trace( args.at( 0 ) );
+
+	if( !trace.open() )
+	{
+		QTextStream( stderr ) << trace.errorString() << Qt::endl;
+
+		return 1;
+	}
+
+	out << QStringLiteral( "Pages: %1, records: %2, strings: %3, fonts: %4, images: %5" )
+		.arg( trace.header().pagesCount ).arg( trace.header().recordsCount )
+		.arg( trace.strings().size() ).arg( trace.fonts().size() )
+		.arg( trace.images().size() ) << Qt::endl;
+
+	const int count = qMax( 1, parser.value( iterations ).toInt() );
+
+	try {
+		for( int i = 0; i < count; ++i )
+		{
+			const auto t = replay( trace, ( args.size() > 1 ? args.at( 1 ) : QString() ) );
+
+			out << QStringLiteral( "Draw: %1 ms, finish: %2 ms, save: %3 ms" )
+				.arg( t.draw ).arg( t.finish ).arg( t.save ) << Qt::endl;
+		}
+	}
+	catch( const PoDoFo::PdfError & e )
+	{
+		QTextStream( stderr ) << QString::fromLatin1( e.what() ) << Qt::endl;
+
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,289 @@
+
+/*!
+	\file
+
+	\author Igor Mironchik (igor.mironchik at gmail dot com).
+
+	Copyright (c) 2019-2024 Igor Mironchik
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MD_PDF_TESTS_GENERATOR_HPP_INCLUDED
+#define MD_PDF_TESTS_GENERATOR_HPP_INCLUDED
+
+// Qt include.
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QRandomGenerator>
+
+
+//
+// GeneratorOpts
+//
+
+//! Shape of the generated Markdown document.
+struct GeneratorOpts {
+	//! Count of paragraphs.
+	int paragraphs = 200;
+	//! Count of footnotes, references are spread over paragraphs.
+	int footnotes = 40;
+	//! Count of links, internal and external, spread over paragraphs.
+	int links = 100;
+	//! Count of headings, every heading is an anchor for internal links.
+	int anchors = 20;
+	//! Count of tables.
+	int tables = 2;
+	//! Count of rows in every table.
+	int tableRows = 50;
+	//! Count of columns in every table.
+	int tableColumns = 4;
+	//! Count of code blocks.
+	int codeBlocks = 10;
+	//! Count of images, images are not generated if imagePath is empty.
+	int images = 5;
+	//! Depth of nested lists and blockquotes.
+	int nesting = 3;
+	//! Length of every word, natural words are used if 0.
+	int tokenLength = 0;
+	//! Path of the image.
+	QString imagePath;
+
+	//! \return Options of the document \p factor times bigger.
+	//! Shape of table, nesting and tokens are not scaled.
+	GeneratorOpts scaled( int factor ) const
+	{
+		auto opts = *this;
+		opts.paragraphs *= factor;
+		opts.footnotes *= factor;
+		opts.links *= factor;
+		opts.anchors *= factor;
+		opts.tables *= factor;
+		opts.codeBlocks *= factor;
+		opts.images *= factor;
+
+		return opts;
+	}
+}; // struct GeneratorOpts
+
+
+//
+// Generator
+//
+
+//! Generator of synthetic Markdown, the same options and seed give the same document.
+class Generator final {
+public:
+	explicit Generator( quint32 seed = 42 )
+		:	m_rnd( seed )
+	{
+	}
+
+	//! \return Markdown document.
+	QByteArray generate( const GeneratorOpts & opts )
+	{
+		QString md;
+
+		const int sections = qMax( 1, opts.anchors );
+
+		int paragraph = 0;
+
+		for( int s = 0; s < sections; ++s )
+		{
+			md.append( QStringLiteral( "# Section %1\n\n" ).arg( s + 1 ) );
+
+			for( int p = 0, last = share( opts.paragraphs, s, sections ); p < last; ++p, ++paragraph )
+				md.append( this->paragraph( opts, paragraph, sections ) + QStringLiteral( "\n\n" ) );
+
+			for( int c = 0, last = share( opts.codeBlocks, s, sections ); c < last; ++c )
+				md.append( code( opts ) );
+
+			for( int i = 0, last = share( opts.images, s, sections ); i < last; ++i )
+			{
+				if( !opts.imagePath.isEmpty() )
+					md.append( QStringLiteral( "![%1](%2)\n\n" ).arg( word( opts ), opts.imagePath ) );
+			}
+
+			for( int t = 0, last = share( opts.tables, s, sections ); t < last; ++t )
+				md.append( table( opts ) );
+
+			if( opts.nesting > 0 )
+				md.append( nested( opts ) );
+		}
+
+		for( int f = 0; f < opts.footnotes; ++f )
+			md.append( QStringLiteral( "[^%1]: %2.\n\n" ).arg( f + 1 ).arg( sentence( opts, 20 ) ) );
+
+		return md.toUtf8();
+	}
+
+private:
+	//! \return Part of \p total that goes to the \p idx of \p count.
+	static int share( int total, int idx, int count )
+	{
+		return static_cast< int > ( static_cast< qint64 > ( total ) * ( idx + 1 ) / count -
+			static_cast< qint64 > ( total ) * idx / count );
+	}
+
+	//! \return Random word.
+	QString word( const GeneratorOpts & opts )
+	{
+		static const QStringList words = { QStringLiteral( "lorem" ), QStringLiteral( "ipsum" ),
+			QStringLiteral( "dolor" ), QStringLiteral( "sit" ), QStringLiteral( "amet" ),
+			QStringLiteral( "consectetur" ), QStringLiteral( "adipiscing" ), QStringLiteral( "elit" ),
+			QStringLiteral( "sed" ), QStringLiteral( "do" ), QStringLiteral( "eiusmod" ),
+			QStringLiteral( "tempor" ), QStringLiteral( "incididunt" ), QStringLiteral( "ut" ),
+			QStringLiteral( "labore" ), QStringLiteral( "et" ), QStringLiteral( "dolore" ),
+			QStringLiteral( "magna" ), QStringLiteral( "aliqua" ) };
+
+		if( opts.tokenLength > 0 )
+		{
+			QString w( opts.tokenLength, Qt::Uninitialized );
+
+			for( auto & ch : w )
+				ch = QLatin1Char( static_cast< char > ( 'a' + m_rnd.bounded( 26 ) ) );
+
+			return w;
+		}
+
+		return words.at( m_rnd.bounded( words.size() ) );
+	}
+
+	//! \return Sentence of \p count words, some of them are emphasized.
+	QString sentence( const GeneratorOpts & opts, int count )
+	{
+		QStringList s;
+
+		for( int i = 0; i < count; ++i )
+		{
+			auto w = word( opts );
+
+			switch( m_rnd.bounded( 10 ) )
+			{
+				case 0 :
+					w = QStringLiteral( "*%1*" ).arg( w );
+					break;
+
+				case 1 :
+					w = QStringLiteral( "**%1**" ).arg( w );
+					break;
+
+				case 2 :
+					w = QStringLiteral( "`%1`" ).arg( w );
+					break;
+
+				default :
+					break;
+			}
+
+			s.append( w );
+		}
+
+		return s.join( QLatin1Char( ' ' ) );
+	}
+
+	//! \return Paragraph with its share of links and footnote references.
+	QString paragraph( const GeneratorOpts & opts, int idx, int sections )
+	{
+		auto p = sentence( opts, 60 + m_rnd.bounded( 60 ) );
+
+		const int count = qMax( 1, opts.paragraphs );
+
+		for( int l = 0, last = share( opts.links, idx, count ); l < last; ++l )
+		{
+			if( m_rnd.bounded( 2 ) )
+				p.append( QStringLiteral( " [%1](#section-%2)" ).arg( word( opts ) )
+					.arg( m_rnd.bounded( sections ) + 1 ) );
+			else
+				p.append( QStringLiteral( " [%1](https://example.com/%2)" ).arg( word( opts ) )
+					.arg( m_rnd.bounded( 1000 ) ) );
+		}
+
+		const int first = static_cast< int > ( static_cast< qint64 > ( opts.footnotes ) * idx / count );
+
+		for( int f = 0, last = share( opts.footnotes, idx, count ); f < last; ++f )
+			p.append( QStringLiteral( "[^%1]" ).arg( first + f + 1 ) );
+
+		return p + QLatin1Char( '.' );
+	}
+
+	//! \return Block of code.
+	QString code( const GeneratorOpts & opts )
+	{
+		QString c = QStringLiteral( "```cpp\n" );
+
+		for( int l = 0; l < 15; ++l )
+			c.append( QStringLiteral( "int value%1 = %2; // %3\n" ).arg( l )
+				.arg( m_rnd.bounded( 1000 ) ).arg( sentence( opts, 3 ) ) );
+
+		return c + QStringLiteral( "```\n\n" );
+	}
+
+	//! \return Table.
+	QString table( const GeneratorOpts & opts )
+	{
+		const int columns = qMax( 1, opts.tableColumns );
+
+		QString t = QStringLiteral( "|" );
+
+		for( int c = 0; c < columns; ++c )
+			t.append( QStringLiteral( " Column %1 |" ).arg( c + 1 ) );
+
+		t.append( QStringLiteral( "\n|" ) );
+
+		for( int c = 0; c < columns; ++c )
+			t.append( QStringLiteral( "---|" ) );
+
+		t.append( QLatin1Char( '\n' ) );
+
+		for( int r = 0; r < opts.tableRows; ++r )
+		{
+			t.append( QLatin1Char( '|' ) );
+
+			for( int c = 0; c < columns; ++c )
+				t.append( QStringLiteral( " %1 |" ).arg( sentence( opts, 1 + m_rnd.bounded( 5 ) ) ) );
+
+			t.append( QLatin1Char( '\n' ) );
+		}
+
+		return t + QLatin1Char( '\n' );
+	}
+
+	//! \return Nested list and nested blockquote.
+	QString nested( const GeneratorOpts & opts )
+	{
+		QString n;
+
+		for( int d = 0; d < opts.nesting; ++d )
+			n.append( QString( d * 2, QLatin1Char( ' ' ) ) + QStringLiteral( "* " ) +
+				sentence( opts, 10 ) + QLatin1Char( '\n' ) );
+
+		n.append( QLatin1Char( '\n' ) );
+
+		for( int d = 0; d < opts.nesting; ++d )
+		{
+			n.append( QString( d + 1, QLatin1Char( '>' ) ) + QLatin1Char( ' ' ) +
+				sentence( opts, 20 ) + QLatin1Char( '\n' ) );
+			n.append( QString( d + 1, QLatin1Char( '>' ) ) + QLatin1Char( '\n' ) );
+		}
+
+		return n + QLatin1Char( '\n' );
+	}
+
+private:
+	QRandomGenerator m_rnd;
+}; // class Generator
+
+#endif // MD_PDF_TESTS_GENERATOR_HPP_INCLUDED